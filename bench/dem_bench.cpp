@@ -0,0 +1,368 @@
+/*
+MIT License
+
+Copyright (c) 2023 Pritam Halder
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated
+documentation files (the "Software"), to deal in the Software without restriction, including without
+limitation the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the
+Software, and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED
+TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF
+CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+DEALINGS IN THE SOFTWARE.
+
+Author : Pritam Halder
+Email : pritamhalder.portfolio@gmail.com
+*/
+
+
+// dem_bench : benchmarks of the DEM hot paths over synthetic terrain, results as JSON
+//
+//  dem_bench [--size N] [--tiles ROWS COLUMNS] [--type int16|int32|float|double] [--endian big|little]
+//            [--queries N] [--threads N] [--directory PATH] [--output FILE] [--generate]
+//
+//  --generate only writes the synthetic tiles (`<latitude>_<longitude>.bin` from 10 N 70 E) & exits
+
+#include <algorithm>
+#include <bit>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <random>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#if defined(_WIN32)
+    #include <windows.h>
+    #include <psapi.h>
+#else
+    #include <sys/resource.h>
+#endif
+
+#include "DEM/DEM.hpp"
+#include "DEM/Map.hpp"
+#include "DEM/Utility.hpp"
+#include "Synthetic.hpp"
+
+
+
+struct Config {
+    size_t size = 1201;
+    int rows = 2;
+    int columns = 2;
+    std::string type = "int16";
+    std::string endian = "big";
+    size_t queries = 1000000;
+    size_t threads = std::max(1u, std::thread::hardware_concurrency());
+    std::filesystem::path directory = std::filesystem::temp_directory_path() / "dem_bench";
+    std::string output;
+    bool generate = false;
+
+    static constexpr int latitude = 10;     // south west tile of the synthetic grid
+    static constexpr int longitude = 70;
+};
+
+
+struct Result {
+    std::string name;
+    size_t operations = 0;
+    double seconds = 0;
+    std::vector<double> latencies;      // nanoseconds per unit, one per timed group
+    size_t group = 1;                   // operations per timed group
+    size_t peak_rss = 0;                // KiB
+    std::string unit = "operation";
+
+    // counts every timed call as `factor` units (batch calls, bytes converted)
+    void scale(size_t factor, const std::string& scaled_unit = "operation") {
+        this->operations *= factor;
+        this->group *= factor;
+        for (double& latency : this->latencies) latency /= static_cast<double>(factor);
+        this->unit = scaled_unit;
+    };
+};
+
+
+// peak resident set size of the process in KiB
+size_t peak_rss() {
+#if defined(_WIN32)
+    PROCESS_MEMORY_COUNTERS counters;
+    GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters));
+    return static_cast<size_t>(counters.PeakWorkingSetSize / 1024);
+#else
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    #if defined(__APPLE__)
+        return static_cast<size_t>(usage.ru_maxrss / 1024);
+    #else
+        return static_cast<size_t>(usage.ru_maxrss);
+    #endif
+#endif
+}
+
+
+// runs `operation(i)` for i in [0, count) timing groups of `group` operations
+Result measure(const std::string& name, size_t count, size_t group, const std::function<void(size_t)>& operation) {
+    Result result;
+    result.name = name;
+    result.operations = count;
+    result.group = group;
+    result.latencies.reserve(count / group + 1);
+
+    const auto start = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < count;) {
+        const size_t end = std::min(count, i + group);
+        const auto begin = std::chrono::steady_clock::now();
+        for (; i < end; ++i) operation(i);
+        const double elapsed = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - begin).count();
+        result.latencies.push_back(elapsed / static_cast<double>(group));
+    }
+    result.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    result.peak_rss = peak_rss();
+
+    std::cerr << name << " : " << result.seconds << " s\n";
+    return result;
+}
+
+
+double percentile(std::vector<double> values, double p) {
+    if (values.empty()) return 0;
+    const size_t k = std::min(values.size() - 1, static_cast<size_t>(p * static_cast<double>(values.size())));
+    std::nth_element(values.begin(), values.begin() + static_cast<std::ptrdiff_t>(k), values.end());
+    return values[k];
+}
+
+
+std::string json(const Config& config, const std::vector<Result>& results) {
+    std::ostringstream out;
+    out << "{\n  \"config\": {"
+        << "\"size\": " << config.size
+        << ", \"tiles\": [" << config.rows << ", " << config.columns << "]"
+        << ", \"type\": \"" << config.type << "\""
+        << ", \"endian\": \"" << config.endian << "\""
+        << ", \"queries\": " << config.queries
+        << ", \"threads\": " << config.threads
+        << "},\n  \"benchmarks\": [\n";
+
+    for (size_t i = 0; i < results.size(); ++i) {
+        const Result& r = results[i];
+        out << "    {\"name\": \"" << r.name << "\""
+            << ", \"unit\": \"" << r.unit << "\""
+            << ", \"operations\": " << r.operations
+            << ", \"seconds\": " << r.seconds
+            << ", \"throughput\": " << static_cast<double>(r.operations) / r.seconds
+            << ", \"latency_ns\": {\"group\": " << r.group
+            << ", \"p50\": " << percentile(r.latencies, 0.50)
+            << ", \"p90\": " << percentile(r.latencies, 0.90)
+            << ", \"p99\": " << percentile(r.latencies, 0.99)
+            << ", \"max\": " << (r.latencies.empty() ? 0 : *std::max_element(r.latencies.begin(), r.latencies.end()))
+            << "}, \"peak_rss_kib\": " << r.peak_rss << "}"
+            << (i + 1 < results.size() ? ",\n" : "\n");
+    }
+
+    out << "  ]\n}\n";
+    return out.str();
+}
+
+
+template <dem_datatype T, std::endian endianness>
+std::vector<Result> run(const Config& config) {
+    const Synthetic synthetic(config.size);
+    std::filesystem::create_directories(config.directory);
+
+    for (int r = 0; r < config.rows; ++r) {
+        for (int c = 0; c < config.columns; ++c) {
+            synthetic.write_bin<T, endianness>(config.directory, Config::latitude + r, Config::longitude + c);
+        }
+    }
+    if (config.generate) return {};
+
+    std::vector<Result> results;
+    const std::filesystem::path first = config.directory / (std::to_string(Config::latitude) + "_" + std::to_string(Config::longitude) + ".bin");
+    const typename DEM<T, endianness>::Type type = synthetic.type<T, endianness>(Config::latitude, Config::longitude);
+    const float lat_0 = Config::latitude, lon_0 = Config::longitude;
+
+    // deterministic query coordinates
+    std::mt19937_64 generator(42);
+    std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+    std::vector<float> in_latitudes(config.queries), in_longitudes(config.queries);
+    std::vector<float> all_latitudes(config.queries), all_longitudes(config.queries);
+    std::vector<float> border_latitudes(config.queries), border_longitudes(config.queries);
+    for (size_t i = 0; i < config.queries; ++i) {
+        in_latitudes[i] = lat_0 + unit(generator);
+        in_longitudes[i] = lon_0 + unit(generator);
+        all_latitudes[i] = lat_0 + unit(generator) * static_cast<float>(config.rows);
+        all_longitudes[i] = lon_0 + unit(generator) * static_cast<float>(config.columns);
+
+        // alternating sides of the border between the first two tiles of the first row
+        border_latitudes[i] = lat_0 + unit(generator);
+        border_longitudes[i] = lon_0 + 1 + ((i % 2) ? 1 : -1) * 0.001f * unit(generator);
+    }
+
+    volatile float sink = 0;
+    const size_t reads = std::max<size_t>(4, 64 * 1024 * 1024 / (config.size * config.size * sizeof(T)));
+
+    results.push_back(measure("dem_read_heap", reads, 1, [&](size_t) {
+        DEM<T, endianness> dem(type, first);
+        sink = sink + static_cast<float>(dem.at(0, 0));
+    }));
+    results.push_back(measure("dem_read_mapped", reads, 1, [&](size_t) {
+        DEM<T, endianness> dem(type, first, Storage::Mapped);
+        sink = sink + static_cast<float>(dem.at(0, 0));
+    }));
+
+    {
+        DEM<T, endianness> dem(type, first);
+        std::vector<T> altitudes(config.queries);
+        std::vector<float> interpolated(config.queries);
+
+        results.push_back(measure("dem_altitude", config.queries, 64, [&](size_t i) {
+            altitudes[i] = dem.altitude(in_latitudes[i], in_longitudes[i]);
+        }));
+        results.push_back(measure("dem_interpolated_altitude", config.queries, 64, [&](size_t i) {
+            interpolated[i] = dem.interpolated_altitude(in_latitudes[i], in_longitudes[i]);
+        }));
+
+        const size_t batch = 4096;
+        results.push_back(measure("dem_altitude_batch", config.queries / batch, 1, [&](size_t b) {
+            dem.altitude(
+                std::span<const float>(in_latitudes).subspan(b * batch, batch),
+                std::span<const float>(in_longitudes).subspan(b * batch, batch),
+                std::span<T>(altitudes).subspan(b * batch, batch)
+            );
+        }));
+        results.back().scale(batch);
+        results.push_back(measure("dem_interpolated_altitude_batch", config.queries / batch, 1, [&](size_t b) {
+            dem.interpolated_altitude(
+                std::span<const float>(in_latitudes).subspan(b * batch, batch),
+                std::span<const float>(in_longitudes).subspan(b * batch, batch),
+                std::span<float>(interpolated).subspan(b * batch, batch)
+            );
+        }));
+        results.back().scale(batch);
+    }
+
+    {
+        const typename Map<T, endianness>::Grid grid = Map<T, endianness>::initialize(config.directory, config.size, config.size, 1.0f / static_cast<float>(config.size), type.nodata);
+        typename Map<T, endianness>::Options all;
+        all.capacity = static_cast<size_t>(config.rows * config.columns);
+
+        Map<T, endianness> single(grid), cached(grid, all);
+
+        results.push_back(measure("map_in_tile", config.queries, 64, [&](size_t i) {
+            sink = single.interpolated_altitude(in_latitudes[i], in_longitudes[i]);
+        }));
+        results.push_back(measure("map_border_crossing", config.queries / 100, 1, [&](size_t i) {
+            sink = single.interpolated_altitude(border_latitudes[i], border_longitudes[i]);
+        }));
+        results.push_back(measure("map_border_crossing_cached", config.queries, 64, [&](size_t i) {
+            sink = cached.interpolated_altitude(border_latitudes[i], border_longitudes[i]);
+        }));
+        results.push_back(measure("map_random", config.queries, 64, [&](size_t i) {
+            sink = cached.interpolated_altitude(all_latitudes[i], all_longitudes[i]);
+        }));
+
+        std::vector<float> altitudes(config.queries);
+        results.push_back(measure("map_random_batch", 1, 1, [&](size_t) {
+            cached.interpolated_altitude(all_latitudes, all_longitudes, altitudes, config.threads);
+        }));
+        results.back().scale(config.queries);
+    }
+
+    {
+        const std::filesystem::path asc = synthetic.write_asc<T>(config.directory, Config::latitude, Config::longitude);
+        const size_t bytes = static_cast<size_t>(std::filesystem::file_size(asc));
+
+        results.push_back(measure("utility_asc_bin", 1, 1, [&](size_t) {
+            Utility<T, endianness>::create_dem_asc_bin(asc);
+        }));
+        results.back().scale(bytes, "byte");
+        results.push_back(measure("utility_asc_bin_parallel", 1, 1, [&](size_t) {
+            Utility<T, endianness>::create_dem_asc_bin(asc, config.threads);
+        }));
+        results.back().scale(bytes, "byte");
+
+        std::filesystem::remove(asc);
+        std::filesystem::remove(std::filesystem::path(asc).replace_extension(".bin"));
+    }
+
+    return results;
+}
+
+
+template <dem_datatype T>
+std::vector<Result> run(const Config& config) {
+    if (config.endian == "little") return run<T, std::endian::little>(config);
+    return run<T, std::endian::big>(config);
+}
+
+
+int main(int argc, char** argv) {
+    Config config;
+
+    for (int i = 1; i < argc; ++i) {
+        std::string argument = argv[i];
+        auto next = [&]() -> std::string {
+            if (i + 1 >= argc) {
+                std::cerr << "missing value of " << argument << "\n";
+                std::exit(EXIT_FAILURE);
+            }
+            return argv[++i];
+        };
+
+        if (argument == "--size") config.size = std::stoul(next());
+        else if (argument == "--tiles") { config.rows = std::stoi(next()); config.columns = std::stoi(next()); }
+        else if (argument == "--type") config.type = next();
+        else if (argument == "--endian") config.endian = next();
+        else if (argument == "--queries") config.queries = std::stoul(next());
+        else if (argument == "--threads") config.threads = std::stoul(next());
+        else if (argument == "--directory") config.directory = next();
+        else if (argument == "--output") config.output = next();
+        else if (argument == "--generate") config.generate = true;
+        else {
+            std::cerr << "unknown argument " << argument << "\n";
+            return EXIT_FAILURE;
+        }
+    }
+
+    if (config.size == 0 || config.rows < 1 || config.columns < 2 || config.queries < 4096) {
+        std::cerr << "--size must be > 0, --tiles atleast 1 x 2 & --queries atleast 4096\n";
+        return EXIT_FAILURE;
+    }
+
+    try {
+        std::vector<Result> results;
+        if (config.type == "int16") results = run<int16_t>(config);
+        else if (config.type == "int32") results = run<int32_t>(config);
+        else if (config.type == "float") results = run<float>(config);
+        else if (config.type == "double") results = run<double>(config);
+        else {
+            std::cerr << "unsupported --type " << config.type << "\n";
+            return EXIT_FAILURE;
+        }
+
+        if (config.generate) return EXIT_SUCCESS;
+
+        if (config.output.empty()) {
+            std::cout << json(config, results);
+        } else {
+            std::ofstream(config.output) << json(config, results);
+        }
+    } catch (const std::exception& e) {
+        std::cerr << e.what() << "\n";
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,161 @@
+/*
+MIT License
+
+Copyright (c) 2023 Pritam Halder
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated
+documentation files (the "Software"), to deal in the Software without restriction, including without
+limitation the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the
+Software, and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED
+TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF
+CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+DEALINGS IN THE SOFTWARE.
+
+Author : Pritam Halder
+Email : pritamhalder.portfolio@gmail.com
+*/
+
+
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <filesystem>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "MappedFile.hpp"
+#include "Statistics.hpp"
+#include "TileFormat.hpp"
+
+
+
+// DEM values of a memory mapped `.tile` file, decoded one block at a time on access.
+// decoded blocks are kept under a byte budget (least recently used blocks are evicted, atleast one block is kept)
+// and handed out as pinned handles that stay valid after their eviction. every thread reads the last block it
+// used without locking, only switching blocks takes the cache mutex, so a cache can be shared across threads.
+// the bytes of the decoded blocks are counted in `statistics` (if any)
+template <typename T>
+class BlockCache {
+public:
+    using Block = std::shared_ptr<const std::vector<T>>;   // pinned decoded block
+
+
+    BlockCache(const std::filesystem::path& filepath, size_t budget = 0, std::shared_ptr<Statistics> statistics = nullptr)
+        : file(filepath),
+        budget(budget),
+        statistics(std::move(statistics))
+    {
+        this->header = TileFormat::parse(this->file.data(), this->file.size());
+        this->table = TileFormat::table(this->header, this->file.data(), this->file.size());
+
+        if (this->header.sample != TileFormat::sample<T>()) {
+            std::string e = "DEM tile '" + filepath.string() + "' sample type doesn't match the DEM data type";
+            throw std::runtime_error(e);
+        }
+
+        this->blocks.resize(this->table.size());
+        this->positions.resize(this->table.size(), this->order.end());
+    };
+
+
+    BlockCache(const BlockCache&) = delete;
+    BlockCache& operator=(const BlockCache&) = delete;
+    ~BlockCache() = default;
+
+
+    const TileFormat::Header& describe() const {
+        return this->header;
+    };
+
+
+    // DEM value at (`row`, `column`), decoding its block on a miss
+    T at(size_t row, size_t column) const {
+        const size_t edge = this->header.block;
+        const size_t id = (row / edge) * this->header.block_cols() + (column / edge);
+
+        // last block used by this thread (of any cache of `T`), read without locking
+        thread_local Last last;
+        if (last.cache != this->serial || last.id != id) {
+            last = {this->serial, id, this->pin(id)};
+        }
+
+        return (*last.block)[(row % edge) * edge + (column % edge)];
+    };
+
+
+    // pinned handle to the block `id` (row-major over the blocks), decoding it on a miss
+    Block pin(size_t id) const {
+        std::lock_guard<std::mutex> lock(this->mutex);
+
+        if (this->blocks[id]) {
+            this->order.splice(this->order.begin(), this->order, this->positions[id]);
+        } else {
+            this->decode(id);
+        }
+
+        return this->blocks[id];
+    };
+
+
+    // bytes of decoded blocks currently kept in memory (pinned blocks evicted since aren't counted)
+    size_t resident() const {
+        std::lock_guard<std::mutex> lock(this->mutex);
+        return this->bytes;
+    };
+
+
+private:
+    struct Last {
+        uint64_t cache = 0;
+        size_t id = 0;
+        Block block;
+    };
+
+    MappedFile file;
+    TileFormat::Header header;
+    std::vector<TileFormat::Block> table;
+    size_t budget;                                  // max. bytes of decoded blocks (0 = no limit)
+    std::shared_ptr<Statistics> statistics;
+    const uint64_t serial = ++BlockCache::caches;   // tells the caches apart in the per thread last blocks
+
+    mutable std::mutex mutex;
+    mutable std::vector<Block> blocks;                              // decoded blocks by block id (empty = not resident)
+    mutable std::list<size_t> order;                                // ids of the decoded blocks, most recently used first
+    mutable std::vector<std::list<size_t>::iterator> positions;     // position of every decoded block in `order`
+    mutable size_t bytes = 0;
+
+    static inline std::atomic<uint64_t> caches{0};
+
+
+    void decode(size_t id) const {
+        const size_t block_bytes = static_cast<size_t>(this->header.block) * this->header.block * sizeof(T);
+
+        // evict least recently used blocks to make room for the new one, threads still holding them keep them alive
+        while (!this->order.empty() && this->budget != 0 && this->bytes + block_bytes > this->budget) {
+            const size_t lru = this->order.back();
+            this->order.pop_back();
+            this->positions[lru] = this->order.end();
+            this->blocks[lru].reset();
+            this->bytes -= block_bytes;
+        }
+
+        auto values = std::make_shared<std::vector<T>>(static_cast<size_t>(this->header.block) * this->header.block);
+        TileFormat::decode(this->header, this->table[id], this->file.data(), values->data());
+
+        this->blocks[id] = std::move(values);
+        this->order.push_front(id);
+        this->positions[id] = this->order.begin();
+        this->bytes += block_bytes;
+        if (this->statistics) this->statistics->add(Statistics::Bytes, block_bytes);
+    };
+};
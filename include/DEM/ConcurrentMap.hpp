@@ -0,0 +1,444 @@
+/*
+MIT License
+
+Copyright (c) 2023 Pritam Halder
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated
+documentation files (the "Software"), to deal in the Software without restriction, including without
+limitation the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the
+Software, and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED
+TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF
+CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+DEALINGS IN THE SOFTWARE.
+
+Author : Pritam Halder
+Email : pritamhalder.portfolio@gmail.com
+*/
+
+
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <bit>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <filesystem>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "DEM.hpp"
+#include "Map.hpp"
+#include "Statistics.hpp"
+
+
+// thread safe `Map` sharing one set of DEM tiles between all querying threads
+//
+// DEM tiles are immutable once loaded and are published to readers through atomic shared handles.
+// Every query goes through a per thread `Reader` (the map's own queries use one kept per thread), a query
+// on a tile the reader already holds only reads the load epoch & the flag enabling the statistics, the shared
+// handles, the LRU stamps & the shared counters are touched on the reader's misses and once per epoch. A missing
+// tile is loaded by exactly one thread, other threads missing the same tile wait for that load instead of reading
+// the file again.
+template <dem_datatype T, std::endian endianness = std::endian::native>
+class ConcurrentMap {
+public:
+    using Grid = typename Map<T, endianness>::Grid;
+    using Options = typename Map<T, endianness>::Options;
+    using Tile = std::shared_ptr<const DEM<T, endianness>>;
+
+
+    // per thread view of a `ConcurrentMap`, keeps its own small set of tile handles & counts its own queries so that
+    // repeated queries on the same tiles only read shared state. its counts reach `statistics()` on its misses, once
+    // per load epoch, every `flushed` queries, on `flush()` & when it is destroyed. tiles evicted from the map are
+    // released by the reader on its first query in a new load epoch
+    class Reader {
+    public:
+        static constexpr uint64_t flushed = 4096;
+
+
+        Reader(const ConcurrentMap& map, size_t capacity = 2)
+            : map(&map),
+            counters(map.counters),
+            capacity(capacity == 0 ? 1 : capacity)
+        {};
+
+        Reader(Reader&& other) noexcept
+            : map(other.map),
+            counters(std::move(other.counters)),
+            capacity(other.capacity),
+            epoch(other.epoch),
+            tiles(std::move(other.tiles)),
+            pending(std::exchange(other.pending, {}))
+        {};
+
+        Reader& operator=(Reader&& other) noexcept {
+            if (this != &other) {
+                this->flush();
+                this->map = other.map;
+                this->counters = std::move(other.counters);
+                this->capacity = other.capacity;
+                this->epoch = other.epoch;
+                this->tiles = std::move(other.tiles);
+                this->pending = std::exchange(other.pending, {});
+            }
+            return *this;
+        };
+
+        Reader(const Reader& other) = delete;
+        Reader& operator=(const Reader& other) = delete;
+
+        ~Reader() {
+            this->flush();
+        };
+
+
+        T altitude(float latitude, float longitude) {
+            const DEM<T, endianness>* dem = this->tile(latitude, longitude);
+
+            if (dem == nullptr) {
+                return this->served(this->map->nodata);
+            }
+
+            return this->served(dem->altitude(latitude, longitude));
+        };
+
+
+        float interpolated_altitude(float latitude, float longitude) {
+            const DEM<T, endianness>* dem = this->tile(latitude, longitude);
+
+            if (dem == nullptr) {
+                return this->served(static_cast<float>(this->map->nodata));
+            }
+
+            return this->served(dem->interpolated_altitude(latitude, longitude));
+        };
+
+
+        // adds the queries counted by this reader to the counters of the map
+        void flush() {
+            if (!this->counters) return;
+
+            for (size_t i = 0; i < this->pending.size(); ++i) {
+                if (this->pending[i] != 0) this->counters->add(static_cast<Statistics::Counter>(i), this->pending[i]);
+            }
+            this->pending = {};
+        };
+
+
+    private:
+        struct Held {
+            Tile dem;
+            int32_t slot;
+            uint64_t epoch;     // `ConcurrentMap::clock` value this reader last stamped the slot with
+        };
+
+        const ConcurrentMap* map;
+        std::shared_ptr<Statistics> counters;   // outlives the map, readers are kept per thread
+        size_t capacity;
+        uint64_t epoch = 0;                     // `ConcurrentMap::clock` value of the last query
+        std::vector<Held> tiles;                // most recently used first
+        std::array<uint64_t, Statistics::Counters> pending{};   // counts not flushed yet
+
+
+        // counts an answered query
+        template <typename U>
+        U served(U altitude) {
+            if (this->counters->enabled()) {
+                if (altitude == static_cast<U>(this->map->nodata)) ++this->pending[Statistics::Nodata];
+                if (++this->pending[Statistics::Queries] >= flushed) this->flush();
+            }
+            return altitude;
+        };
+
+
+        const DEM<T, endianness>* tile(float latitude, float longitude) {
+            const uint64_t clock = this->map->clock.load(std::memory_order_relaxed);
+
+            // tiles were loaded since the last query, the handles of the tiles evicted meanwhile are dropped
+            // so that they are freed
+            if (clock != this->epoch) {
+                this->epoch = clock;
+                this->flush();
+                std::erase_if(this->tiles, [this](const Held& held) { return this->map->slots[held.slot].load() != held.dem; });
+            }
+
+            for (size_t i = 0; i < this->tiles.size(); ++i) {
+                if (this->tiles[i].dem->bounds.within(latitude, longitude)) {
+                    if (i != 0) std::swap(this->tiles[0], this->tiles[i]);
+
+                    // the LRU stamp is refreshed once per load epoch, not on every query
+                    Held& held = this->tiles[0];
+                    if (held.epoch != clock) {
+                        held.epoch = this->map->stamp(this->map->slots[held.slot]);
+                    }
+
+                    if (this->counters->enabled()) ++this->pending[Statistics::Hits];
+                    return held.dem.get();
+                }
+            }
+
+            this->flush();
+
+            const int32_t slot = this->map->find(latitude, longitude);
+            if (slot < 0) return nullptr;
+
+            const uint64_t epoch = this->map->stamp(this->map->slots[slot]);
+            Tile dem = this->map->fetch(this->map->slots[slot]);
+
+            if (this->tiles.size() == this->capacity) this->tiles.pop_back();
+            this->tiles.insert(this->tiles.begin(), Held{std::move(dem), slot, epoch});
+
+            return this->tiles[0].dem.get();
+        };
+    };
+
+
+    ConcurrentMap(const Grid& grid)
+        : ConcurrentMap(grid, Options{})
+    {};
+
+
+    ConcurrentMap(const Grid& grid, const Options& options) {
+        if (grid.empty()) {
+            throw std::runtime_error("map grid is empty\n");
+        }
+
+        if (options.capacity == 0) {
+            throw std::runtime_error("map capacity must be atleast 1 DEM tile\n");
+        }
+
+        if (options.storage == Storage::Shared && !options.store) {
+            throw std::runtime_error("map shared storage needs a shared store\n");
+        }
+
+        if (options.halo != 0) {
+            throw std::runtime_error("concurrent map doesn't support halos\n");
+        }
+
+        if (options.prefetch != 0) {
+            throw std::runtime_error("concurrent map doesn't support prefetching\n");
+        }
+
+        for (auto m = grid.cbegin(); options.verify && m != grid.cend(); ++m) {
+            std::filesystem::path filepath = m->second.second;
+
+            if (!std::filesystem::exists(filepath)) {
+                std::string e = "'" + filepath.string() + "' file doesn't exists\n";
+                throw std::runtime_error(e);
+            }
+        }
+
+        this->options = options;
+        this->counters->enable(options.statistics);
+        this->nodata = grid.cbegin()->second.first.nodata;
+        this->slots = std::make_unique<Slot[]>(grid.size());
+        this->index.assign(Map<T, endianness>::cells, -1);
+
+        int32_t i = 0;
+        for (auto m = grid.cbegin(); m != grid.cend(); ++m, ++i) {
+            this->slots[i].type = m->second.first;
+            this->slots[i].filepath = m->second.second;
+            this->index[Map<T, endianness>::key(m->first.latitude, m->first.longitude)] = i;
+        }
+    };
+
+
+    ConcurrentMap(const ConcurrentMap& o) = delete;
+    ConcurrentMap& operator=(const ConcurrentMap& o) = delete;
+    ~ConcurrentMap() = default;
+
+
+    // answered through this thread's `Reader` of the map
+    T altitude(float latitude, float longitude) const {
+        return this->reader().altitude(latitude, longitude);
+    };
+
+
+    // answered through this thread's `Reader` of the map
+    float interpolated_altitude(float latitude, float longitude) const {
+        return this->reader().interpolated_altitude(latitude, longitude);
+    };
+
+
+    // shared handle to the DEM tile bounding the coordinate (loaded on a miss), empty if not in the grid
+    Tile tile(float latitude, float longitude) const {
+        const int32_t slot = this->find(latitude, longitude);
+        if (slot < 0) return nullptr;
+
+        this->stamp(this->slots[slot]);
+        return this->fetch(this->slots[slot]);
+    };
+
+
+    // no. of DEM tiles currently kept in memory
+    size_t resident() const {
+        return this->count.load(std::memory_order_relaxed);
+    };
+
+
+    // counters shared by all readers (see `Map::statistics()`), the queries of this thread's reader are flushed
+    // into them first, the other readers add theirs as described by `Reader`
+    Statistics& statistics() const {
+        this->reader().flush();
+        return *this->counters;
+    };
+
+
+private:
+    struct Slot {
+        typename DEM<T, endianness>::Type type;
+        std::filesystem::path filepath;
+
+#if defined(__cpp_lib_atomic_shared_ptr)
+        std::atomic<Tile> dem;
+
+        Tile load() const { return this->dem.load(std::memory_order_acquire); };
+        void store(Tile d) { this->dem.store(std::move(d), std::memory_order_release); };
+#else
+        Tile dem;
+
+        Tile load() const { return std::atomic_load_explicit(&this->dem, std::memory_order_acquire); };
+        void store(Tile d) { std::atomic_store_explicit(&this->dem, std::move(d), std::memory_order_release); };
+#endif
+
+        std::atomic<uint64_t> used{0};  // `ConcurrentMap::clock` epoch of the last access
+        std::mutex loading;
+    };
+
+    Options options;
+    T nodata;
+    std::vector<int32_t> index;             // grid cell to slot, -1 = no DEM tile (immutable after construction)
+    std::unique_ptr<Slot[]> slots;
+    mutable std::atomic<uint64_t> clock{0};         // load epoch, advanced by every tile load
+    mutable std::atomic<size_t> count{0};
+    mutable std::mutex evicting;            // taken only while loading a tile
+    mutable std::vector<size_t> loaded;     // slots holding a DEM tile, guarded by `evicting`
+    std::shared_ptr<Statistics> counters = std::make_shared<Statistics>();
+    const uint64_t id = ++ConcurrentMap::instances; // tells the per thread readers of different maps apart
+
+    static inline std::atomic<uint64_t> instances{0};
+
+
+    // this thread's reader of the map, readers of the last few maps queried by the thread are kept
+    // (the tiles of a destroyed map stay held by a thread until it has queried as many other maps)
+    Reader& reader() const {
+        thread_local std::vector<std::pair<uint64_t, Reader>> readers;  // most recently used first
+
+        if (readers.empty() || readers.front().first != this->id) {
+            auto found = std::find_if(readers.begin(), readers.end(), [this](const auto& r) { return r.first == this->id; });
+
+            if (found != readers.end()) {
+                std::rotate(readers.begin(), found, found + 1);
+            } else {
+                if (readers.size() == 4) readers.pop_back();
+                readers.insert(readers.begin(), {this->id, Reader(*this)});
+            }
+        }
+
+        return readers.front().second;
+    };
+
+
+    // slot of the DEM tile bounding the coordinate, -1 if not in the grid
+    int32_t find(float latitude, float longitude) const {
+        const int32_t k = Map<T, endianness>::key(latitude, longitude);
+        if (k < 0) {
+            std::string e = "invalid coordinates (" + std::to_string(latitude) +  ":" +  std::to_string(longitude) + ")";
+            throw std::runtime_error(e);
+        }
+        if (this->index[k] < 0) {
+            this->counters->add(Statistics::Misses);
+        }
+        return this->index[k];
+    };
+
+
+    // marks the slot used in the current load epoch (stored only when the epoch changed), returns the epoch
+    uint64_t stamp(Slot& slot) const {
+        const uint64_t epoch = this->clock.load(std::memory_order_relaxed);
+        if (slot.used.load(std::memory_order_relaxed) != epoch) slot.used.store(epoch, std::memory_order_relaxed);
+        return epoch;
+    };
+
+
+    // shared handle to the slot's DEM tile, loaded on a miss
+    Tile fetch(Slot& slot) const {
+        Tile dem = slot.load();
+        if (dem) {
+            this->counters->add(Statistics::Hits);
+            return dem;
+        }
+
+        // only one thread loads a missing tile, the others wait for it
+        std::lock_guard<std::mutex> loading(slot.loading);
+
+        dem = slot.load();
+        if (dem) {
+            this->counters->add(Statistics::Hits);
+            return dem;
+        }
+
+        const auto start = std::chrono::steady_clock::now();
+        size_t bytes = 0;
+        dem = std::make_shared<const DEM<T, endianness>>(
+            this->options.storage == Storage::Shared
+            ? this->options.store->template open<T, endianness>(slot.type, slot.filepath, &bytes)
+            : DEM<T, endianness>::open(slot.type, slot.filepath, this->options.storage, this->options.blocks, this->counters)
+        );
+        if (dem->storage() == Storage::Heap) bytes = dem->resident_bytes();
+        this->counters->load(start, bytes);
+        this->admit(slot, dem);
+
+        return dem;
+    };
+
+
+    // publishes a freshly loaded tile, evicting least recently used tiles to keep within the limits
+    void admit(Slot& slot, const Tile& dem) const {
+        std::lock_guard<std::mutex> lock(this->evicting);
+
+        const size_t dem_bytes = dem->resident_bytes();
+
+        // bytes held by the loaded tiles, summed afresh as the decoded blocks of a tile grow after it is published
+        size_t bytes = 0;
+        for (size_t i : this->loaded) bytes += this->slots[i].load()->resident_bytes();
+
+        while (
+            !this->loaded.empty()
+            && (
+                this->loaded.size() >= this->options.capacity
+                || (this->options.budget != 0 && bytes + dem_bytes > this->options.budget)
+            )
+        ) {
+            auto lru = std::min_element(this->loaded.begin(), this->loaded.end(), [this](size_t a, size_t b) {
+                return this->slots[a].used.load(std::memory_order_relaxed) < this->slots[b].used.load(std::memory_order_relaxed);
+            });
+
+            // readers still holding the evicted tile keep it alive until they drop their handle
+            Slot& evicted = this->slots[*lru];
+            bytes -= evicted.load()->resident_bytes();
+            evicted.store(nullptr);
+            this->loaded.erase(lru);
+            this->counters->add(Statistics::Evictions);
+        }
+
+        // the loaded tile is stamped between the epochs, after every earlier access & before every later one
+        const uint64_t epoch = this->clock.fetch_add(2, std::memory_order_relaxed) + 1;
+        slot.used.store(epoch, std::memory_order_relaxed);
+
+        slot.store(dem);
+        this->loaded.push_back(static_cast<size_t>(&slot - this->slots.get()));
+        this->count.store(this->loaded.size(), std::memory_order_relaxed);
+    };
+};
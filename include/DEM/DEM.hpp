@@ -27,13 +27,24 @@ Email : pritamhalder.portfolio@gmail.com
 #include <cmath>
 #include <concepts>
 #include <cstdint>
+#include <cstring>
 #include <filesystem>
 #include <fstream>
+#include <memory>
+#include <span>
 #include <string>
 #include <type_traits>
 #include <vector>
 #include <system_error>
 
+#include "BlockCache.hpp"
+#include "Endian.hpp"
+#include "Interpolation.hpp"
+#include "MappedFile.hpp"
+#include "SIMD.hpp"
+#include "Statistics.hpp"
+#include "TileFormat.hpp"
+
 
 
 struct Coordinate {
@@ -96,7 +107,7 @@ struct Bounds {
     Bounds& operator=(Bounds&& o) noexcept = default;
     ~Bounds() = default;
 
-    bool within(float latitude, float longitude) {
+    bool within(float latitude, float longitude) const {
         if (
             latitude >= this->SW.latitude
             && latitude < this->NE.latitude
@@ -111,6 +122,14 @@ struct Bounds {
 };
 
 
+// terrain sample along a path
+struct Sample {
+    float latitude;
+    float longitude;
+    float altitude;     // interpolated DEM height (`nodata` outside the DEM)
+};
+
+
 template <typename T>
 concept dem_datatype =
     std::is_arithmetic_v<T> &&
@@ -123,6 +142,16 @@ concept dem_datatype =
     !std::is_same_v<T, wchar_t>;
 
 
+// where the DEM values are kept after construction
+enum class Storage {
+    Heap,       // decoded into `DEM::data`
+    Mapped,     // read directly from the memory mapped file (no copy, byte order handled on access)
+    Blocks,     // `.tile` files only : decoded block by block on access, decoded blocks kept under a budget
+                // (headerless `.bin` files have no blocks, `DEM::open()` maps them as `Mapped` instead)
+    Shared      // decoded once into shared memory (native byte order) by the processes attached to a `SharedStore`
+};
+
+
 template <dem_datatype T, std::endian endianness = std::endian::native>
 class DEM {
 private:
@@ -132,64 +161,55 @@ private:
     };
 
 
-    int16_t read(const std::filesystem::path& filepath) {
-        union {T value; uint8_t bytes[sizeof(T)];} t{};
+    std::shared_ptr<const MappedFile> mapping;   // set only for `Storage::Mapped`
+    std::shared_ptr<const BlockCache<T>> blocks; // set only for `Storage::Blocks`
+    std::shared_ptr<const T> shared;             // set only for `Storage::Shared`
+    const T* values = nullptr;                   // first DEM value of any storage but `Storage::Blocks`, see `bind()`
+    float reciprocal = 0;                        // 1 / `cellsize`, the scalar & SIMD index kernels multiply by it, see `locate()`
+    std::vector<T> heap;                         // row-major DEM values (`nrows` x `ncols`) in native byte order, `Storage::Heap` only
 
-        auto serialize = [&t](T value) -> T {
-            t.value = value;
-            if constexpr (((endianness == std::endian::little) ^ (std::endian::native == std::endian::little)) == 0) {
-                return t.value;
-            } else {
-                std::reverse(t.bytes, t.bytes + sizeof(T));
-                return t.value;
-            }
-        };
 
+    int16_t read(const std::filesystem::path& filepath) {
         std::ifstream fp(filepath, std::ios::binary);
-        T t_value = 0;
 
-        if (fp.good() && !fp.eof()) {
-            size_t column_count = 0;
-            std::vector<T> row_data;
+        if (!fp.good()) {
+            return EXIT_FAILURE;
+        }
 
-            while (fp.read(reinterpret_cast<char*>(&t_value), sizeof(T))) {
-                row_data.push_back(serialize(t_value));
-                column_count++;
+        // single bulk read of the whole raster into contiguous row-major storage
+        const size_t count = this->type.nrows * this->type.ncols;
+        this->heap.resize(count);
+        fp.read(reinterpret_cast<char*>(this->heap.data()), static_cast<std::streamsize>(count * sizeof(T)));
 
-                if (column_count == this->type.ncols) {
-                    this->data.push_back(row_data);
-                    column_count = 0;
-                    row_data.clear();
-                }
-            }
-        } else {
-            fp.close();
+        if (static_cast<size_t>(fp.gcount()) != count * sizeof(T)) {
+            this->heap.clear();
             return EXIT_FAILURE;
         }
 
-        fp.close();
+        serialize<T, endianness>(this->heap.data(), count);
+
         return EXIT_SUCCESS;
     };
 
 
-    Index index(float latitude, float longitude) {
+    Index index(float latitude, float longitude) const {
         float dem_latitude_index = 0, dem_longitude_index = 0;
 
         if (this->bounds.within(latitude, longitude)) {
             if (latitude >= this->bounds.SW.latitude) {
                 // Northern Hemisphere
-                dem_latitude_index = (this->bounds.NE.latitude - latitude) / this->type.cellsize;
+                dem_latitude_index = (this->bounds.NE.latitude - latitude) * this->reciprocal;
             } else {
                 // Southern Hemisphere
-                dem_latitude_index = (latitude - this->bounds.SW.latitude) / this->type.cellsize;
+                dem_latitude_index = (latitude - this->bounds.SW.latitude) * this->reciprocal;
             }
 
             if (longitude >= this->bounds.SW.longitude) {
                 // Eastern Hemisphere
-                dem_longitude_index = (longitude - this->bounds.SW.longitude) / this->type.cellsize;
+                dem_longitude_index = (longitude - this->bounds.SW.longitude) * this->reciprocal;
             } else {
                 // Western Hemisphere
-                dem_longitude_index = (this->bounds.NE.longitude - longitude) / this->type.cellsize;
+                dem_longitude_index = (this->bounds.NE.longitude - longitude) * this->reciprocal;
             }
         } else {
             return {
@@ -248,7 +268,6 @@ public:
     };
 
 
-    std::vector<std::vector<T>> data;
     Type type;
     Bounds bounds;
 
@@ -256,36 +275,296 @@ public:
     DEM() = default;
 
 
-    DEM(const Type& type, const std::filesystem::path& filepath) {
+    DEM(const Type& type, const std::filesystem::path& filepath, Storage storage = Storage::Heap) {
+        if (storage == Storage::Shared) {
+            throw std::runtime_error("shared DEM values are opened through a SharedStore");
+        }
+
+        this->type = type;
+        this->locate();
+
+        if (!std::filesystem::exists(filepath)) {
+            std::string e = "DEM file '" + filepath.string() + "' not found";
+            throw std::runtime_error(e);
+        }
+
+        if (storage == Storage::Blocks) {
+            std::string e = "DEM file '" + filepath.string() + "' has no blocks, only `.tile` files are read block by block";
+            throw std::runtime_error(e);
+        }
+
+        if (storage == Storage::Mapped) {
+            // map the DEM file (sets: this->mapping)
+            this->mapping = std::make_shared<const MappedFile>(filepath);
+
+            if (this->mapping->size() < this->type.nrows * this->type.ncols * sizeof(T)) {
+                this->mapping.reset();
+                std::string e = "failed to read DEM data from '" + filepath.string() + "'";
+                throw std::runtime_error(e);
+            }
+        } else {
+            // read the DEM file (sets: this->heap)
+            if (this->read(filepath) != EXIT_SUCCESS) {
+                std::string e = "failed to read DEM data from '" + filepath.string() + "'";
+                throw std::runtime_error(e);
+            }
+        }
+
+        this->bind();
+    };
+
+
+    // DEM over values already in memory (row-major, `nrows` x `ncols`, native byte order)
+    DEM(const Type& type, std::vector<T> data) {
+        if (data.size() != type.nrows * type.ncols) {
+            throw std::runtime_error("DEM data size doesn't match the DEM dimensions");
+        }
+
         this->type = type;
-        this->bounds = {
-            {this->type.yllcorner + (this->type.cellsize * this->type.nrows), this->type.xllcorner},
-            {this->type.yllcorner + (this->type.cellsize * this->type.nrows), this->type.xllcorner + (this->type.cellsize * this->type.ncols)},
-            {this->type.yllcorner, this->type.xllcorner},
-            {this->type.yllcorner, this->type.xllcorner + (this->type.cellsize * this->type.ncols)}
+        this->locate();
+        this->heap = std::move(data);
+        this->bind();
+    };
+
+
+    // DEM over values kept alive by `values` (row-major, `nrows` x `ncols`, native byte order), see `SharedStore`
+    DEM(const Type& type, std::shared_ptr<const T> values) {
+        if (!values) {
+            throw std::runtime_error("DEM values are missing");
+        }
+
+        this->type = type;
+        this->locate();
+        this->shared = std::move(values);
+        this->bind();
+    };
+
+
+    // DEM from a self describing `.tile` file (geometry, sample type & byte order are read from its header),
+    // `Storage::Blocks` decodes blocks on access keeping atmost `budget` bytes of decoded blocks (0 = no limit),
+    // otherwise the whole file is decoded onto the heap
+    explicit DEM(const std::filesystem::path& filepath, Storage storage = Storage::Heap, size_t budget = 0, std::shared_ptr<Statistics> statistics = nullptr) {
+        if (storage == Storage::Shared) {
+            throw std::runtime_error("shared DEM values are opened through a SharedStore");
+        }
+
+        if (storage != Storage::Blocks) {
+            this->load(filepath, nullptr);
+            this->bind();
+            return;
+        }
+
+        if (!std::filesystem::exists(filepath)) {
+            std::string e = "DEM file '" + filepath.string() + "' not found";
+            throw std::runtime_error(e);
+        }
+
+        this->blocks = std::make_shared<const BlockCache<T>>(filepath, budget, std::move(statistics));
+        this->bind();
+
+        const TileFormat::Header& header = this->blocks->describe();
+        this->type = {
+            static_cast<size_t>(header.nrows),
+            static_cast<size_t>(header.ncols),
+            static_cast<float>(header.yllcorner),
+            static_cast<float>(header.xllcorner),
+            static_cast<float>(header.cellsize),
+            static_cast<T>(header.nodata)
         };
+        this->locate();
+    };
+
+
+    // part of a `.tile` file covering `window`, only the blocks intersecting the window are read,
+    // `type` & `bounds` are rebased onto the cells read
+    DEM(const std::filesystem::path& filepath, const Bounds& window) {
+        this->load(filepath, &window);
+        this->bind();
+    };
+
+
+    // part of a headerless `.bin` file described by `type` covering `window`, only the row spans inside the window
+    // are read (one positioned read per row, a single read when the window spans every column),
+    // `type` & `bounds` are rebased onto the cells read
+    DEM(const Type& type, const std::filesystem::path& filepath, const Bounds& window) {
+        this->type = type;
+        this->locate();
 
         if (!std::filesystem::exists(filepath)) {
             std::string e = "DEM file '" + filepath.string() + "' not found";
             throw std::runtime_error(e);
         }
 
-        // read the DEM file (sets: this->data)
-        if (this->read(filepath) != EXIT_SUCCESS) {
+        const Cells cells = this->cells(window, filepath);
+        const size_t nrows = cells.r1 - cells.r0, ncols = cells.c1 - cells.c0;
+        const size_t row_bytes = this->type.ncols * sizeof(T);
+
+        std::ifstream fp(filepath, std::ios::binary);
+        if (!fp.good() || std::filesystem::file_size(filepath) < this->type.nrows * row_bytes) {
             std::string e = "failed to read DEM data from '" + filepath.string() + "'";
             throw std::runtime_error(e);
         }
+
+        this->heap.resize(nrows * ncols);
+        char* out = reinterpret_cast<char*>(this->heap.data());
+
+        if (ncols == this->type.ncols) {
+            fp.seekg(static_cast<std::streamoff>(cells.r0 * row_bytes));
+            fp.read(out, static_cast<std::streamsize>(nrows * row_bytes));
+        } else {
+            for (size_t r = cells.r0; r < cells.r1 && fp.good(); ++r) {
+                fp.seekg(static_cast<std::streamoff>(r * row_bytes + cells.c0 * sizeof(T)));
+                fp.read(out + (r - cells.r0) * ncols * sizeof(T), static_cast<std::streamsize>(ncols * sizeof(T)));
+            }
+        }
+
+        if (!fp.good()) {
+            this->heap.clear();
+            std::string e = "failed to read DEM data from '" + filepath.string() + "'";
+            throw std::runtime_error(e);
+        }
+
+        serialize<T, endianness>(this->heap.data(), this->heap.size());
+        this->rebase(cells);
+        this->bind();
+    };
+
+
+    // part of a `.tile` or `.bin` file covering `window` (`type` describes `.bin` files only)
+    static DEM open(const Type& type, const std::filesystem::path& filepath, const Bounds& window) {
+        if (filepath.extension() == ".tile") {
+            return DEM(filepath, window);
+        }
+        return DEM(type, filepath, window);
     };
 
 
-    DEM(const DEM& other) = default;
-    DEM& operator=(const DEM& other) = default;
-    DEM(DEM&& other) noexcept = default;
-    DEM& operator=(DEM&& other) noexcept = default;
+    // DEM from either a `.tile` file (`type` is ignored, `budget` applies to `Storage::Blocks`, `Storage::Mapped`
+    // decodes onto the heap) or a headerless `.bin` file described by `type` (`Storage::Blocks` maps the file),
+    // `statistics` counts the blocks decoded with `Storage::Blocks`
+    static DEM open(const Type& type, const std::filesystem::path& filepath, Storage storage = Storage::Heap, size_t budget = 0, std::shared_ptr<Statistics> statistics = nullptr) {
+        if (storage == Storage::Shared) {
+            throw std::runtime_error("shared DEM values are opened through a SharedStore");
+        }
+        if (filepath.extension() == ".tile") {
+            return DEM(filepath, storage, budget, std::move(statistics));
+        }
+        return DEM(type, filepath, storage == Storage::Blocks ? Storage::Mapped : storage);
+    };
+
+
+    // copies point to their own `data()`
+    DEM(const DEM& other)
+        : mapping(other.mapping),
+        blocks(other.blocks),
+        shared(other.shared),
+        reciprocal(other.reciprocal),
+        heap(other.heap),
+        type(other.type),
+        bounds(other.bounds)
+    {
+        this->bind();
+    };
+
+    DEM& operator=(const DEM& other) {
+        if (this != &other) {
+            this->mapping = other.mapping;
+            this->blocks = other.blocks;
+            this->shared = other.shared;
+            this->heap = other.heap;
+            this->type = other.type;
+            this->bounds = other.bounds;
+            this->reciprocal = other.reciprocal;
+            this->bind();
+        }
+        return *this;
+    };
+
+    DEM(DEM&& other) noexcept
+        : mapping(std::move(other.mapping)),
+        blocks(std::move(other.blocks)),
+        shared(std::move(other.shared)),
+        reciprocal(other.reciprocal),
+        heap(std::move(other.heap)),
+        type(std::move(other.type)),
+        bounds(std::move(other.bounds))
+    {
+        this->bind();
+        other.bind();
+    };
+
+    DEM& operator=(DEM&& other) noexcept {
+        if (this != &other) {
+            this->mapping = std::move(other.mapping);
+            this->blocks = std::move(other.blocks);
+            this->shared = std::move(other.shared);
+            this->heap = std::move(other.heap);
+            this->type = std::move(other.type);
+            this->bounds = std::move(other.bounds);
+            this->reciprocal = other.reciprocal;
+            this->bind();
+            other.bind();
+        }
+        return *this;
+    };
+
     ~DEM() = default;
 
 
-    T altitude(float latitude, float longitude) {
+    Storage storage() const {
+        if (this->blocks) return Storage::Blocks;
+        if (this->shared) return Storage::Shared;
+        return this->mapping ? Storage::Mapped : Storage::Heap;
+    };
+
+
+    // row-major DEM values (`nrows` x `ncols`) in native byte order, empty unless the storage is `Storage::Heap`
+    // (read only : `at()` & the queries read through a pointer bound to them)
+    const std::vector<T>& data() const {
+        return this->heap;
+    };
+
+
+    // bounds of the DEM values described by `type`
+    static Bounds locate(const Type& type) {
+        return {
+            {type.yllcorner + (type.cellsize * type.nrows), type.xllcorner},
+            {type.yllcorner + (type.cellsize * type.nrows), type.xllcorner + (type.cellsize * type.ncols)},
+            {type.yllcorner, type.xllcorner},
+            {type.yllcorner, type.xllcorner + (type.cellsize * type.ncols)}
+        };
+    };
+
+
+    // bytes of memory holding the DEM values : the values on the heap, the length of the mapped file,
+    // the decoded blocks currently kept or the shared values
+    size_t resident_bytes() const {
+        if (this->blocks) return this->blocks->resident();
+        if (this->shared) return this->type.nrows * this->type.ncols * sizeof(T);
+        if (this->mapping) return this->mapping->size();
+        return this->heap.size() * sizeof(T);
+    };
+
+
+    // DEM value at (`row`, `column`) in native byte order, irrespective of the storage
+    // (a single load from `values` unless the values are decoded block by block)
+    T at(size_t row, size_t column) const {
+        if (this->blocks) [[unlikely]] {
+            return this->blocks->at(row, column);
+        }
+
+        const T value = this->values[row * this->type.ncols + column];
+
+        // only mapped files are kept in the byte order of the file
+        if constexpr (endianness != std::endian::native) {
+            if (this->mapping) return byteswap(value);
+        }
+
+        return value;
+    };
+
+
+    T altitude(float latitude, float longitude) const {
         Index rc = this->index(latitude, longitude);
 
         if (rc.row == this->type.nodata || rc.column == this->type.nodata) {
@@ -298,33 +577,368 @@ public:
         r = r == this->type.nrows ? r - 1 : r;
         c = c == this->type.ncols ? c - 1 : c;
 
-        T altitude = this->data[r][c];
+        T altitude = this->at(r, c);
 
         return altitude;
     };
 
 
-    float interpolated_altitude(float latitude, float longitude) {
+    // interpolated altitude with the `Kernel` policy (`Nearest`, `Bilinear` or `Bicubic`, see Interpolation.hpp)
+    template <typename Kernel = Bilinear>
+    float interpolated_altitude(float latitude, float longitude) const {
         Index rc = this->index(latitude, longitude);
 
         if (rc.row == this->type.nodata || rc.column == this->type.nodata) {
             return this->type.nodata;
         }
 
-        size_t r = static_cast<size_t>(rc.row);
-        size_t c = static_cast<size_t>(rc.column);
+        return this->interpolate<Kernel>(rc.row, rc.column);
+    };
 
-        float del_latitude = std::min(rc.row, static_cast<float>(this->type.nrows-1)) - r;
-        float del_longitude = std::min(rc.column, static_cast<float>(this->type.ncols-1)) - c;
 
-        size_t next_r = (r == this->type.nrows-1) ? r : r + 1;
-        size_t next_c = (c == this->type.ncols-1) ? c : c + 1;
+    // no. of evenly spaced samples (both ends included) covering the segment `from` -> `to` with atmost `step`
+    // (in the units of `cellsize`) between them, `step` = 0 samples every DEM cell crossed by the segment
+    size_t samples(const Coordinate& from, const Coordinate& to, float step = 0) const {
+        const float del_latitude = std::abs(to.latitude - from.latitude);
+        const float del_longitude = std::abs(to.longitude - from.longitude);
 
-        float altitude =   (1-del_latitude) * (1-del_longitude) * this->data[r][c] +
-                            del_longitude * (1-del_latitude) * this->data[r][next_c] +
-                            (1-del_longitude) * del_latitude * this->data[next_r][c] +
-                            del_latitude * del_longitude * this->data[next_r][next_c];
+        float length = step > 0
+            ? std::sqrt(del_latitude * del_latitude + del_longitude * del_longitude) / step
+            : std::max(del_latitude, del_longitude) / this->type.cellsize;
 
-        return altitude;
+        return static_cast<size_t>(std::ceil(length)) + 1;
+    };
+
+
+    // terrain profile along the segment `from` -> `to` (see `samples()` for `step`)
+    std::vector<Sample> profile(const Coordinate& from, const Coordinate& to, float step = 0) const {
+        std::vector<Sample> path(this->samples(from, to, step));
+        this->trace(from, to, path.size(), 0, path);
+        return path;
+    };
+
+
+    // samples [`first`, `first` + `path.size()`) of the `count` evenly spaced samples of the segment `from` -> `to`,
+    // walks the raster cell by cell (DDA) with incremental indices, the 4 DEM values around a cell are fetched once
+    void trace(const Coordinate& from, const Coordinate& to, size_t count, size_t first, std::span<Sample> path) const {
+        const float steps = count > 1 ? static_cast<float>(count - 1) : 1.0f;
+        const float del_latitude = (to.latitude - from.latitude) / steps;
+        const float del_longitude = (to.longitude - from.longitude) / steps;
+        const float del_row = -del_latitude * this->reciprocal;
+        const float del_column = del_longitude * this->reciprocal;
+        const float row_0 = (this->bounds.NE.latitude - from.latitude) * this->reciprocal;
+        const float column_0 = (from.longitude - this->bounds.SW.longitude) * this->reciprocal;
+
+        size_t r = SIZE_MAX, c = SIZE_MAX;
+        float v00 = 0, v01 = 0, v10 = 0, v11 = 0;
+
+        for (size_t i = 0; i < path.size(); ++i) {
+            const float k = static_cast<float>(first + i);
+            Sample& sample = path[i];
+            sample.latitude = from.latitude + del_latitude * k;
+            sample.longitude = from.longitude + del_longitude * k;
+
+            if (!this->bounds.within(sample.latitude, sample.longitude)) {
+                sample.altitude = this->type.nodata;
+                continue;
+            }
+
+            const float row = std::max(row_0 + del_row * k, 0.0f);
+            const float column = std::max(column_0 + del_column * k, 0.0f);
+
+            size_t cell_r = std::min(static_cast<size_t>(row), this->type.nrows-1);
+            size_t cell_c = std::min(static_cast<size_t>(column), this->type.ncols-1);
+
+            if (cell_r != r || cell_c != c) {
+                r = cell_r;
+                c = cell_c;
+
+                size_t next_r = (r == this->type.nrows-1) ? r : r + 1;
+                size_t next_c = (c == this->type.ncols-1) ? c : c + 1;
+
+                v00 = this->at(r, c);
+                v01 = this->at(r, next_c);
+                v10 = this->at(next_r, c);
+                v11 = this->at(next_r, next_c);
+            }
+
+            float del_r = std::min(row, static_cast<float>(this->type.nrows-1)) - r;
+            float del_c = std::min(column, static_cast<float>(this->type.ncols-1)) - c;
+
+            sample.altitude =   (1-del_r) * (1-del_c) * v00 +
+                                del_c * (1-del_r) * v01 +
+                                (1-del_c) * del_r * v10 +
+                                del_r * del_c * v11;
+        }
+    };
+
+
+    // whether the point `observer_height` above the terrain at `observer` sees the point `target_height` above the
+    // terrain at `target` (straight sight line over a flat earth, samples without DEM data never block the sight line)
+    bool line_of_sight(const Coordinate& observer, float observer_height, const Coordinate& target, float target_height, float step = 0) const {
+        return visible(this->profile(observer, target, step), observer_height, target_height, this->type.nodata);
+    };
+
+
+    // line of sight over an already sampled terrain profile (see `line_of_sight()`)
+    static bool visible(const std::vector<Sample>& profile, float observer_height, float target_height, T nodata) {
+        if (profile.size() < 3) return true;
+
+        const Sample& observer = profile.front();
+        const Sample& target = profile.back();
+        if (observer.altitude == nodata || target.altitude == nodata) return true;
+
+        const float start = observer.altitude + observer_height;
+        const float slope = ((target.altitude + target_height) - start) / static_cast<float>(profile.size() - 1);
+
+        for (size_t i = 1; i + 1 < profile.size(); ++i) {
+            if (profile[i].altitude == nodata) continue;
+            if (profile[i].altitude > start + slope * static_cast<float>(i)) return false;
+        }
+
+        return true;
+    };
+
+
+    // batch form of `altitude()` : altitudes[i] = altitude(latitudes[i], longitudes[i])
+    void altitude(std::span<const float> latitudes, std::span<const float> longitudes, std::span<T> altitudes) const {
+        if (latitudes.size() != longitudes.size() || latitudes.size() != altitudes.size()) {
+            throw std::runtime_error("batch altitude spans differ in size");
+        }
+
+        alignas(64) float rows[batch_size], columns[batch_size];
+
+        this->access([&](auto at) {
+            for (size_t offset = 0; offset < latitudes.size(); offset += batch_size) {
+                const size_t count = std::min(batch_size, latitudes.size() - offset);
+                this->batch_index(latitudes.data() + offset, longitudes.data() + offset, count, rows, columns);
+
+                T* out = altitudes.data() + offset;
+                for (size_t i = 0; i < count; ++i) {
+                    if (rows[i] < 0) {
+                        out[i] = this->type.nodata;
+                        continue;
+                    }
+
+                    size_t r = static_cast<size_t>(std::round(rows[i]));
+                    size_t c = static_cast<size_t>(std::round(columns[i]));
+
+                    r = r == this->type.nrows ? r - 1 : r;
+                    c = c == this->type.ncols ? c - 1 : c;
+
+                    out[i] = at(r, c);
+                }
+            }
+        });
+    };
+
+
+    // batch form of `interpolated_altitude()` : altitudes[i] = interpolated_altitude(latitudes[i], longitudes[i])
+    void interpolated_altitude(std::span<const float> latitudes, std::span<const float> longitudes, std::span<float> altitudes) const {
+        if (latitudes.size() != longitudes.size() || latitudes.size() != altitudes.size()) {
+            throw std::runtime_error("batch altitude spans differ in size");
+        }
+
+        alignas(64) float rows[batch_size], columns[batch_size];
+        alignas(64) float v00[batch_size], v01[batch_size], v10[batch_size], v11[batch_size];
+
+        this->access([&](auto at) {
+            for (size_t offset = 0; offset < latitudes.size(); offset += batch_size) {
+                const size_t count = std::min(batch_size, latitudes.size() - offset);
+                this->batch_index(latitudes.data() + offset, longitudes.data() + offset, count, rows, columns);
+
+                // gather the neighbours, `rows` & `columns` are reused for the fractional offsets
+                for (size_t i = 0; i < count; ++i) {
+                    if (rows[i] < 0) {
+                        v00[i] = v01[i] = v10[i] = v11[i] = 0;
+                        continue;
+                    }
+
+                    size_t r = std::min(static_cast<size_t>(rows[i]), this->type.nrows-1);
+                    size_t c = std::min(static_cast<size_t>(columns[i]), this->type.ncols-1);
+
+                    float del_latitude = std::min(rows[i], static_cast<float>(this->type.nrows-1)) - r;
+                    float del_longitude = std::min(columns[i], static_cast<float>(this->type.ncols-1)) - c;
+
+                    size_t next_r = (r == this->type.nrows-1) ? r : r + 1;
+                    size_t next_c = (c == this->type.ncols-1) ? c : c + 1;
+
+                    v00[i] = at(r, c);
+                    v01[i] = at(r, next_c);
+                    v10[i] = at(next_r, c);
+                    v11[i] = at(next_r, next_c);
+
+                    rows[i] = del_latitude;
+                    columns[i] = del_longitude;
+                }
+
+                float* out = altitudes.data() + offset;
+                SIMD::blend(v00, v01, v10, v11, rows, columns, count, out);
+
+                // rows of the points outside the DEM are still marked as -1
+                for (size_t i = 0; i < count; ++i) {
+                    if (rows[i] < 0) out[i] = this->type.nodata;
+                }
+            }
+        });
+    };
+
+
+private:
+    static constexpr size_t batch_size = 256;
+
+
+    // points `values` at the DEM values of the storage
+    void bind() {
+        if (this->blocks) this->values = nullptr;
+        else if (this->shared) this->values = this->shared.get();
+        else if (this->mapping) this->values = reinterpret_cast<const T*>(this->mapping->data());
+        else this->values = this->heap.data();
+    };
+
+
+    // runs `body(at)` with `at(row, column)` reading the storage resolved once, for the loops over many DEM values
+    template <typename Body>
+    void access(Body body) const {
+        if (this->blocks) {
+            const BlockCache<T>* blocks = this->blocks.get();
+            body([blocks](size_t r, size_t c) { return blocks->at(r, c); });
+            return;
+        }
+
+        const T* values = this->values;
+        const size_t ncols = this->type.ncols;
+
+        if constexpr (endianness != std::endian::native) {
+            if (this->mapping) {
+                body([values, ncols](size_t r, size_t c) { return byteswap(values[r * ncols + c]); });
+                return;
+            }
+        }
+
+        body([values, ncols](size_t r, size_t c) { return values[r * ncols + c]; });
+    };
+
+
+    // sets `bounds` & `reciprocal` from `type`
+    void locate() {
+        this->reciprocal = this->type.cellsize != 0 ? 1.0f / this->type.cellsize : 0;
+        this->bounds = locate(this->type);
+    };
+
+
+    // reads the `.tile` file (all of it, or the blocks intersecting `window`)
+    void load(const std::filesystem::path& filepath, const Bounds* window) {
+        if (!std::filesystem::exists(filepath)) {
+            std::string e = "DEM file '" + filepath.string() + "' not found";
+            throw std::runtime_error(e);
+        }
+
+        // only the pages of the blocks decoded are read from the file
+        MappedFile file(filepath);
+        const TileFormat::Header header = TileFormat::parse(file.data(), file.size());
+        const std::vector<TileFormat::Block> blocks = TileFormat::table(header, file.data(), file.size());
+
+        if (header.sample != TileFormat::sample<T>()) {
+            std::string e = "DEM tile '" + filepath.string() + "' sample type doesn't match the DEM data type";
+            throw std::runtime_error(e);
+        }
+
+        this->type = {
+            static_cast<size_t>(header.nrows),
+            static_cast<size_t>(header.ncols),
+            static_cast<float>(header.yllcorner),
+            static_cast<float>(header.xllcorner),
+            static_cast<float>(header.cellsize),
+            static_cast<T>(header.nodata)
+        };
+        this->locate();
+
+        const Cells cells = window ? this->cells(*window, filepath) : Cells{0, this->type.nrows, 0, this->type.ncols};
+        const size_t r0 = cells.r0, r1 = cells.r1, c0 = cells.c0, c1 = cells.c1;
+
+        const size_t edge = header.block;
+        const size_t nrows = r1 - r0, ncols = c1 - c0;
+        this->heap.resize(nrows * ncols);
+        std::vector<T> block(edge * edge);
+
+        for (size_t br = r0 / edge; br <= (r1 - 1) / edge; ++br) {
+            for (size_t bc = c0 / edge; bc <= (c1 - 1) / edge; ++bc) {
+                TileFormat::decode(header, blocks[br * header.block_cols() + bc], file.data(), block.data());
+
+                const size_t row_start = std::max(r0, br * edge), row_end = std::min(r1, (br + 1) * edge);
+                const size_t col_start = std::max(c0, bc * edge), col_end = std::min(c1, (bc + 1) * edge);
+
+                for (size_t r = row_start; r < row_end; ++r) {
+                    std::memcpy(
+                        this->heap.data() + (r - r0) * ncols + (col_start - c0),
+                        block.data() + (r - br * edge) * edge + (col_start - bc * edge),
+                        (col_end - col_start) * sizeof(T)
+                    );
+                }
+            }
+        }
+
+        if (window) this->rebase(cells);
+    };
+
+
+    // cell range [r0, r1) x [c0, c1)
+    struct Cells {
+        size_t r0;
+        size_t r1;
+        size_t c0;
+        size_t c1;
+    };
+
+
+    // cells covering `window`
+    Cells cells(const Bounds& window, const std::filesystem::path& filepath) const {
+        auto cell = [this](float offset, size_t limit, bool up) {
+            float cells = offset / this->type.cellsize;
+            cells = up ? std::ceil(cells) : std::floor(cells);
+            return static_cast<size_t>(std::clamp(cells, 0.0f, static_cast<float>(limit)));
+        };
+
+        Cells cells = {
+            cell(this->bounds.NE.latitude - window.NE.latitude, this->type.nrows, false),
+            cell(this->bounds.NE.latitude - window.SW.latitude, this->type.nrows, true),
+            cell(window.SW.longitude - this->bounds.SW.longitude, this->type.ncols, false),
+            cell(window.NE.longitude - this->bounds.SW.longitude, this->type.ncols, true)
+        };
+
+        if (cells.r0 >= cells.r1 || cells.c0 >= cells.c1) {
+            std::string e = "window doesn't intersect DEM tile '" + filepath.string() + "'";
+            throw std::runtime_error(e);
+        }
+
+        return cells;
+    };
+
+
+    // rebases `type` & `bounds` onto `cells` (the values read)
+    void rebase(const Cells& cells) {
+        this->type.yllcorner += this->type.cellsize * static_cast<float>(this->type.nrows - cells.r1);
+        this->type.xllcorner += this->type.cellsize * static_cast<float>(cells.c0);
+        this->type.nrows = cells.r1 - cells.r0;
+        this->type.ncols = cells.c1 - cells.c0;
+        this->locate();
+    };
+
+
+    // `Kernel` interpolation at a fractional (row, column) index inside the raster
+    template <typename Kernel = Bilinear>
+    float interpolate(float row, float column) const {
+        return Kernel::sample(row, column, this->type.nrows, this->type.ncols, [this](size_t r, size_t c) { return this->at(r, c); });
+    };
+
+
+    void batch_index(const float* latitudes, const float* longitudes, size_t count, float* rows, float* columns) const {
+        SIMD::index(
+            latitudes, longitudes, count,
+            this->bounds.NE.latitude, this->bounds.SW.latitude, this->bounds.SW.longitude, this->bounds.NE.longitude,
+            this->reciprocal,
+            rows, columns
+        );
     };
 };
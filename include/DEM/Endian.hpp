@@ -0,0 +1,94 @@
+/*
+MIT License
+
+Copyright (c) 2023 Pritam Halder
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated
+documentation files (the "Software"), to deal in the Software without restriction, including without
+limitation the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the
+Software, and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED
+TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF
+CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+DEALINGS IN THE SOFTWARE.
+
+Author : Pritam Halder
+Email : pritamhalder.portfolio@gmail.com
+*/
+
+
+#pragma once
+
+#include <algorithm>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
+
+
+
+// reverses the byte order of a single value
+template <typename T>
+inline T byteswap(T value) {
+    if constexpr (sizeof(T) == 2) {
+        uint16_t u = std::bit_cast<uint16_t>(value);
+        u = static_cast<uint16_t>((u >> 8) | (u << 8));
+        return std::bit_cast<T>(u);
+    } else if constexpr (sizeof(T) == 4) {
+        uint32_t u = std::bit_cast<uint32_t>(value);
+        u = ((u & 0x000000FFu) << 24) | ((u & 0x0000FF00u) << 8) | ((u & 0x00FF0000u) >> 8) | ((u & 0xFF000000u) >> 24);
+        return std::bit_cast<T>(u);
+    } else if constexpr (sizeof(T) == 8) {
+        uint64_t u = std::bit_cast<uint64_t>(value);
+        u = ((u & 0x00000000000000FFull) << 56) | ((u & 0x000000000000FF00ull) << 40)
+            | ((u & 0x0000000000FF0000ull) << 24) | ((u & 0x00000000FF000000ull) << 8)
+            | ((u & 0x000000FF00000000ull) >> 8) | ((u & 0x0000FF0000000000ull) >> 24)
+            | ((u & 0x00FF000000000000ull) >> 40) | ((u & 0xFF00000000000000ull) >> 56);
+        return std::bit_cast<T>(u);
+    } else {
+        union {T value; uint8_t bytes[sizeof(T)];} t{};
+        t.value = value;
+        std::reverse(t.bytes, t.bytes + sizeof(T));
+        return t.value;
+    }
+}
+
+
+// reverses the byte order of `count` values in place
+// (swaps fixed size blocks of unsigned integers, which the compiler vectorizes)
+template <typename T>
+inline void byteswap(T* values, size_t count) {
+    size_t i = 0;
+
+    if constexpr (sizeof(T) == 2 || sizeof(T) == 4 || sizeof(T) == 8) {
+        using U = std::conditional_t<sizeof(T) == 2, uint16_t, std::conditional_t<sizeof(T) == 4, uint32_t, uint64_t>>;
+        constexpr size_t lanes = 64 / sizeof(T);
+        U block[lanes];
+
+        for (const size_t blocks = count - count % lanes; i < blocks; i += lanes) {
+            std::memcpy(block, values + i, sizeof(block));
+            for (size_t j = 0; j < lanes; ++j) {
+                block[j] = byteswap(block[j]);
+            }
+            std::memcpy(values + i, block, sizeof(block));
+        }
+    }
+
+    for (; i < count; ++i) {
+        values[i] = byteswap(values[i]);
+    }
+}
+
+
+// converts `count` values between `endianness` and native byte order in place
+template <typename T, std::endian endianness>
+inline void serialize(T* values, size_t count) {
+    if constexpr (endianness != std::endian::native) {
+        byteswap(values, count);
+    }
+}
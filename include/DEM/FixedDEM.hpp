@@ -0,0 +1,147 @@
+/*
+MIT License
+
+Copyright (c) 2023 Pritam Halder
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated
+documentation files (the "Software"), to deal in the Software without restriction, including without
+limitation the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the
+Software, and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED
+TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF
+CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+DEALINGS IN THE SOFTWARE.
+
+Author : Pritam Halder
+Email : pritamhalder.portfolio@gmail.com
+*/
+
+
+
+#pragma once
+
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <memory>
+#include <span>
+#include <stdexcept>
+#include <string>
+
+#include "DEM.hpp"
+#include "Interpolation.hpp"
+
+
+
+// DEM tile with its geometry pinned at compile time : `Rows` x `Cols` values `1 / CellsPerDegree` degree apart,
+// interpolated with the `Kernel` policy (see Interpolation.hpp). the cell index is a multiply by the constant
+// `CellsPerDegree` instead of a division by `Type::cellsize` and every bound & edge clamp is a constant.
+// the values are shared with the DEM it is made from, which has to keep them on the heap (`Storage::Heap`).
+template <dem_datatype T, size_t Rows, size_t Cols, size_t CellsPerDegree, typename Kernel = Bilinear, std::endian endianness = std::endian::native>
+class FixedDEM {
+public:
+    static constexpr size_t nrows = Rows;
+    static constexpr size_t ncols = Cols;
+    static constexpr float cellsize = 1.0f / static_cast<float>(CellsPerDegree);
+
+
+    FixedDEM(std::shared_ptr<const DEM<T, endianness>> dem)
+        : source(std::move(dem))
+    {
+        if (!this->source || this->source->storage() != Storage::Heap || this->source->data().size() != Rows * Cols) {
+            throw std::runtime_error("fixed DEM needs a DEM with its values on the heap");
+        }
+
+        const typename DEM<T, endianness>::Type& type = this->source->type;
+        if (type.nrows != Rows || type.ncols != Cols || std::abs(type.cellsize * static_cast<float>(CellsPerDegree) - 1.0f) > 1e-4f) {
+            std::string e = "DEM geometry (" + std::to_string(type.nrows) + " x " + std::to_string(type.ncols) + ", " + std::to_string(type.cellsize) + ") doesn't match the fixed DEM geometry";
+            throw std::runtime_error(e);
+        }
+
+        this->values = this->source->data().data();
+        this->bounds = this->source->bounds;
+        this->nodata = type.nodata;
+    };
+
+
+    FixedDEM(const typename DEM<T, endianness>::Type& type, const std::filesystem::path& filepath)
+        : FixedDEM(std::make_shared<const DEM<T, endianness>>(type, filepath))
+    {};
+
+
+    const DEM<T, endianness>& dem() const {
+        return *this->source;
+    };
+
+
+    T altitude(float latitude, float longitude) const {
+        float row, column;
+        if (!this->index(latitude, longitude, row, column)) return this->nodata;
+
+        size_t r = static_cast<size_t>(std::round(row));
+        size_t c = static_cast<size_t>(std::round(column));
+
+        r = r == Rows ? r - 1 : r;
+        c = c == Cols ? c - 1 : c;
+
+        return this->values[r * Cols + c];
+    };
+
+
+    float interpolated_altitude(float latitude, float longitude) const {
+        float row, column;
+        if (!this->index(latitude, longitude, row, column)) return this->nodata;
+
+        return Kernel::sample(row, column, Rows, Cols, [this](size_t r, size_t c) { return this->values[r * Cols + c]; });
+    };
+
+
+    // batch forms : altitudes[i] = altitude(latitudes[i], longitudes[i])
+    void altitude(std::span<const float> latitudes, std::span<const float> longitudes, std::span<T> altitudes) const {
+        check(latitudes, longitudes, altitudes);
+        for (size_t i = 0; i < latitudes.size(); ++i) altitudes[i] = this->altitude(latitudes[i], longitudes[i]);
+    };
+
+
+    void interpolated_altitude(std::span<const float> latitudes, std::span<const float> longitudes, std::span<float> altitudes) const {
+        check(latitudes, longitudes, altitudes);
+        for (size_t i = 0; i < latitudes.size(); ++i) altitudes[i] = this->interpolated_altitude(latitudes[i], longitudes[i]);
+    };
+
+
+private:
+    std::shared_ptr<const DEM<T, endianness>> source;
+    const T* values;
+    Bounds bounds;
+    T nodata;
+
+
+    // fractional (row, column) index of the coordinate, false outside the DEM tile
+    bool index(float latitude, float longitude, float& row, float& column) const {
+        row = (this->bounds.NE.latitude - latitude) * static_cast<float>(CellsPerDegree);
+        column = (longitude - this->bounds.SW.longitude) * static_cast<float>(CellsPerDegree);
+
+        return this->bounds.within(latitude, longitude);
+    };
+
+
+    template <typename U>
+    static void check(std::span<const float> latitudes, std::span<const float> longitudes, std::span<U> altitudes) {
+        if (latitudes.size() != longitudes.size() || latitudes.size() != altitudes.size()) {
+            throw std::runtime_error("batch altitude spans differ in size");
+        }
+    };
+};
+
+
+// 1 & 3 arc second SRTM tiles (`.hgt`, big endian int16)
+template <typename Kernel = Bilinear>
+using SRTM1 = FixedDEM<int16_t, 3601, 3601, 3600, Kernel, std::endian::big>;
+
+template <typename Kernel = Bilinear>
+using SRTM3 = FixedDEM<int16_t, 1201, 1201, 1200, Kernel, std::endian::big>;
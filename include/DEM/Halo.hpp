@@ -0,0 +1,171 @@
+/*
+MIT License
+
+Copyright (c) 2023 Pritam Halder
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated
+documentation files (the "Software"), to deal in the Software without restriction, including without
+limitation the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the
+Software, and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED
+TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF
+CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+DEALINGS IN THE SOFTWARE.
+
+Author : Pritam Halder
+Email : pritamhalder.portfolio@gmail.com
+*/
+
+
+#pragma once
+
+#include <cstddef>
+#include <span>
+#include <stdexcept>
+#include <vector>
+
+#include "DEM.hpp"
+#include "Interpolation.hpp"
+
+
+
+// `width` cells of the neighbouring DEM tiles around a DEM tile, kept as 4 strips beside the DEM tile (which is left
+// as it is) : `width` rows north & south (corners included) & `width` columns west & east. every strip is a DEM of its
+// own that repeats the edge row / column of the DEM tile, so that the seam between them is covered by the strip.
+// the queries read the DEM tile alone away from its edges & the DEM tile extended by the strips near them
+template <dem_datatype T, std::endian endianness = std::endian::native>
+class Halo {
+public:
+    size_t width = 0;
+    DEM<T, endianness> north;   // rows -width .. 0 x columns -width .. ncols-1 + width of the DEM tile
+    DEM<T, endianness> south;   // rows nrows-1 .. nrows-1 + width x columns -width .. ncols-1 + width
+    DEM<T, endianness> west;    // rows 0 .. nrows-1 x columns -width .. 0
+    DEM<T, endianness> east;    // rows 0 .. nrows-1 x columns ncols-1 .. ncols-1 + width
+    Bounds inner;               // coordinates the kernels answer from the DEM tile alone
+
+
+    Halo() = default;
+
+
+    // halo of `width` cells around `dem`, `value(row, column)` is the value of a cell outside the DEM tile
+    // (row & column of the DEM tile, negative north & west of it)
+    template <typename Value>
+    Halo(const DEM<T, endianness>& dem, size_t width, Value value)
+        : width(width)
+    {
+        const size_t nrows = dem.type.nrows, ncols = dem.type.ncols;
+        if (width == 0 || nrows == 0 || ncols == 0) {
+            throw std::runtime_error("halo needs a width & a DEM tile");
+        }
+
+        const ptrdiff_t w = static_cast<ptrdiff_t>(width);
+        auto strip = [&](ptrdiff_t r0, ptrdiff_t c0, size_t rows, size_t columns) {
+            // set field by field, the strips may reach past the -90 / -180 limits checked by `Type`
+            typename DEM<T, endianness>::Type type;
+            type.nrows = rows;
+            type.ncols = columns;
+            type.yllcorner = dem.type.yllcorner + static_cast<float>(static_cast<ptrdiff_t>(nrows) - r0 - static_cast<ptrdiff_t>(rows)) * dem.type.cellsize;
+            type.xllcorner = dem.type.xllcorner + static_cast<float>(c0) * dem.type.cellsize;
+            type.cellsize = dem.type.cellsize;
+            type.nodata = dem.type.nodata;
+
+            std::vector<T> values(rows * columns);
+            for (size_t r = 0; r < rows; ++r) {
+                const ptrdiff_t row = r0 + static_cast<ptrdiff_t>(r);
+                for (size_t c = 0; c < columns; ++c) {
+                    const ptrdiff_t column = c0 + static_cast<ptrdiff_t>(c);
+                    const bool inside = row >= 0 && row < static_cast<ptrdiff_t>(nrows) && column >= 0 && column < static_cast<ptrdiff_t>(ncols);
+                    values[r * columns + c] = inside ? dem.at(static_cast<size_t>(row), static_cast<size_t>(column)) : value(row, column);
+                }
+            }
+            return DEM<T, endianness>(type, std::move(values));
+        };
+
+        this->north = strip(-w, -w, width + 1, ncols + 2 * width);
+        this->south = strip(static_cast<ptrdiff_t>(nrows) - 1, -w, width + 1, ncols + 2 * width);
+        this->west = strip(0, -w, nrows, width + 1);
+        this->east = strip(0, static_cast<ptrdiff_t>(ncols) - 1, nrows, width + 1);
+
+        // past the reach of the kernels (the widest, `Bicubic`, takes 2 cells on either side)
+        const float margin = static_cast<float>(width + 2) * dem.type.cellsize;
+        this->inner = Bounds(
+            {dem.bounds.NE.latitude - margin, dem.bounds.SW.longitude + margin},
+            {dem.bounds.NE.latitude - margin, dem.bounds.NE.longitude - margin},
+            {dem.bounds.SW.latitude + margin, dem.bounds.SW.longitude + margin},
+            {dem.bounds.SW.latitude + margin, dem.bounds.NE.longitude - margin}
+        );
+    };
+
+
+    // bytes of memory holding the strips
+    size_t resident_bytes() const {
+        return this->north.resident_bytes() + this->south.resident_bytes() + this->west.resident_bytes() + this->east.resident_bytes();
+    };
+
+
+    // value at (`row`, `column`) of `dem` extended by the halo (`width` rows & columns before the first of the DEM tile)
+    T at(const DEM<T, endianness>& dem, size_t row, size_t column) const {
+        const size_t nrows = dem.type.nrows, ncols = dem.type.ncols;
+
+        if (row < this->width) return this->north.at(row, column);
+        if (row >= nrows + this->width) return this->south.at(row - nrows - this->width + 1, column);
+        if (column < this->width) return this->west.at(row - this->width, column);
+        if (column >= ncols + this->width) return this->east.at(row - this->width, column - ncols - this->width + 1);
+
+        return dem.at(row - this->width, column - this->width);
+    };
+
+
+    // `DEM::altitude()` of `dem` extended by the halo
+    T altitude(const DEM<T, endianness>& dem, float latitude, float longitude) const {
+        if (this->inner.within(latitude, longitude)) return dem.altitude(latitude, longitude);
+        return static_cast<T>(this->sample<Nearest>(dem, latitude, longitude));
+    };
+
+
+    // `DEM::interpolated_altitude()` of `dem` extended by the halo
+    template <typename Kernel = Bilinear>
+    float interpolated_altitude(const DEM<T, endianness>& dem, float latitude, float longitude) const {
+        if (this->inner.within(latitude, longitude)) return dem.template interpolated_altitude<Kernel>(latitude, longitude);
+        return this->sample<Kernel>(dem, latitude, longitude);
+    };
+
+
+    // batch forms, queried from the DEM tile in one pass & the coordinates near its edges again with the halo
+    void altitude(const DEM<T, endianness>& dem, std::span<const float> latitudes, std::span<const float> longitudes, std::span<T> altitudes) const {
+        dem.altitude(latitudes, longitudes, altitudes);
+        for (size_t i = 0; i < latitudes.size(); ++i) {
+            if (!this->inner.within(latitudes[i], longitudes[i])) altitudes[i] = this->altitude(dem, latitudes[i], longitudes[i]);
+        }
+    };
+
+
+    void interpolated_altitude(const DEM<T, endianness>& dem, std::span<const float> latitudes, std::span<const float> longitudes, std::span<float> altitudes) const {
+        dem.interpolated_altitude(latitudes, longitudes, altitudes);
+        for (size_t i = 0; i < latitudes.size(); ++i) {
+            if (!this->inner.within(latitudes[i], longitudes[i])) altitudes[i] = this->interpolated_altitude(dem, latitudes[i], longitudes[i]);
+        }
+    };
+
+
+private:
+    // `Kernel` interpolation at the coordinate over `dem` extended by the halo, indexed as `DEM::index()` does
+    template <typename Kernel>
+    float sample(const DEM<T, endianness>& dem, float latitude, float longitude) const {
+        if (!dem.bounds.within(latitude, longitude)) {
+            return dem.type.nodata;
+        }
+
+        const float reciprocal = 1.0f / dem.type.cellsize, w = static_cast<float>(this->width);
+        const float row = (dem.bounds.NE.latitude - latitude) * reciprocal + w;
+        const float column = (longitude - dem.bounds.SW.longitude) * reciprocal + w;
+
+        return Kernel::sample(row, column, dem.type.nrows + 2 * this->width, dem.type.ncols + 2 * this->width, [&](size_t r, size_t c) {
+            return this->at(dem, r, c);
+        });
+    };
+};
@@ -0,0 +1,138 @@
+/*
+MIT License
+
+Copyright (c) 2023 Pritam Halder
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated
+documentation files (the "Software"), to deal in the Software without restriction, including without
+limitation the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the
+Software, and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED
+TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF
+CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+DEALINGS IN THE SOFTWARE.
+
+Author : Pritam Halder
+Email : pritamhalder.portfolio@gmail.com
+*/
+
+
+
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstddef>
+
+
+
+// interpolation kernels over a raster of `nrows` x `ncols` values read through `at(row, column)`,
+// at a fractional (row, column) index inside the raster. the southern & eastern edges round onto the
+// last row & column, neighbours beyond the edges are clamped onto them.
+// kernels are stateless policies, `DEM::interpolated_altitude<Kernel>()` & `FixedDEM` take them as template arguments
+
+// value of the closest DEM cell
+struct Nearest {
+    static constexpr size_t radius = 0;     // neighbours used on each side of the cell
+
+
+    template <typename At>
+    static float sample(float row, float column, size_t nrows, size_t ncols, At at) {
+        size_t r = static_cast<size_t>(std::round(row));
+        size_t c = static_cast<size_t>(std::round(column));
+
+        r = r >= nrows ? nrows - 1 : r;
+        c = c >= ncols ? ncols - 1 : c;
+
+        return static_cast<float>(at(r, c));
+    };
+};
+
+
+// weighted mean of the 2x2 surrounding DEM cells
+struct Bilinear {
+    static constexpr size_t radius = 1;
+
+
+    template <typename At>
+    static float sample(float row, float column, size_t nrows, size_t ncols, At at) {
+        size_t r = std::min(static_cast<size_t>(row), nrows-1);
+        size_t c = std::min(static_cast<size_t>(column), ncols-1);
+
+        float del_latitude = std::min(row, static_cast<float>(nrows-1)) - r;
+        float del_longitude = std::min(column, static_cast<float>(ncols-1)) - c;
+
+        size_t next_r = (r == nrows-1) ? r : r + 1;
+        size_t next_c = (c == ncols-1) ? c : c + 1;
+
+        float altitude =   (1-del_latitude) * (1-del_longitude) * at(r, c) +
+                            del_longitude * (1-del_latitude) * at(r, next_c) +
+                            (1-del_longitude) * del_latitude * at(next_r, c) +
+                            del_latitude * del_longitude * at(next_r, next_c);
+
+        return altitude;
+    };
+};
+
+
+// Catmull-Rom cubic convolution over the 4x4 surrounding DEM cells (passes through the DEM values, C1 continuous),
+// the weights are read from a table of `steps` fractional offsets instead of evaluating the cubic per query
+struct Bicubic {
+    static constexpr size_t radius = 2;
+    static constexpr size_t steps = 1024;   // fractional offsets per cell (1/1024 cell resolution)
+
+
+    template <typename At>
+    static float sample(float row, float column, size_t nrows, size_t ncols, At at) {
+        size_t r = std::min(static_cast<size_t>(row), nrows-1);
+        size_t c = std::min(static_cast<size_t>(column), ncols-1);
+
+        const std::array<float, 4>& wr = weight(std::min(row, static_cast<float>(nrows-1)) - r);
+        const std::array<float, 4>& wc = weight(std::min(column, static_cast<float>(ncols-1)) - c);
+
+        // rows & columns r-1 .. r+2 clamped to the raster
+        size_t rows[4], columns[4];
+        for (size_t k = 0; k < 4; ++k) {
+            rows[k] = static_cast<size_t>(std::clamp<ptrdiff_t>(static_cast<ptrdiff_t>(r + k) - 1, 0, static_cast<ptrdiff_t>(nrows-1)));
+            columns[k] = static_cast<size_t>(std::clamp<ptrdiff_t>(static_cast<ptrdiff_t>(c + k) - 1, 0, static_cast<ptrdiff_t>(ncols-1)));
+        }
+
+        float altitude = 0;
+        for (size_t i = 0; i < 4; ++i) {
+            float across = 0;
+            for (size_t j = 0; j < 4; ++j) {
+                across += wc[j] * static_cast<float>(at(rows[i], columns[j]));
+            }
+            altitude += wr[i] * across;
+        }
+
+        return altitude;
+    };
+
+
+private:
+    static constexpr std::array<std::array<float, 4>, steps + 1> weights = []() {
+        std::array<std::array<float, 4>, steps + 1> table{};
+        for (size_t i = 0; i <= steps; ++i) {
+            const double t = static_cast<double>(i) / steps, t2 = t * t, t3 = t2 * t;
+            table[i] = {
+                static_cast<float>((-t3 + 2 * t2 - t) / 2),
+                static_cast<float>((3 * t3 - 5 * t2 + 2) / 2),
+                static_cast<float>((-3 * t3 + 4 * t2 + t) / 2),
+                static_cast<float>((t3 - t2) / 2)
+            };
+        }
+        return table;
+    }();
+
+
+    // weights of the 4 neighbours at fractional offset `t` ([0, 1])
+    static const std::array<float, 4>& weight(float t) {
+        return weights[static_cast<size_t>(t * steps + 0.5f)];
+    };
+};
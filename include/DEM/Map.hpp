@@ -22,14 +22,28 @@ Email : pritamhalder.portfolio@gmail.com
 
 #pragma once
 
+#include <algorithm>
 #include <bit>
+#include <charconv>
+#include <chrono>
 #include <cstdint>
 #include <filesystem>
+#include <fstream>
 #include <map>
+#include <memory>
 #include <regex>
+#include <span>
 #include <string>
+#include <string_view>
+#include <vector>
 
 #include "DEM.hpp"
+#include "Halo.hpp"
+#include "Parallel.hpp"
+#include "Prefetcher.hpp"
+#include "Pyramid.hpp"
+#include "SharedStore.hpp"
+#include "Statistics.hpp"
 
 
 template <dem_datatype T, std::endian endianness = std::endian::native>
@@ -37,14 +51,53 @@ class Map {
 public:
     using Grid = std::map<Coordinate, std::pair<typename DEM<T, endianness>::Type, std::filesystem::path>>;
 
+    struct Options {
+        size_t capacity = 1;                // max. no. of DEM tiles kept in memory
+        size_t budget = 0;                  // max. bytes of DEM values kept in memory, see `DEM::resident_bytes()` (0 = no limit), evicted DEM tiles still held elsewhere stay in memory until released
+        Storage storage = Storage::Heap;    // storage of every loaded DEM tile
+        size_t blocks = 0;                  // max. bytes of decoded blocks kept per DEM tile with `Storage::Blocks` (0 = no limit)
+        bool verify = true;                 // check that every DEM file of the grid exists at construction
+        size_t prefetch = 0;                // max. no. of DEM tiles loaded ahead of the queries on a background thread (0 = off)
+        float horizon = 10;                 // seconds ahead of the queries the prefetched DEM tiles are predicted for
+        bool statistics = false;            // count queries & DEM tile loads from the start (see `statistics()`)
+        size_t halo = 0;                    // cells of the neighbouring DEM tiles kept around every DEM tile (0 = off, 1 for bilinear, 2 for bicubic), see `Halo`
+        std::shared_ptr<SharedStore> store; // with `Storage::Shared` : store the DEM tiles are decoded into & shared with other processes through
+    };
+
+
+    // no. of integer grid cells (latitude -90 .. 90 x longitude -180 .. 180)
+    static constexpr size_t cells = 181 * 361;
+
+
+    // integer grid cell of the coordinate (index into a `cells` sized array), -1 for invalid coordinates
+    static int32_t key(float latitude, float longitude) {
+        if (!(latitude >= -90 && latitude <= 90 && longitude >= -180 && longitude <= 180)) return -1;
+        return static_cast<int32_t>(std::floor(latitude) + 90) * 361 + static_cast<int32_t>(std::floor(longitude) + 180);
+    };
+
+
     Map() = default;
 
-    Map(const Grid& grid) {
+
+    Map(const Grid& grid)
+        : Map(grid, Options{})
+    {};
+
+
+    Map(const Grid& grid, const Options& options) {
         if (grid.empty()) {
             throw std::runtime_error("map grid is empty\n");
         }
 
-        for (auto m = grid.cbegin(); m != grid.cend(); ++m) {
+        if (options.capacity == 0) {
+            throw std::runtime_error("map capacity must be atleast 1 DEM tile\n");
+        }
+
+        if (options.storage == Storage::Shared && !options.store) {
+            throw std::runtime_error("map shared storage needs a shared store\n");
+        }
+
+        for (auto m = grid.cbegin(); options.verify && m != grid.cend(); ++m) {
             std::filesystem::path filepath = m->second.second;
 
             if (!std::filesystem::exists(filepath)) {
@@ -53,46 +106,270 @@ public:
             }
         }
 
-        this->grid = grid;
+        // direct lookup of the grid entries by integer grid cell
+        this->entries.assign(grid.cbegin(), grid.cend());
+        this->index.assign(cells, -1);
+        for (size_t i = 0; i < this->entries.size(); ++i) {
+            this->index[key(this->entries[i].first.latitude, this->entries[i].first.longitude)] = static_cast<int32_t>(i);
+        }
 
-        auto first_dem = this->grid.cbegin();
-        this->dem = DEM<T, endianness>(this->grid[first_dem->first].first, this->grid[first_dem->first].second);
+        this->options = options;
+        this->counters->enable(options.statistics);
+
+        this->prefetcher = this->start_prefetcher();
+
+        this->load(key(this->entries.front().first.latitude, this->entries.front().first.longitude));
+    };
+
+
+    // copies share the cached DEM tiles & the counters, every copy predicts its own queries with its own prefetcher
+    Map(const Map& other)
+        : dem(other.dem),
+        bounds(other.bounds),
+        strips(other.strips),
+        tiles(other.tiles),
+        entries(other.entries),
+        index(other.index),
+        options(other.options),
+        clock(other.clock),
+        counters(other.counters),
+        overviews(other.overviews),
+        prefetcher(other.start_prefetcher())
+    {};
+
+    Map& operator=(const Map& other) {
+        if (this != &other) {
+            this->dem = other.dem;
+            this->bounds = other.bounds;
+            this->strips = other.strips;
+            this->tiles = other.tiles;
+            this->entries = other.entries;
+            this->index = other.index;
+            this->options = other.options;
+            this->clock = other.clock;
+            this->counters = other.counters;
+            this->overviews = other.overviews;
+            this->prefetcher = other.start_prefetcher();
+        }
+        return *this;
     };
 
+    Map(Map&& other) noexcept = default;
+    Map& operator=(Map&& other) noexcept = default;
 
     ~Map() = default;
 
 
     const DEM<T, endianness>& get_dem() const {
-        return this->dem;
+        return *this->dem;
     }
 
 
+    // options the map was created with
+    const Options& get_options() const {
+        return this->options;
+    };
+
+
+    // no. of DEM tiles currently kept in memory
+    size_t resident() const {
+        return this->tiles.size();
+    };
+
+
+    // DEM type of the grid entry bounding the coordinate (the DEM tile isn't loaded), nullptr if not in the grid
+    const typename DEM<T, endianness>::Type* describe(float latitude, float longitude) const {
+        const Entry* entry = this->entry(key(latitude, longitude));
+        return entry ? &entry->second.first : nullptr;
+    };
+
+
+    // counters of the map (off unless `Options::statistics`, toggled with `statistics().enable()`),
+    // `statistics().snapshot()` can be taken from any thread. copies of a map share its counters
+    Statistics& statistics() const {
+        return *this->counters;
+    };
+
+
+    // shared handle to the DEM tile bounding the coordinate (loaded on a miss), empty if not in the grid,
+    // the handle keeps the DEM tile alive even after it is evicted from the map
+    std::shared_ptr<const DEM<T, endianness>> acquire(float latitude, float longitude) {
+        if (this->tile(latitude, longitude) == nullptr) return nullptr;
+        return this->dem;
+    };
+
+
+    // halo of the DEM tile `acquire()` returns for the coordinate, read with the DEM tile.
+    // empty without `Options::halo` or if not in the grid
+    std::shared_ptr<const Halo<T, endianness>> halo(float latitude, float longitude) {
+        if (this->tile(latitude, longitude) == nullptr) return nullptr;
+        return this->strips;
+    };
+
+
+    // min / max quadtree (overview levels from 2x coarser) of the DEM tile `acquire()` returns for the coordinate,
+    // read from the `.ovr` file next to the DEM tile (built & saved as it when missing or of another DEM tile),
+    // kept in the cache alongside the DEM tile. empty if not in the grid
+    std::shared_ptr<const Pyramid> quadtree(float latitude, float longitude) {
+        if (this->tile(latitude, longitude) == nullptr) return nullptr;
+
+        auto cached = std::find_if(this->tiles.begin(), this->tiles.end(), [this](const auto& t) { return t.second.dem == this->dem; });
+        if (cached == this->tiles.end()) return nullptr;
+
+        Tile& tile = cached->second;
+        if (!tile.quadtree) {
+            Pyramid pyramid = this->pyramid(this->entry(cached->first)->second, 2, tile.dem.get());
+            tile.quadtree = std::make_shared<const Pyramid>(std::move(pyramid));
+        }
+
+        return tile.quadtree;
+    };
+
+
     T altitude(float latitude, float longitude) {
-        if (!this->dem.bounds.within(latitude, longitude)) {
-            if (!this->load(latitude, longitude)) {
-                return this->dem.type.nodata;
-            }
+        const DEM<T, endianness>* dem = this->tile(latitude, longitude);
+
+        if (dem == nullptr) {
+            return this->served(this->dem->type.nodata);
         }
 
-        return this->dem.altitude(latitude, longitude);
+        if (this->strips) return this->served(this->strips->altitude(*dem, latitude, longitude));
+
+        return this->served(dem->altitude(latitude, longitude));
     };
 
 
+    // interpolated altitude with the `Kernel` policy (see `DEM::interpolated_altitude()`),
+    // exact across the seams of the DEM tiles with `Options::halo` covering the kernel
+    template <typename Kernel = Bilinear>
     float interpolated_altitude(float latitude, float longitude) {
-        if (!this->dem.bounds.within(latitude, longitude)) {
-            if (!this->load(latitude, longitude)) {
-                return this->dem.type.nodata;
+        const DEM<T, endianness>* dem = this->tile(latitude, longitude);
+
+        if (dem == nullptr) {
+            return this->served(static_cast<float>(this->dem->type.nodata));
+        }
+
+        if (this->strips) return this->served(this->strips->template interpolated_altitude<Kernel>(*dem, latitude, longitude));
+
+        return this->served(dem->template interpolated_altitude<Kernel>(latitude, longitude));
+    };
+
+
+    // batch form of `altitude()`, the coordinates are grouped by their grid cell so that every
+    // DEM tile is loaded atmost once, independent of the order of the coordinates.
+    // with `threads` > 1 different DEM tiles are queried on different threads.
+    // invalid coordinates throw as in `altitude()`, before any DEM tile is read
+    void altitude(std::span<const float> latitudes, std::span<const float> longitudes, std::span<T> altitudes, size_t threads = 1) {
+        this->schedule(latitudes, longitudes, altitudes, threads, [](const DEM<T, endianness>& dem, const Halo<T, endianness>* halo, std::span<const float> lat, std::span<const float> lon, std::span<T> alt) {
+            if (halo != nullptr) halo->altitude(dem, lat, lon, alt);
+            else dem.altitude(lat, lon, alt);
+        });
+        this->served(std::span<const T>(altitudes));
+    };
+
+
+    // batch form of `interpolated_altitude()` (see batch `altitude()`)
+    void interpolated_altitude(std::span<const float> latitudes, std::span<const float> longitudes, std::span<float> altitudes, size_t threads = 1) {
+        this->schedule(latitudes, longitudes, altitudes, threads, [](const DEM<T, endianness>& dem, const Halo<T, endianness>* halo, std::span<const float> lat, std::span<const float> lon, std::span<float> alt) {
+            if (halo != nullptr) halo->interpolated_altitude(dem, lat, lon, alt);
+            else dem.interpolated_altitude(lat, lon, alt);
+        });
+        this->served(std::span<const float>(altitudes));
+    };
+
+
+    // altitude at a coarser `resolution` (in the units of `cellsize`) from the overview levels of the DEM tile
+    // (see `Pyramid`), read from the `.ovr` file next to the DEM tile (built & saved as it when missing or of another DEM tile),
+    // only the overview levels are kept in memory (of atmost `Options::capacity` DEM tiles, least recently used
+    // evicted first). resolutions finer than the first overview level are served
+    // from the DEM tile itself
+    float coarse_altitude(float latitude, float longitude, float resolution, Pyramid::Statistic statistic = Pyramid::Statistic::Mean) {
+        if (!(latitude >= -90 && latitude <= 90 && longitude >= -180 && longitude <= 180)) {
+            return this->dem->type.nodata;
+        }
+
+        const int32_t k = key(latitude, longitude);
+        const Entry* entry = this->entry(k);
+        if (entry == nullptr) {
+            return this->dem->type.nodata;
+        }
+
+        // coarsest power of 2 overview no larger than the resolution
+        const float cellsize = entry->second.first.cellsize;
+        size_t factor = 1;
+        while (cellsize * static_cast<float>(factor * 2) <= resolution) factor *= 2;
+
+        if (factor == 1) {
+            return static_cast<float>(this->altitude(latitude, longitude));
+        }
+
+        return this->overview(k, factor).altitude(latitude, longitude, resolution, statistic);
+    };
+
+
+    // batch form of `coarse_altitude()`
+    void coarse_altitude(std::span<const float> latitudes, std::span<const float> longitudes, float resolution, std::span<float> altitudes, Pyramid::Statistic statistic = Pyramid::Statistic::Mean) {
+        if (latitudes.size() != longitudes.size() || latitudes.size() != altitudes.size()) {
+            throw std::runtime_error("batch altitude spans differ in size");
+        }
+
+        for (size_t i = 0; i < latitudes.size(); ++i) {
+            altitudes[i] = this->coarse_altitude(latitudes[i], longitudes[i], resolution, statistic);
+        }
+    };
+
+
+    // terrain profile along the segment `from` -> `to` across DEM tiles (see `DEM::samples()` for `step`),
+    // every DEM tile crossed by the segment is loaded once and walked cell by cell
+    std::vector<Sample> profile(const Coordinate& from, const Coordinate& to, float step = 0) {
+        const DEM<T, endianness>* start = this->tile(from.latitude, from.longitude);
+        const DEM<T, endianness>& reference = start != nullptr ? *start : *this->dem;
+
+        if (step <= 0 && reference.type.cellsize <= 0) {
+            return {{from.latitude, from.longitude, static_cast<float>(reference.type.nodata)}};
+        }
+
+        std::vector<Sample> path(reference.samples(from, to, step));
+        const size_t count = path.size();
+        const float steps = count > 1 ? static_cast<float>(count - 1) : 1.0f;
+        const float del_latitude = (to.latitude - from.latitude) / steps;
+        const float del_longitude = (to.longitude - from.longitude) / steps;
+
+        for (size_t k = 0; k < count;) {
+            float latitude = from.latitude + del_latitude * static_cast<float>(k);
+            float longitude = from.longitude + del_longitude * static_cast<float>(k);
+
+            const DEM<T, endianness>* dem = this->tile(latitude, longitude);
+            if (dem == nullptr) {
+                path[k++] = {latitude, longitude, static_cast<float>(this->dem->type.nodata)};
+                continue;
             }
+
+            // the run of samples inside this DEM tile
+            size_t end = k + 1;
+            while (
+                end < count
+                && this->bounds.within(from.latitude + del_latitude * static_cast<float>(end), from.longitude + del_longitude * static_cast<float>(end))
+            ) ++end;
+
+            dem->trace(from, to, count, k, std::span<Sample>(path).subspan(k, end - k));
+            k = end;
         }
 
-        return this->dem.interpolated_altitude(latitude, longitude);
+        return path;
+    };
+
+
+    // line of sight between two points above the terrain across DEM tiles (see `DEM::line_of_sight()`)
+    bool line_of_sight(const Coordinate& observer, float observer_height, const Coordinate& target, float target_height, float step = 0) {
+        std::vector<Sample> path = this->profile(observer, target, step);
+        return DEM<T, endianness>::visible(path, observer_height, target_height, this->dem->type.nodata);
     };
 
 
     static Grid initialize(const std::filesystem::path& dem_directory_path, size_t nrows, size_t ncols, float cellsize, T nodata) {
         Map<T, endianness>::Grid grid;
-        std::regex pattern(R"(([-]?\d{1,2}|90)_([-]?\d{1,3}|180)\.bin)");
+        std::regex pattern(R"(([-]?\d{1,2}|90)_([-]?\d{1,3}|180)\.(bin|tile))");
 
         try {
             for (const auto& entry : std::filesystem::directory_iterator(dem_directory_path)) {
@@ -109,6 +386,18 @@ public:
                             && (longitude >= -180 && longitude <= 180)
                         ) {
                             typename DEM<T, endianness>::Type type(nrows, ncols, latitude, longitude, cellsize, nodata);
+
+                            // `.tile` files describe their own geometry
+                            if (match[3] == "tile") {
+                                MappedFile file(entry.path());
+                                TileFormat::Header header = TileFormat::parse(file.data(), file.size());
+                                type = {
+                                    static_cast<size_t>(header.nrows), static_cast<size_t>(header.ncols),
+                                    static_cast<float>(header.yllcorner), static_cast<float>(header.xllcorner),
+                                    static_cast<float>(header.cellsize), static_cast<T>(header.nodata)
+                                };
+                            }
+
                             grid[{latitude, longitude}] = {type, entry.path().string()};
                         }
                     }
@@ -122,20 +411,562 @@ public:
     };
 
 
+    // writes the grid as a manifest : a "DEM-manifest 1" line followed by one line per DEM tile
+    // (latitude longitude nrows ncols yllcorner xllcorner cellsize nodata bytes path), paths below the directory
+    // of the manifest are kept relative to it
+    static void save_manifest(const Grid& grid, const std::filesystem::path& manifest_path) {
+        const std::filesystem::path base = std::filesystem::absolute(manifest_path).parent_path();
+        std::ofstream ofp(manifest_path, std::ios::trunc);
+        if (!ofp.good()) {
+            throw std::runtime_error("failed to create '" + manifest_path.string() + "'");
+        }
+
+        std::string line;
+        char number[64];
+        auto field = [&line, &number](auto value) {
+            line.append(number, std::to_chars(number, number + sizeof(number), value).ptr);
+            line += ' ';
+        };
+
+        ofp << "DEM-manifest 1\n";
+        for (const auto& [coordinate, entry] : grid) {
+            const auto& [type, filepath] = entry;
+            std::filesystem::path relative = std::filesystem::absolute(filepath).lexically_relative(base);
+            const bool below = !relative.empty() && *relative.begin() != "..";
+
+            line.clear();
+            field(coordinate.latitude);
+            field(coordinate.longitude);
+            field(type.nrows);
+            field(type.ncols);
+            field(type.yllcorner);
+            field(type.xllcorner);
+            field(type.cellsize);
+            field(type.nodata);
+            field(static_cast<uintmax_t>(std::filesystem::file_size(filepath)));
+            line += (below ? relative : std::filesystem::absolute(filepath)).generic_string();
+            line += '\n';
+            ofp << line;
+        }
+
+        if (!ofp.good()) {
+            throw std::runtime_error("failed to write '" + manifest_path.string() + "'");
+        }
+    };
+
+
+    // grid of a manifest written by `save_manifest()` (the DEM directory isn't listed),
+    // `verify` checks that every DEM file still has the size recorded in the manifest
+    static Grid load_manifest(const std::filesystem::path& manifest_path, bool verify = false) {
+        const std::filesystem::path base = std::filesystem::absolute(manifest_path).parent_path();
+        MappedFile file(manifest_path);
+        const char* p = reinterpret_cast<const char*>(file.data());
+        const char* end = p + file.size();
+
+        auto invalid = [&manifest_path]() {
+            return std::runtime_error("invalid map manifest '" + manifest_path.string() + "'");
+        };
+
+        const std::string_view magic = "DEM-manifest 1";
+        if (static_cast<size_t>(end - p) < magic.size() || std::string_view(p, magic.size()) != magic) throw invalid();
+        p = std::find(p, end, '\n');
+
+        auto field = [&](auto& value) {
+            while (p < end && *p == ' ') ++p;
+            auto [next, ec] = std::from_chars(p, end, value);
+            if (ec != std::errc()) throw invalid();
+            p = next;
+        };
+
+        Grid grid;
+        while (p < end) {
+            ++p;    // '\n'
+            if (p >= end) break;
+
+            float latitude, longitude, yllcorner, xllcorner, cellsize;
+            size_t nrows, ncols;
+            uintmax_t bytes;
+            T nodata;
+
+            field(latitude);
+            field(longitude);
+            field(nrows);
+            field(ncols);
+            field(yllcorner);
+            field(xllcorner);
+            field(cellsize);
+            field(nodata);
+            field(bytes);
+
+            if (p >= end || *p != ' ') throw invalid();
+            const char* path_end = std::find(++p, end, '\n');
+            std::string path(p, path_end);
+            if (!path.empty() && path.back() == '\r') path.pop_back();
+            p = path_end;
+
+            std::filesystem::path filepath(path);
+            if (filepath.is_relative()) filepath = base / filepath;
+
+            if (verify && (!std::filesystem::exists(filepath) || std::filesystem::file_size(filepath) != bytes)) {
+                std::string e = "'" + filepath.string() + "' doesn't match the map manifest\n";
+                throw std::runtime_error(e);
+            }
+
+            typename DEM<T, endianness>::Type type(nrows, ncols, yllcorner, xllcorner, cellsize, nodata);
+            grid.emplace_hint(grid.end(), Coordinate{latitude, longitude}, std::make_pair(type, filepath));
+        }
+
+        return grid;
+    };
+
+
 private:
-    DEM<T, endianness> dem;
-    Grid grid;
+    using Entry = std::pair<Coordinate, typename Grid::mapped_type>;
+
+    struct Tile {
+        std::shared_ptr<const DEM<T, endianness>> dem;
+        uint64_t used;      // `Map::clock` value of the last access
+        Bounds bounds;      // bounds of the DEM tile
+        std::shared_ptr<const Pyramid> quadtree;   // set by `quadtree()`
+        std::shared_ptr<const Halo<T, endianness>> strips;  // set with `Options::halo`
+    };
+
+    std::shared_ptr<const DEM<T, endianness>> dem = std::make_shared<const DEM<T, endianness>>();  // most recently used DEM tile
+    Bounds bounds;                              // bounds of `dem`
+    std::shared_ptr<const Halo<T, endianness>> strips;     // halo of `dem` (with `Options::halo`)
+    std::map<int32_t, Tile> tiles;              // DEM tiles kept in memory by grid cell (LRU cache)
+    std::vector<Entry> entries;                 // grid entries
+    std::vector<int32_t> index;                 // grid cell to `entries` (-1 = no DEM tile), see `key()`
+    Options options;
+    uint64_t clock = 0;
+    std::shared_ptr<Statistics> counters = std::make_shared<Statistics>();
+    std::map<int32_t, std::pair<Pyramid, uint64_t>> overviews;     // overview levels of the DEM tiles & their last use (see `coarse_altitude()`)
+    std::unique_ptr<Prefetcher<T, endianness>> prefetcher;     // set only with `Options::prefetch`, never shared between copies
+
+
+    // counts an answered query
+    template <typename U>
+    U served(U altitude) const {
+        if (this->counters->enabled()) {
+            this->counters->add(Statistics::Queries);
+            if (altitude == static_cast<U>(this->dem->type.nodata)) this->counters->add(Statistics::Nodata);
+        }
+        return altitude;
+    };
+
+
+    template <typename U>
+    void served(std::span<const U> altitudes) const {
+        if (this->counters->enabled()) {
+            this->counters->add(Statistics::Queries, altitudes.size());
+            this->counters->add(Statistics::Nodata, static_cast<uint64_t>(std::count(altitudes.begin(), altitudes.end(), static_cast<U>(this->dem->type.nodata))));
+        }
+    };
+
+
+    // reads the DEM tile of a grid entry (attaches to it with `Storage::Shared`), counting the bytes of the values
+    // read whole or decoded into the shared store (decoded blocks are counted as they are decoded, mapped pages aren't)
+    std::shared_ptr<const DEM<T, endianness>> open(const typename Grid::mapped_type& entry) const {
+        const auto start = std::chrono::steady_clock::now();
+        size_t bytes = 0;
+        auto dem = std::make_shared<const DEM<T, endianness>>(
+            this->options.storage == Storage::Shared
+            ? this->options.store->template open<T, endianness>(entry.first, entry.second, &bytes)
+            : DEM<T, endianness>::open(entry.first, entry.second, this->options.storage, this->options.blocks, this->counters)
+        );
+        if (dem->storage() == Storage::Heap) bytes = dem->resident_bytes();
+        this->counters->load(start, bytes);
+        return dem;
+    };
+
+
+    // grid entry of a grid cell, nullptr if the cell has no DEM tile
+    const Entry* entry(int32_t k) const {
+        if (k < 0 || static_cast<size_t>(k) >= this->index.size() || this->index[k] < 0) return nullptr;
+        return &this->entries[this->index[k]];
+    };
+
+
+    // overview levels atleast `factor` times coarser (the coarsest level if none is) of the DEM tile of a grid entry,
+    // read from the `.ovr` file next to the DEM tile when it fits the DEM tile. otherwise they are built from `dem`
+    // (the DEM tile read when nullptr) & saved as the `.ovr` file, written aside & renamed so that no reader sees
+    // a partial file (kept only in memory when the directory isn't writable)
+    Pyramid pyramid(const typename Grid::mapped_type& entry, size_t factor, const DEM<T, endianness>* dem = nullptr) const {
+        const std::filesystem::path overview_path = Pyramid::path(entry.second);
+
+        if (std::filesystem::exists(overview_path)) {
+            Pyramid pyramid = Pyramid::load(overview_path, factor);
+            if (pyramid.fits(entry.first.nrows, entry.first.ncols)) return pyramid;
+        }
+
+        std::shared_ptr<const DEM<T, endianness>> opened;
+        if (dem == nullptr) {
+            opened = this->open(entry);
+            dem = opened.get();
+        }
+        Pyramid pyramid = Pyramid::build(*dem);
+
+        std::filesystem::path written = overview_path;
+        written += ".tmp";
+        try {
+            pyramid.save(written);
+            std::filesystem::rename(written, overview_path);
+        } catch (const std::exception&) {
+            std::error_code ignored;
+            std::filesystem::remove(written, ignored);
+        }
+
+        factor = std::min(factor, pyramid.levels.back().factor);
+        std::erase_if(pyramid.levels, [factor](const Pyramid::Level& level) { return level.factor < factor; });
+
+        return pyramid;
+    };
+
+
+    // overview levels (atleast `factor` times coarser) of the DEM tile of grid cell `k`
+    const Pyramid& overview(int32_t k, size_t factor) {
+        auto cached = this->overviews.find(k);
+        if (cached != this->overviews.end() && !cached->second.first.levels.empty() && cached->second.first.levels.front().factor <= factor) {
+            cached->second.second = ++this->clock;
+            return cached->second.first;
+        }
+
+        Pyramid pyramid = this->pyramid(this->entry(k)->second, factor);
+
+        // the overviews are limited to as many DEM tiles as the cache
+        this->overviews.erase(k);
+        while (this->overviews.size() >= this->options.capacity) {
+            this->overviews.erase(std::min_element(this->overviews.begin(), this->overviews.end(), [](const auto& a, const auto& b) {
+                return a.second.second < b.second.second;
+            }));
+        }
+
+        return (this->overviews[k] = {std::move(pyramid), ++this->clock}).first;
+    };
+
+
+    // DEM tile bounding the coordinate, loaded from the grid on a cache miss
+    const DEM<T, endianness>* tile(float latitude, float longitude) {
+        if (this->prefetcher) this->anticipate(latitude, longitude);
+
+        if (this->bounds.within(latitude, longitude)) {
+            this->counters->add(Statistics::Hits);
+            return this->dem.get();
+        }
+
+        const int32_t k = key(latitude, longitude);
+        if (k < 0) {
+            std::string e = "invalid coordinates (" + std::to_string(latitude) +  ":" +  std::to_string(longitude) + ")";
+            throw std::runtime_error(e);
+        }
+
+        auto cached = this->tiles.find(k);
+        if (cached != this->tiles.end()) {
+            cached->second.used = ++this->clock;
+            this->dem = cached->second.dem;
+            this->bounds = cached->second.bounds;
+            this->strips = cached->second.strips;
+            this->counters->add(Statistics::Hits);
+            return this->dem.get();
+        }
+
+        // a predicted DEM tile is usually loaded already, or being loaded
+        if (this->prefetcher) {
+            std::shared_ptr<const DEM<T, endianness>> dem = this->prefetcher->take(k);
+            if (dem) {
+                this->counters->add(Statistics::Prefetched);
+                this->admit(k, std::move(dem));
+                return this->dem.get();
+            }
+        }
+
+        if (!this->load(k)) return nullptr;
+
+        return this->dem.get();
+    };
+
+
+    // new prefetcher for the map's options, none without `Options::prefetch`
+    std::unique_ptr<Prefetcher<T, endianness>> start_prefetcher() const {
+        if (this->options.prefetch == 0) return nullptr;
+        return std::make_unique<Prefetcher<T, endianness>>(
+            this->options.prefetch, this->options.horizon, this->options.storage, this->options.blocks, this->counters, this->options.store
+        );
+    };
+
+
+    // requests the DEM tiles on the predicted track of the queries from the prefetcher
+    void anticipate(float latitude, float longitude) {
+        float to_latitude = latitude, to_longitude = longitude;
+        if (!this->prefetcher->observe(to_latitude, to_longitude)) return;
+
+        // grid cells along the predicted track (sampled every 0.1 degree)
+        const float del_latitude = to_latitude - latitude, del_longitude = to_longitude - longitude;
+        const size_t steps = static_cast<size_t>(std::ceil(std::max(std::abs(del_latitude), std::abs(del_longitude)) / 0.1f)) + 1;
+        const int32_t current = key(latitude, longitude);
+        size_t requested = 0;
+
+        for (size_t i = 1; i <= steps && requested < this->options.prefetch; ++i) {
+            const float t = static_cast<float>(i) / static_cast<float>(steps);
+            const int32_t k = key(latitude + del_latitude * t, longitude + del_longitude * t);
+            if (k < 0 || k == current || this->tiles.contains(k)) continue;
+
+            const Entry* entry = this->entry(k);
+            if (entry == nullptr) continue;
+
+            this->prefetcher->request(k, entry->second.first, entry->second.second);
+            ++requested;
+        }
+    };
+
+
+    struct Bucket {
+        int32_t key;
+        size_t begin;   // range of the bucket in the sorted order of the coordinates
+        size_t end;
+        std::shared_ptr<const DEM<T, endianness>> dem;
+        std::shared_ptr<const Halo<T, endianness>> strips;
+        const typename Grid::mapped_type* entry = nullptr;
+        bool loaded = false;    // loaded by a worker (not cached yet)
+    };
+
+
+    // groups the coordinates by grid cell, queries every group from its DEM tile in one pass
+    // and scatters the results back to the order of the coordinates
+    template <typename U, typename Query>
+    void schedule(std::span<const float> latitudes, std::span<const float> longitudes, std::span<U> altitudes, size_t threads, Query query) {
+        if (latitudes.size() != longitudes.size() || latitudes.size() != altitudes.size()) {
+            throw std::runtime_error("batch altitude spans differ in size");
+        }
+
+        const size_t n = latitudes.size();
+        const T nodata = this->dem->type.nodata;
+
+        std::vector<std::pair<int32_t, size_t>> order(n);
+        for (size_t i = 0; i < n; ++i) {
+            order[i] = {key(latitudes[i], longitudes[i]), i};
+        }
+        std::sort(order.begin(), order.end());
 
+        // invalid coordinates (key -1) sort first
+        if (n > 0 && order.front().first < 0) {
+            const size_t i = order.front().second;
+            std::string e = "invalid coordinates (" + std::to_string(latitudes[i]) +  ":" +  std::to_string(longitudes[i]) + ")";
+            throw std::runtime_error(e);
+        }
+
+        std::vector<Bucket> buckets;
+        for (size_t i = 0; i < n;) {
+            size_t j = i;
+            while (j < n && order[j].first == order[i].first) ++j;
+            buckets.push_back({order[i].first, i, j, nullptr, nullptr, nullptr, false});
+            i = j;
+        }
+
+        auto run = [&](const Bucket& bucket, const DEM<T, endianness>* dem, const Halo<T, endianness>* halo, std::vector<float>& lat, std::vector<float>& lon, std::vector<U>& alt) {
+            const size_t count = bucket.end - bucket.begin;
+
+            if (dem == nullptr) {
+                for (size_t i = bucket.begin; i < bucket.end; ++i) altitudes[order[i].second] = nodata;
+                return;
+            }
+
+            lat.resize(count);
+            lon.resize(count);
+            alt.resize(count);
+
+            for (size_t i = 0; i < count; ++i) {
+                lat[i] = latitudes[order[bucket.begin + i].second];
+                lon[i] = longitudes[order[bucket.begin + i].second];
+            }
+
+            query(*dem, halo, lat, lon, alt);
 
-    bool load(float latitude, float longitude) {
-        Coordinate grid_coordinate{
-            std::floor(latitude),
-            std::floor(longitude)
+            for (size_t i = 0; i < count; ++i) {
+                altitudes[order[bucket.begin + i].second] = alt[i];
+            }
         };
 
-        if (this->grid.count(grid_coordinate) == 0) return false;
-        this->dem = DEM<T, endianness>(this->grid[grid_coordinate].first, this->grid[grid_coordinate].second);
+        if (threads <= 1 || buckets.size() <= 1) {
+            std::vector<float> lat, lon;
+            std::vector<U> alt;
+
+            for (const Bucket& bucket : buckets) {
+                const size_t first = order[bucket.begin].second;
+                const DEM<T, endianness>* dem = this->tile(latitudes[first], longitudes[first]);
+                run(bucket, dem, this->strips.get(), lat, lon, alt);
+            }
+
+            return;
+        }
+
+        // resolve cached DEM tiles upfront, the workers load the others on their own
+        // (without touching the cache), those are cached once every bucket is done
+        for (Bucket& bucket : buckets) {
+            const size_t first = order[bucket.begin].second;
+            if (this->bounds.within(latitudes[first], longitudes[first])) {
+                bucket.dem = this->dem;
+                bucket.strips = this->strips;
+                continue;
+            }
+
+            auto cached = this->tiles.find(bucket.key);
+            if (cached != this->tiles.end()) {
+                bucket.dem = cached->second.dem;
+                bucket.strips = cached->second.strips;
+                continue;
+            }
+
+            const Entry* entry = this->entry(bucket.key);
+            if (entry != nullptr) bucket.entry = &entry->second;
+            else this->counters->add(Statistics::Misses);
+        }
+
+        // buckets are taken by the threads as they become free
+        parallel_for(buckets.size(), threads, [&](size_t b) {
+            std::vector<float> lat, lon;
+            std::vector<U> alt;
+
+            Bucket& bucket = buckets[b];
+            if (!bucket.dem && bucket.entry != nullptr) {
+                bucket.dem = this->open(*bucket.entry);
+                if (this->options.halo != 0) bucket.strips = this->surround(bucket.key, *bucket.dem);
+                bucket.loaded = true;
+            }
+            run(bucket, bucket.dem.get(), bucket.strips.get(), lat, lon, alt);
+        });
+
+        // the loaded DEM tiles are cached as if loaded by the calling thread (in the order of their grid cells),
+        // the last `Options::capacity` of them only, since any before would be evicted by the ones after
+        std::vector<Bucket*> loaded;
+        for (Bucket& bucket : buckets) {
+            if (bucket.loaded) loaded.push_back(&bucket);
+        }
+        const size_t skipped = loaded.size() > this->options.capacity ? loaded.size() - this->options.capacity : 0;
+        for (size_t i = skipped; i < loaded.size(); ++i) {
+            this->admit(loaded[i]->key, std::move(loaded[i]->dem), std::move(loaded[i]->strips));
+        }
+    };
+
+
+    bool load(int32_t k) {
+        const Entry* entry = this->entry(k);
+        if (entry == nullptr) {
+            this->counters->add(Statistics::Misses);
+            return false;
+        }
+
+        this->admit(k, this->open(entry->second));
 
         return true;
     };
+
+
+    // caches a loaded DEM tile (with its halo, built here when not given) as the most recently used one
+    void admit(int32_t k, std::shared_ptr<const DEM<T, endianness>> dem, std::shared_ptr<const Halo<T, endianness>> strips = nullptr) {
+        const Bounds bounds = dem->bounds;
+        if (this->options.halo != 0 && !strips) strips = this->surround(k, *dem);
+
+        const size_t dem_bytes = dem->resident_bytes() + (strips ? strips->resident_bytes() : 0);
+
+        // bytes held by the cached DEM tiles, summed afresh as the decoded blocks of a DEM tile grow after it is admitted
+        size_t bytes = 0;
+        for (const auto& cached : this->tiles) bytes += held(cached.second);
+
+        // evict least recently used DEM tiles to make room for the new one
+        while (
+            !this->tiles.empty()
+            && (
+                this->tiles.size() >= this->options.capacity
+                || (this->options.budget != 0 && bytes + dem_bytes > this->options.budget)
+            )
+        ) {
+            auto lru = std::min_element(this->tiles.begin(), this->tiles.end(), [](const auto& a, const auto& b) {
+                return a.second.used < b.second.used;
+            });
+            bytes -= held(lru->second);
+            this->tiles.erase(lru);
+            this->counters->add(Statistics::Evictions);
+        }
+
+        this->tiles[k] = {dem, ++this->clock, bounds, nullptr, strips};
+        this->dem = std::move(dem);
+        this->bounds = bounds;
+        this->strips = std::move(strips);
+    };
+
+
+    // bytes of memory held by a cached DEM tile & its halo
+    static size_t held(const Tile& tile) {
+        return tile.dem->resident_bytes() + (tile.strips ? tile.strips->resident_bytes() : 0);
+    };
+
+
+    // halo of `Options::halo` cells of the neighbouring DEM tiles around the DEM tile of grid cell `k`, so that queries
+    // near its edges interpolate across the seams. the neighbours are read mapped or block by block (only their edge
+    // cells are touched), cells without a neighbouring DEM tile repeat the edge of the DEM tile
+    std::shared_ptr<const Halo<T, endianness>> surround(int32_t k, const DEM<T, endianness>& dem) const {
+        const float cellsize = dem.type.cellsize;
+
+        // neighbouring DEM tiles by direction (latitude & longitude offset + 1), opened on first use
+        const Coordinate& cell = this->entries[this->index[k]].first;
+        std::shared_ptr<const DEM<T, endianness>> neighbours[3][3];
+        bool opened[3][3] = {};
+
+        auto neighbour = [&](int del_latitude, int del_longitude) {
+            std::shared_ptr<const DEM<T, endianness>>& n = neighbours[del_latitude + 1][del_longitude + 1];
+            if (!opened[del_latitude + 1][del_longitude + 1]) {
+                opened[del_latitude + 1][del_longitude + 1] = true;
+
+                const int32_t nk = key(cell.latitude + static_cast<float>(del_latitude), cell.longitude + static_cast<float>(del_longitude));
+                auto cached = this->tiles.find(nk);
+                const Entry* entry = this->entry(nk);
+
+                if (cached != this->tiles.end()) {
+                    n = cached->second.dem;
+                } else if (entry != nullptr) {
+                    n = std::make_shared<const DEM<T, endianness>>(DEM<T, endianness>::open(entry->second.first, entry->second.second, Storage::Blocks));
+                }
+            }
+            return n.get();
+        };
+
+        const ptrdiff_t last_row = static_cast<ptrdiff_t>(dem.type.nrows) - 1, last_column = static_cast<ptrdiff_t>(dem.type.ncols) - 1;
+
+        // value of the cell of the neighbouring DEM tile closest to (`latitude`, `column` of the DEM tile), false if there is none
+        auto closest = [&](int del_latitude, int del_longitude, float latitude, ptrdiff_t column, T& value) {
+            const DEM<T, endianness>* n = neighbour(del_latitude, del_longitude);
+            if (n == nullptr) return false;
+
+            const float longitude = dem.bounds.SW.longitude + static_cast<float>(column) * cellsize;
+            const float nr = std::round((n->bounds.NE.latitude - latitude) / n->type.cellsize);
+            const float nc = std::round((longitude - n->bounds.SW.longitude) / n->type.cellsize);
+            if (nr < 0 || nr >= static_cast<float>(n->type.nrows) || nc < 0 || nc >= static_cast<float>(n->type.ncols)) return false;
+
+            value = n->at(static_cast<size_t>(nr), static_cast<size_t>(nc));
+            return true;
+        };
+
+        // cell (`row`, `column`) outside the DEM tile
+        auto value = [&](ptrdiff_t row, ptrdiff_t column) {
+            const int del_latitude = row < 0 ? 1 : (row > last_row ? -1 : 0);
+            const int del_longitude = column < 0 ? -1 : (column > last_column ? 1 : 0);
+            const float latitude = dem.bounds.NE.latitude - static_cast<float>(row) * cellsize;
+
+            const ptrdiff_t clamped_row = std::clamp<ptrdiff_t>(row, 0, last_row), clamped_column = std::clamp<ptrdiff_t>(column, 0, last_column);
+            T value = dem.at(static_cast<size_t>(clamped_row), static_cast<size_t>(clamped_column));
+
+            // closest cell of the neighbouring DEM tile, at a corner without the diagonal neighbouring DEM tile
+            // the closest cell of a neighbouring DEM tile beside the corner
+            if (!closest(del_latitude, del_longitude, latitude, column, value) && del_latitude != 0 && del_longitude != 0) {
+                if (!closest(0, del_longitude, dem.bounds.NE.latitude - static_cast<float>(clamped_row) * cellsize, column, value)) {
+                    closest(del_latitude, 0, latitude, clamped_column, value);
+                }
+            }
+
+            return value;
+        };
+
+        return std::make_shared<const Halo<T, endianness>>(dem, this->options.halo, value);
+    };
 };
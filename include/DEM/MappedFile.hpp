@@ -0,0 +1,174 @@
+/*
+MIT License
+
+Copyright (c) 2023 Pritam Halder
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated
+documentation files (the "Software"), to deal in the Software without restriction, including without
+limitation the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the
+Software, and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED
+TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF
+CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+DEALINGS IN THE SOFTWARE.
+
+Author : Pritam Halder
+Email : pritamhalder.portfolio@gmail.com
+*/
+
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <stdexcept>
+#include <string>
+#include <utility>
+
+#if defined(_WIN32)
+    #ifndef NOMINMAX
+        #define NOMINMAX
+    #endif
+    #include <windows.h>
+#else
+    #include <fcntl.h>
+    #include <sys/mman.h>
+    #include <sys/stat.h>
+    #include <unistd.h>
+#endif
+
+
+
+// read-only memory mapping of a whole file
+class MappedFile {
+public:
+    MappedFile() = default;
+
+
+    MappedFile(const std::filesystem::path& filepath) {
+        if (!std::filesystem::exists(filepath)) {
+            std::string e = "file '" + filepath.string() + "' not found";
+            throw std::runtime_error(e);
+        }
+
+#if defined(_WIN32)
+        this->file = CreateFileW(filepath.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+        if (this->file == INVALID_HANDLE_VALUE) {
+            std::string e = "failed to open '" + filepath.string() + "'";
+            throw std::runtime_error(e);
+        }
+
+        LARGE_INTEGER file_size;
+        GetFileSizeEx(this->file, &file_size);
+        this->length = static_cast<size_t>(file_size.QuadPart);
+
+        if (this->length > 0) {
+            this->mapping = CreateFileMappingW(this->file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+            if (this->mapping != nullptr) {
+                this->address = MapViewOfFile(this->mapping, FILE_MAP_READ, 0, 0, 0);
+            }
+            if (this->address == nullptr) {
+                this->release();
+                std::string e = "failed to map '" + filepath.string() + "'";
+                throw std::runtime_error(e);
+            }
+        }
+#else
+        int fd = ::open(filepath.c_str(), O_RDONLY);
+        if (fd < 0) {
+            std::string e = "failed to open '" + filepath.string() + "'";
+            throw std::runtime_error(e);
+        }
+
+        struct stat st;
+        if (::fstat(fd, &st) != 0) {
+            ::close(fd);
+            std::string e = "failed to stat '" + filepath.string() + "'";
+            throw std::runtime_error(e);
+        }
+        this->length = static_cast<size_t>(st.st_size);
+
+        if (this->length > 0) {
+            void* p = ::mmap(nullptr, this->length, PROT_READ, MAP_SHARED, fd, 0);
+            if (p == MAP_FAILED) {
+                ::close(fd);
+                std::string e = "failed to map '" + filepath.string() + "'";
+                throw std::runtime_error(e);
+            }
+            this->address = p;
+        }
+
+        // the mapping stays valid after the descriptor is closed
+        ::close(fd);
+#endif
+    };
+
+
+    MappedFile(const MappedFile& o) = delete;
+    MappedFile& operator=(const MappedFile& o) = delete;
+
+    MappedFile(MappedFile&& o) noexcept {
+        this->swap(o);
+    };
+
+    MappedFile& operator=(MappedFile&& o) noexcept {
+        if (this != &o) {
+            this->release();
+            this->swap(o);
+        }
+        return *this;
+    };
+
+    ~MappedFile() {
+        this->release();
+    };
+
+
+    const uint8_t* data() const {
+        return static_cast<const uint8_t*>(this->address);
+    };
+
+
+    size_t size() const {
+        return this->length;
+    };
+
+
+private:
+    void* address = nullptr;
+    size_t length = 0;
+#if defined(_WIN32)
+    HANDLE file = INVALID_HANDLE_VALUE;
+    HANDLE mapping = nullptr;
+#endif
+
+
+    void swap(MappedFile& o) noexcept {
+        std::swap(this->address, o.address);
+        std::swap(this->length, o.length);
+#if defined(_WIN32)
+        std::swap(this->file, o.file);
+        std::swap(this->mapping, o.mapping);
+#endif
+    };
+
+
+    void release() noexcept {
+#if defined(_WIN32)
+        if (this->address != nullptr) UnmapViewOfFile(this->address);
+        if (this->mapping != nullptr) CloseHandle(this->mapping);
+        if (this->file != INVALID_HANDLE_VALUE) CloseHandle(this->file);
+        this->file = INVALID_HANDLE_VALUE;
+        this->mapping = nullptr;
+#else
+        if (this->address != nullptr) ::munmap(this->address, this->length);
+#endif
+        this->address = nullptr;
+        this->length = 0;
+    };
+};
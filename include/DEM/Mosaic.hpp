@@ -0,0 +1,374 @@
+/*
+MIT License
+
+Copyright (c) 2023 Pritam Halder
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated
+documentation files (the "Software"), to deal in the Software without restriction, including without
+limitation the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the
+Software, and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED
+TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF
+CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+DEALINGS IN THE SOFTWARE.
+
+Author : Pritam Halder
+Email : pritamhalder.portfolio@gmail.com
+*/
+
+
+
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <memory>
+#include <span>
+#include <type_traits>
+#include <vector>
+
+#include "DEM.hpp"
+#include "Endian.hpp"
+#include "Map.hpp"
+#include "Parallel.hpp"
+
+
+
+// single raster over a region of a `Map` at any cellsize, resampled from all the DEM tiles under the region.
+// output cell (r, c) is the value at (NE latitude - r * cellsize, SW longitude + c * cellsize) of the output, as
+// `Map::altitude()` (`Nearest`) or `Map::interpolated_altitude()` (`Bilinear`) would return it, or the mean of the
+// valid DEM values within half a cellsize of it (`Average`, DEM tiles coarser than the output fall back to `Bilinear`).
+// DEM tiles repeating the first row / column of their southern / eastern neighbour as their last (SRTM style) have
+// those DEM values averaged once, from the neighbour.
+//
+// the DEM tiles are read one after the other, each exactly once through the map (its storage, halo & statistics
+// apply), the next DEM tile is read while the output blocks under the current one are resampled in parallel.
+class Mosaic {
+public:
+    enum class Resampling {
+        Nearest,
+        Bilinear,
+        Average
+    };
+
+
+    // mosaic of `map` over `region` (corners of the output are `region.SW` & a multiple of `cellsize` from it),
+    // `block` x `block` cells are resampled at a time on `threads` threads
+    template <dem_datatype T, std::endian endianness>
+    static DEM<float> compute(Map<T, endianness>& map, const Bounds& region, float cellsize, Resampling resampling = Resampling::Bilinear, size_t threads = 1, size_t block = 256) {
+        if (!(cellsize > 0)) {
+            throw std::runtime_error("mosaic cellsize must be positive");
+        }
+        if (!(region.NE.latitude > region.SW.latitude && region.NE.longitude > region.SW.longitude)) {
+            throw std::runtime_error("mosaic region is empty");
+        }
+
+        const size_t nrows = static_cast<size_t>(std::ceil((region.NE.latitude - region.SW.latitude) / cellsize - 1e-3f));
+        const size_t ncols = static_cast<size_t>(std::ceil((region.NE.longitude - region.SW.longitude) / cellsize - 1e-3f));
+        const float nodata = static_cast<float>(map.get_dem().type.nodata);
+
+        typename DEM<float>::Type type(std::max<size_t>(nrows, 1), std::max<size_t>(ncols, 1), region.SW.latitude, region.SW.longitude, cellsize, nodata);
+
+        Raster raster{type, DEM<float>::locate(type), std::vector<float>(type.nrows * type.ncols, nodata), std::max<size_t>(block, 1), resampling, {}, {}};
+        if (resampling == Resampling::Average) {
+            raster.sums.assign(raster.values.size(), 0);
+            raster.counts.assign(raster.values.size(), 0);
+        }
+
+        // grid cells under the region (& the footprints of its edge cells)
+        const float margin = resampling == Resampling::Average ? cellsize / 2 : 0;
+        const int south = static_cast<int>(std::floor(std::max(raster.bounds.SW.latitude - margin, -90.0f)));
+        const int north = static_cast<int>(std::floor(std::min(raster.bounds.NE.latitude + margin, 90.0f)));
+        const int west = static_cast<int>(std::floor(std::max(raster.bounds.SW.longitude - margin, -180.0f)));
+        const int east = static_cast<int>(std::floor(std::min(raster.bounds.NE.longitude + margin, 180.0f)));
+
+        std::vector<Coordinate> cells;
+        for (int latitude = north; latitude >= south; --latitude) {
+            for (int longitude = west; longitude <= east; ++longitude) {
+                cells.push_back({static_cast<float>(latitude) + 0.5f, static_cast<float>(longitude) + 0.5f});
+            }
+        }
+
+        // next DEM tile of the map, grid cells without one are skipped
+        size_t next = 0;
+        auto acquire = [&]() -> Source<T, endianness> {
+            for (; next < cells.size(); ++next) {
+                const Coordinate& cell = cells[next];
+                auto dem = map.acquire(cell.latitude, cell.longitude);
+                if (dem) return {Map<T, endianness>::key(cell.latitude, cell.longitude), dem, map.halo(cell.latitude, cell.longitude)};
+            }
+            return {};
+        };
+
+        auto current = acquire();
+        while (current.dem) {
+            const Coordinate cell = cells[next];
+            ++next;
+            Source<T, endianness> following;
+
+            // the map is only touched from this thread, which reads the next DEM tile while the others resample
+            resample(raster, current, extent(map, cell, *current.dem), threads, [&]() {
+                following = acquire();
+            });
+
+            current = std::move(following);
+        }
+
+        if (resampling == Resampling::Average) {
+            for (size_t i = 0; i < raster.values.size(); ++i) {
+                if (raster.counts[i] != 0) raster.values[i] = static_cast<float>(raster.sums[i] / raster.counts[i]);
+            }
+        }
+
+        return DEM<float>(type, std::move(raster.values));
+    };
+
+
+    // mosaic (see `compute()`) written as a `.bin` file of the DEM data type & byte order of the map (integer
+    // values are rounded), returns the `Type` to read it back with
+    template <dem_datatype T, std::endian endianness>
+    static typename DEM<T, endianness>::Type write(Map<T, endianness>& map, const Bounds& region, float cellsize, const std::filesystem::path& filepath, Resampling resampling = Resampling::Bilinear, size_t threads = 1, size_t block = 256) {
+        const DEM<float> mosaic = compute(map, region, cellsize, resampling, threads, block);
+        const T nodata = map.get_dem().type.nodata;
+
+        std::ofstream ofp(filepath, std::ios::binary | std::ios::trunc);
+        if (!ofp.good()) {
+            std::string e = "failed to create '" + filepath.string() + "'";
+            throw std::runtime_error(e);
+        }
+
+        // written row by row
+        const size_t ncols = mosaic.type.ncols;
+        std::vector<T> row(ncols);
+        for (size_t r = 0; r < mosaic.type.nrows; ++r) {
+            const float* values = mosaic.data().data() + r * ncols;
+            for (size_t c = 0; c < ncols; ++c) {
+                if (values[c] == mosaic.type.nodata) {
+                    row[c] = nodata;
+                } else if constexpr (std::is_integral_v<T>) {
+                    row[c] = static_cast<T>(std::lround(values[c]));
+                } else {
+                    row[c] = static_cast<T>(values[c]);
+                }
+            }
+            serialize<T, endianness>(row.data(), ncols);
+            ofp.write(reinterpret_cast<const char*>(row.data()), static_cast<std::streamsize>(ncols * sizeof(T)));
+        }
+
+        if (!ofp.good()) {
+            std::string e = "failed to write '" + filepath.string() + "'";
+            throw std::runtime_error(e);
+        }
+
+        return typename DEM<T, endianness>::Type(mosaic.type.nrows, ncols, mosaic.type.yllcorner, mosaic.type.xllcorner, mosaic.type.cellsize, nodata);
+    };
+
+
+private:
+    // output cells being resampled, returned as the mosaic `DEM`
+    struct Raster {
+        typename DEM<float>::Type type;
+        Bounds bounds;
+        std::vector<float> values;      // row-major output cells
+        size_t block;
+        Resampling resampling;
+        std::vector<double> sums;       // `Average` only
+        std::vector<uint32_t> counts;
+    };
+
+
+    // DEM tile of grid cell `key` & its halo (with `Map::Options::halo`)
+    template <dem_datatype T, std::endian endianness>
+    struct Source {
+        int32_t key = -1;
+        std::shared_ptr<const DEM<T, endianness>> dem;
+        std::shared_ptr<const Halo<T, endianness>> halo;
+    };
+
+
+    // output cells (rows [r0, r1) x columns [c0, c1)) the DEM tile of grid cell `k` contributes to,
+    // or the DEM rows & columns of a DEM tile `Average` takes
+    struct Window {
+        size_t r0, r1, c0, c1;
+    };
+
+
+    // DEM rows & columns of the DEM tile of the grid cell around `cell` that `Average` takes : without its last
+    // row / column when they repeat the first row / column of the neighbouring DEM tile
+    template <dem_datatype T, std::endian endianness>
+    static Window extent(const Map<T, endianness>& map, const Coordinate& cell, const DEM<T, endianness>& dem) {
+        Window window = {0, dem.type.nrows, 0, dem.type.ncols};
+
+        const typename DEM<T, endianness>::Type* own = map.describe(cell.latitude, cell.longitude);
+        const typename DEM<T, endianness>::Type* south = map.describe(cell.latitude - 1, cell.longitude);
+        const typename DEM<T, endianness>::Type* east = map.describe(cell.latitude, cell.longitude + 1);
+        if (own == nullptr) return window;
+
+        const double cellsize = own->cellsize;
+        const double north = static_cast<double>(own->yllcorner) + static_cast<double>(own->nrows) * cellsize;
+
+        if (south != nullptr) {
+            const double last = north - static_cast<double>(own->nrows - 1) * cellsize;
+            const double first = static_cast<double>(south->yllcorner) + static_cast<double>(south->nrows) * static_cast<double>(south->cellsize);
+            if (std::abs(last - first) < cellsize / 2) window.r1 -= 1;
+        }
+        if (east != nullptr) {
+            const double last = static_cast<double>(own->xllcorner) + static_cast<double>(own->ncols - 1) * cellsize;
+            if (std::abs(last - static_cast<double>(east->xllcorner)) < cellsize / 2) window.c1 -= 1;
+        }
+
+        return window;
+    };
+
+
+    // resamples the output blocks under the DEM tile of `source` on `threads` threads, while the calling thread
+    // runs `next()`
+    template <dem_datatype T, std::endian endianness, typename Next>
+    static void resample(Raster& raster, const Source<T, endianness>& source, const Window& extent, size_t threads, Next next) {
+        const DEM<T, endianness>& dem = *source.dem;
+        const float cellsize = raster.type.cellsize;
+        const float margin = raster.resampling == Resampling::Average ? cellsize / 2 : 0;
+
+        // output rows & columns near the DEM tile
+        auto range = [](float a, float b, size_t count) {
+            const size_t begin = static_cast<size_t>(std::clamp(std::floor(a) - 1, 0.0f, static_cast<float>(count)));
+            const size_t end = static_cast<size_t>(std::clamp(std::ceil(b) + 2, 0.0f, static_cast<float>(count)));
+            return std::pair<size_t, size_t>(begin, std::max(begin, end));
+        };
+        const auto rows = range(
+            (raster.bounds.NE.latitude - (dem.bounds.NE.latitude + margin)) / cellsize,
+            (raster.bounds.NE.latitude - (dem.bounds.SW.latitude - margin)) / cellsize,
+            raster.type.nrows
+        );
+        const auto columns = range(
+            (dem.bounds.SW.longitude - margin - raster.bounds.SW.longitude) / cellsize,
+            (dem.bounds.NE.longitude + margin - raster.bounds.SW.longitude) / cellsize,
+            raster.type.ncols
+        );
+        if (rows.first >= rows.second || columns.first >= columns.second) {
+            next();
+            return;
+        }
+
+        const size_t edge = raster.block;
+        const size_t block_r0 = rows.first / edge, block_r1 = (rows.second - 1) / edge;
+        const size_t block_c0 = columns.first / edge, block_c1 = (columns.second - 1) / edge;
+        const size_t block_cols = block_c1 - block_c0 + 1;
+        const size_t blocks = (block_r1 - block_r0 + 1) * block_cols;
+
+        // band 0 runs `next()` on the calling thread, the others are the output blocks
+        parallel_for(blocks + 1, std::max<size_t>(1, threads) + 1, [&](size_t b) {
+            if (b == 0) {
+                next();
+                return;
+            }
+
+            const size_t br = block_r0 + (b - 1) / block_cols, bc = block_c0 + (b - 1) % block_cols;
+            const Window window = {
+                std::max(br * edge, rows.first), std::min((br + 1) * edge, rows.second),
+                std::max(bc * edge, columns.first), std::min((bc + 1) * edge, columns.second)
+            };
+            fill(raster, source, extent, window);
+        });
+    };
+
+
+    // resamples the output cells of `window` from the DEM tile of `source`. `Average` adds its DEM values in `extent`
+    // to the footprints & interpolates only the cells it answers for that have no valid DEM value in their footprint yet
+    template <dem_datatype T, std::endian endianness>
+    static void fill(Raster& raster, const Source<T, endianness>& source, const Window& extent, const Window& window) {
+        const DEM<T, endianness>& dem = *source.dem;
+        const size_t ncols = raster.type.ncols;
+        const float cellsize = raster.type.cellsize;
+        const size_t width = window.c1 - window.c0;
+
+        std::vector<float> latitudes(width), longitudes(width), values(width);
+        std::vector<T> nearest(raster.resampling == Resampling::Nearest ? width : 0);
+        std::vector<size_t> owned(width);
+
+        for (size_t r = window.r0; r < window.r1; ++r) {
+            const float latitude = raster.bounds.NE.latitude - static_cast<float>(r) * cellsize;
+
+            if (raster.resampling == Resampling::Average) {
+                accumulate(raster, dem, extent, r, window.c0, window.c1);
+            }
+
+            // output cells answered by this DEM tile, as the map would pick the DEM tile
+            size_t count = 0;
+            for (size_t c = window.c0; c < window.c1; ++c) {
+                const float longitude = raster.bounds.SW.longitude + static_cast<float>(c) * cellsize;
+                if (Map<T, endianness>::key(latitude, longitude) != source.key) continue;
+                if (raster.resampling == Resampling::Average && raster.counts[r * ncols + c] != 0) continue;
+
+                latitudes[count] = latitude;
+                longitudes[count] = longitude;
+                owned[count++] = c;
+            }
+
+            if (count != 0) {
+                const std::span<const float> at_latitudes(latitudes.data(), count), at_longitudes(longitudes.data(), count);
+
+                if (raster.resampling == Resampling::Nearest) {
+                    if (source.halo) source.halo->altitude(dem, at_latitudes, at_longitudes, std::span<T>(nearest.data(), count));
+                    else dem.altitude(at_latitudes, at_longitudes, std::span<T>(nearest.data(), count));
+                    for (size_t i = 0; i < count; ++i) raster.values[r * ncols + owned[i]] = static_cast<float>(nearest[i]);
+                } else {
+                    if (source.halo) source.halo->interpolated_altitude(dem, at_latitudes, at_longitudes, std::span<float>(values.data(), count));
+                    else dem.interpolated_altitude(at_latitudes, at_longitudes, std::span<float>(values.data(), count));
+                    for (size_t i = 0; i < count; ++i) raster.values[r * ncols + owned[i]] = values[i];
+                }
+            }
+        }
+    };
+
+
+    // adds the valid DEM values of the DEM tile (rows & columns of `extent`) in the footprints of output cells (r, [c0, c1)),
+    // footprints are split half way between the output cells so that every DEM value falls in exactly one of them
+    template <dem_datatype T, std::endian endianness>
+    static void accumulate(Raster& raster, const DEM<T, endianness>& dem, const Window& extent, size_t r, size_t c0, size_t c1) {
+        const double cellsize = raster.type.cellsize, source = dem.type.cellsize;
+
+        // first DEM row / column at or past an edge of the footprints, clamped to the extent
+        auto row = [&](double edge) {
+            const double i = std::ceil((static_cast<double>(dem.bounds.NE.latitude) - edge) / source);
+            return static_cast<size_t>(std::clamp(i, static_cast<double>(extent.r0), static_cast<double>(extent.r1)));
+        };
+        auto column = [&](double edge) {
+            const double j = std::ceil((edge - static_cast<double>(dem.bounds.SW.longitude)) / source);
+            return static_cast<size_t>(std::clamp(j, static_cast<double>(extent.c0), static_cast<double>(extent.c1)));
+        };
+
+        // DEM rows with latitudes in (south edge, north edge] of the footprint
+        const double north = static_cast<double>(raster.bounds.NE.latitude) - (static_cast<double>(r) - 0.5) * cellsize;
+        const size_t dem_r0 = row(north), dem_r1 = row(north - cellsize);
+        if (dem_r0 >= dem_r1) return;
+
+        size_t dem_c0 = column(static_cast<double>(raster.bounds.SW.longitude) + (static_cast<double>(c0) - 0.5) * cellsize);
+        for (size_t c = c0; c < c1; ++c) {
+            // DEM columns with longitudes in [west edge, east edge) of the footprint
+            const size_t dem_c1 = column(static_cast<double>(raster.bounds.SW.longitude) + (static_cast<double>(c) + 0.5) * cellsize);
+
+            double sum = 0;
+            uint32_t count = 0;
+            for (size_t i = dem_r0; i < dem_r1; ++i) {
+                for (size_t j = dem_c0; j < dem_c1; ++j) {
+                    const T value = dem.at(i, j);
+                    if (value == dem.type.nodata) continue;
+                    sum += static_cast<double>(value);
+                    ++count;
+                }
+            }
+
+            raster.sums[r * raster.type.ncols + c] += sum;
+            raster.counts[r * raster.type.ncols + c] += count;
+            dem_c0 = std::max(dem_c0, dem_c1);
+        }
+    };
+};
@@ -0,0 +1,84 @@
+/*
+MIT License
+
+Copyright (c) 2023 Pritam Halder
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated
+documentation files (the "Software"), to deal in the Software without restriction, including without
+limitation the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the
+Software, and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED
+TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF
+CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+DEALINGS IN THE SOFTWARE.
+
+Author : Pritam Halder
+Email : pritamhalder.portfolio@gmail.com
+*/
+
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <exception>
+#include <mutex>
+#include <system_error>
+#include <thread>
+#include <utility>
+#include <vector>
+
+
+
+// runs `band(b)` for every band b in [0, `bands`) on atmost `threads` threads, the calling thread being one of
+// them : it runs band 0 & every thread then takes the next band not taken yet. the first exception thrown by a band
+// is rethrown once every thread is done, the bands not started by then are skipped
+template <typename Band>
+inline void parallel_for(size_t bands, size_t threads, Band band) {
+    threads = std::max<size_t>(1, std::min(threads, bands));
+    if (threads == 1) {
+        for (size_t b = 0; b < bands; ++b) band(b);
+        return;
+    }
+
+    std::atomic<size_t> next{1};
+    std::atomic<bool> failed{false};
+    std::exception_ptr error;
+    std::mutex error_mutex;
+
+    auto run = [&](size_t b) {
+        for (; b < bands && !failed.load(std::memory_order_relaxed); b = next.fetch_add(1)) {
+            try {
+                band(b);
+            } catch (...) {
+                std::lock_guard<std::mutex> lock(error_mutex);
+                if (!error) error = std::current_exception();
+                failed.store(true, std::memory_order_relaxed);
+            }
+        }
+    };
+
+    std::vector<std::thread> pool;
+    for (size_t t = 1; t < threads; ++t) {
+        // the bands left to threads that couldn't start are run by the others
+        try {
+            pool.emplace_back([&]() { run(next.fetch_add(1)); });
+        } catch (const std::system_error&) {
+            break;
+        }
+    }
+    run(0);
+    for (std::thread& t : pool) t.join();
+
+    if (error) std::rethrow_exception(error);
+}
+
+
+// [begin, end) of band `b` of `count` items split into `bands` contiguous bands of (almost) equal size
+inline std::pair<size_t, size_t> split(size_t count, size_t bands, size_t b) {
+    return {count * b / bands, count * (b + 1) / bands};
+}
@@ -0,0 +1,238 @@
+/*
+MIT License
+
+Copyright (c) 2023 Pritam Halder
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated
+documentation files (the "Software"), to deal in the Software without restriction, including without
+limitation the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the
+Software, and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED
+TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF
+CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+DEALINGS IN THE SOFTWARE.
+
+Author : Pritam Halder
+Email : pritamhalder.portfolio@gmail.com
+*/
+
+
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <filesystem>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <utility>
+
+#include "DEM.hpp"
+#include "SharedStore.hpp"
+#include "Statistics.hpp"
+
+
+
+// background loader of the DEM tiles ahead of a stream of queries.
+// the query positions are sampled into a short track, its heading & speed predict where the queries will be
+// `horizon` seconds later (atmost `reach` degrees ahead) and the DEM tiles on the way are loaded on a worker
+// thread, atmost `capacity` loaded tiles wait to be taken.
+template <dem_datatype T, std::endian endianness = std::endian::native>
+class Prefetcher {
+public:
+    using Tile = std::shared_ptr<const DEM<T, endianness>>;
+
+
+    Prefetcher(size_t capacity, float horizon, Storage storage = Storage::Heap, size_t blocks = 0, std::shared_ptr<Statistics> statistics = nullptr, std::shared_ptr<SharedStore> store = nullptr)
+        : capacity(std::max<size_t>(1, capacity)),
+        horizon(horizon),
+        storage(storage),
+        blocks(blocks),
+        statistics(statistics ? std::move(statistics) : std::make_shared<Statistics>()),
+        store(std::move(store))
+    {
+        this->worker = std::thread([this]() { this->run(); });
+    };
+
+
+    Prefetcher(const Prefetcher&) = delete;
+    Prefetcher& operator=(const Prefetcher&) = delete;
+
+
+    ~Prefetcher() {
+        {
+            std::lock_guard<std::mutex> lock(this->mutex);
+            this->stopping = true;
+        }
+        this->changed.notify_all();
+        this->worker.join();
+    };
+
+
+    // records a query position, every `stride` positions the track is extended and the position predicted
+    // `horizon` seconds ahead (atmost `reach` degrees away) is returned through (`latitude`, `longitude`)
+    bool observe(float& latitude, float& longitude) {
+        if (++this->observed % stride != 0) return false;
+
+        const double now = std::chrono::duration<double>(std::chrono::steady_clock::now().time_since_epoch()).count();
+        this->track.push_back({now, latitude, longitude});
+        if (this->track.size() > track_size) this->track.pop_front();
+
+        const Position& first = this->track.front();
+        const Position& last = this->track.back();
+        const double elapsed = last.time - first.time;
+        if (elapsed <= 0) return false;
+
+        // a fast stream of queries covers little ground per second of `horizon`, the displacement is clamped
+        double del_latitude = (static_cast<double>(last.latitude) - first.latitude) * (this->horizon / elapsed);
+        double del_longitude = (static_cast<double>(last.longitude) - first.longitude) * (this->horizon / elapsed);
+        const double distance = std::max(std::abs(del_latitude), std::abs(del_longitude));
+        if (distance > reach) {
+            del_latitude *= reach / distance;
+            del_longitude *= reach / distance;
+        }
+
+        latitude = static_cast<float>(last.latitude + del_latitude);
+        longitude = static_cast<float>(last.longitude + del_longitude);
+        return latitude != last.latitude || longitude != last.longitude;
+    };
+
+
+    // queues the load of the DEM tile of grid cell `key`, unless it is already queued, loading or loaded
+    void request(int32_t key, const typename DEM<T, endianness>::Type& type, const std::filesystem::path& filepath) {
+        {
+            std::lock_guard<std::mutex> lock(this->mutex);
+            if (key == this->loading || this->ready.contains(key)) return;
+            if (std::any_of(this->queue.begin(), this->queue.end(), [key](const Request& r) { return r.key == key; })) return;
+
+            // only the latest predictions are worth loading
+            if (this->queue.size() >= this->capacity) this->queue.pop_front();
+            this->queue.push_back({key, type, filepath});
+        }
+        this->changed.notify_all();
+    };
+
+
+    // prefetched DEM tile of grid cell `key`. a load of it in progress is waited for (the rest of its read only),
+    // empty if it is neither loaded nor loading (a queued load of it is dropped) or its load failed, the caller
+    // then loads the tile itself
+    Tile take(int32_t key) {
+        std::unique_lock<std::mutex> lock(this->mutex);
+
+        std::erase_if(this->queue, [key](const Request& r) { return r.key == key; });
+
+        if (key == this->loading) {
+            this->wanted = true;
+            this->changed.wait(lock, [this, key]() { return this->loading != key; });
+            return std::exchange(this->handed, nullptr);
+        }
+
+        auto found = this->ready.find(key);
+        if (found == this->ready.end()) return nullptr;
+
+        Tile dem = std::move(found->second.dem);
+        this->ready.erase(found);
+        return dem;
+    };
+
+
+private:
+    static constexpr size_t stride = 8;         // query positions per track sample
+    static constexpr size_t track_size = 8;     // track samples the heading & speed are estimated from
+    static constexpr double reach = 2;          // max. degrees the predicted position is ahead of the last one
+
+    struct Position {
+        double time;        // seconds
+        float latitude;
+        float longitude;
+    };
+
+    struct Request {
+        int32_t key;
+        typename DEM<T, endianness>::Type type;
+        std::filesystem::path filepath;
+    };
+
+    struct Loaded {
+        Tile dem;
+        uint64_t order;     // loading order, the oldest loaded tile is dropped first
+    };
+
+    const size_t capacity;
+    const float horizon;
+    const Storage storage;
+    const size_t blocks;
+    const std::shared_ptr<Statistics> statistics;  // shared with the owning map
+    const std::shared_ptr<SharedStore> store;       // with `Storage::Shared`
+
+    // owned by the querying thread
+    std::deque<Position> track;
+    uint64_t observed = 0;
+
+    // shared with the worker
+    std::mutex mutex;
+    std::condition_variable changed;
+    std::deque<Request> queue;
+    std::map<int32_t, Loaded> ready;
+    int32_t loading = -1;           // grid cell being loaded (-1 = none)
+    bool wanted = false;            // the querying thread waits for the grid cell being loaded
+    Tile handed;                    // DEM tile of the wanted grid cell, once loaded
+    uint64_t loads = 0;
+    bool stopping = false;
+    std::thread worker;
+
+
+    void run() {
+        std::unique_lock<std::mutex> lock(this->mutex);
+
+        while (true) {
+            this->changed.wait(lock, [this]() { return this->stopping || !this->queue.empty(); });
+            if (this->stopping) return;
+
+            Request request = std::move(this->queue.front());
+            this->queue.pop_front();
+            this->loading = request.key;
+            lock.unlock();
+
+            // a failed load is left to the querying thread, which reports the error
+            Tile dem;
+            const auto start = std::chrono::steady_clock::now();
+            size_t bytes = 0;
+            try {
+                dem = std::make_shared<const DEM<T, endianness>>(
+                    this->storage == Storage::Shared
+                    ? this->store->template open<T, endianness>(request.type, request.filepath, &bytes)
+                    : DEM<T, endianness>::open(request.type, request.filepath, this->storage, this->blocks, this->statistics)
+                );
+                if (dem->storage() == Storage::Heap) bytes = dem->resident_bytes();
+            } catch (...) {}
+
+            lock.lock();
+            this->loading = -1;
+            if (dem) this->statistics->load(start, bytes);
+
+            if (this->wanted) {
+                // handed straight to the waiting querying thread, never dropped for lack of room
+                this->wanted = false;
+                this->handed = std::move(dem);
+            } else if (dem) {
+                if (this->ready.size() >= this->capacity) {
+                    this->ready.erase(std::min_element(this->ready.begin(), this->ready.end(), [](const auto& a, const auto& b) {
+                        return a.second.order < b.second.order;
+                    }));
+                }
+                this->ready[request.key] = {std::move(dem), ++this->loads};
+            }
+            this->changed.notify_all();
+        }
+    };
+};
@@ -0,0 +1,597 @@
+/*
+MIT License
+
+Copyright (c) 2023 Pritam Halder
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated
+documentation files (the "Software"), to deal in the Software without restriction, including without
+limitation the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the
+Software, and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED
+TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF
+CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+DEALINGS IN THE SOFTWARE.
+
+Author : Pritam Halder
+Email : pritamhalder.portfolio@gmail.com
+*/
+
+
+#pragma once
+
+#include <algorithm>
+#include <bit>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <limits>
+#include <span>
+#include <vector>
+
+#include "DEM.hpp"
+#include "Parallel.hpp"
+
+
+
+// overview levels of a DEM at 2x, 4x, 8x ... coarser resolution, every overview cell keeps the min, max & mean
+// of the (valid) base DEM values it covers. overviews are anchored at the north west corner of the DEM, partial
+// cells at the southern & eastern edges cover only the base cells inside the DEM.
+// the levels also form a min / max quadtree over the base DEM for region statistics & clearance checks.
+//
+// `.ovr` file (little-endian), stored next to the base DEM file
+//      magic "DEMO", version (u16), reserved (u16), no. of levels (u32), reserved (u32)
+//      per level : factor (u32), reserved (u32), nrows (u64), ncols (u64), yllcorner, xllcorner, cellsize, nodata (f64),
+//                  offset of the values (u64)
+//      values : per level min, max & mean rasters (f32, row-major) and the no. of valid base DEM values under every
+//               cell (u32, row-major)
+class Pyramid {
+public:
+    enum class Statistic {
+        Min,
+        Max,
+        Mean
+    };
+
+
+    struct Level {
+        size_t factor;      // base DEM cells per overview cell along a side (2, 4, 8 ...)
+        DEM<float> min;
+        DEM<float> max;
+        DEM<float> mean;
+        std::vector<uint32_t> valid;    // no. of valid base DEM values under every cell
+
+        const DEM<float>& get(Statistic statistic) const {
+            switch (statistic) {
+                case Statistic::Min: return this->min;
+                case Statistic::Max: return this->max;
+                default: return this->mean;
+            }
+        };
+    };
+
+
+    std::vector<Level> levels;      // finest first
+
+
+    static std::filesystem::path path(const std::filesystem::path& dem_path) {
+        std::filesystem::path p = dem_path;
+        return p.replace_extension(".ovr");
+    };
+
+
+    // whether the levels are overviews of a base DEM of `nrows` x `ncols` values (an `.ovr` file of another DEM doesn't fit)
+    bool fits(size_t nrows, size_t ncols) const {
+        if (this->levels.empty()) return false;
+
+        for (const Level& level : this->levels) {
+            const size_t factor = level.factor;
+            if (factor == 0 || level.mean.type.nrows != (nrows + factor - 1) / factor || level.mean.type.ncols != (ncols + factor - 1) / factor) {
+                return false;
+            }
+        }
+        return true;
+    };
+
+
+    // overview levels of `dem` (`count` = 0 builds levels until a level fits in a single cell)
+    template <dem_datatype T, std::endian endianness>
+    static Pyramid build(const DEM<T, endianness>& dem, size_t count = 0, size_t threads = 1) {
+        const float nodata = static_cast<float>(dem.type.nodata);
+        Pyramid pyramid;
+
+        // statistics of the finer level, the base DEM is reduced straight from its values
+        Reduction finer;
+        size_t nrows = dem.type.nrows, ncols = dem.type.ncols;
+
+        for (size_t factor = 2; count == 0 || pyramid.levels.size() < count; factor *= 2) {
+            const size_t level_nrows = (nrows + 1) / 2, level_ncols = (ncols + 1) / 2;
+            Reduction level(level_nrows * level_ncols, nodata);
+
+            const size_t bands = std::max<size_t>(1, std::min(threads, level_nrows));
+            parallel_for(bands, bands, [&](size_t band) {
+                const auto [row_begin, row_end] = split(level_nrows, bands, band);
+                for (size_t r = row_begin; r < row_end; ++r) {
+                    for (size_t c = 0; c < level_ncols; ++c) {
+                        float min = std::numeric_limits<float>::max(), max = std::numeric_limits<float>::lowest();
+                        double sum = 0;
+                        uint32_t valid = 0;
+
+                        for (size_t i = 2*r; i < std::min(2*r + 2, nrows); ++i) {
+                            for (size_t j = 2*c; j < std::min(2*c + 2, ncols); ++j) {
+                                if (factor == 2) {
+                                    const T value = dem.at(i, j);
+                                    if (value == dem.type.nodata) continue;
+                                    min = std::min(min, static_cast<float>(value));
+                                    max = std::max(max, static_cast<float>(value));
+                                    sum += static_cast<double>(value);
+                                    valid += 1;
+                                } else {
+                                    const size_t k = i * ncols + j;
+                                    if (finer.valid[k] == 0) continue;
+                                    min = std::min(min, finer.min[k]);
+                                    max = std::max(max, finer.max[k]);
+                                    sum += static_cast<double>(finer.mean[k]) * finer.valid[k];
+                                    valid += finer.valid[k];
+                                }
+                            }
+                        }
+
+                        if (valid == 0) continue;
+
+                        const size_t k = r * level_ncols + c;
+                        level.min[k] = min;
+                        level.max[k] = max;
+                        level.mean[k] = static_cast<float>(sum / valid);
+                        level.valid[k] = valid;
+                    }
+                }
+            });
+
+            const float cellsize = dem.type.cellsize * static_cast<float>(factor);
+            size_t rows = level_nrows;
+
+            // rows reaching past the south pole are dropped
+            while (rows > 1 && dem.bounds.NE.latitude - cellsize * static_cast<float>(rows) < -90) --rows;
+
+            typename DEM<float>::Type type(
+                rows, level_ncols,
+                dem.bounds.NE.latitude - cellsize * static_cast<float>(rows), dem.type.xllcorner,
+                cellsize, nodata
+            );
+
+            pyramid.levels.push_back({
+                factor,
+                DEM<float>(type, std::vector<float>(level.min.begin(), level.min.begin() + rows * level_ncols)),
+                DEM<float>(type, std::vector<float>(level.max.begin(), level.max.begin() + rows * level_ncols)),
+                DEM<float>(type, std::vector<float>(level.mean.begin(), level.mean.begin() + rows * level_ncols)),
+                std::vector<uint32_t>(level.valid.begin(), level.valid.begin() + rows * level_ncols)
+            });
+
+            finer = std::move(level);
+            nrows = level_nrows;
+            ncols = level_ncols;
+
+            if (nrows == 1 && ncols == 1) break;
+        }
+
+        return pyramid;
+    };
+
+
+    // coarsest level with cells no larger than `resolution` (in the units of `cellsize`),
+    // the finest level when `resolution` is finer than every level
+    const Level& level(float resolution) const {
+        if (this->levels.empty()) {
+            throw std::runtime_error("pyramid has no overview levels");
+        }
+
+        const Level* best = &this->levels.front();
+        for (const Level& level : this->levels) {
+            if (level.mean.type.cellsize <= resolution) best = &level;
+        }
+        return *best;
+    };
+
+
+    // overview value at the requested resolution (see `level()`) of the cell covering the base DEM value
+    // `DEM::altitude` answers the coordinate with, i.e. the nearest base index floored into the level
+    float altitude(float latitude, float longitude, float resolution, Statistic statistic = Statistic::Mean) const {
+        const Level& level = this->level(resolution);
+        const DEM<float>& raster = level.get(statistic);
+
+        if (!raster.bounds.within(latitude, longitude)) {
+            return raster.type.nodata;
+        }
+
+        // exact, the level cellsize is the base cellsize times a power of 2
+        const float cellsize = raster.type.cellsize / static_cast<float>(level.factor);
+        const size_t row = static_cast<size_t>(std::round((raster.bounds.NE.latitude - latitude) / cellsize)) / level.factor;
+        const size_t column = static_cast<size_t>(std::round((longitude - raster.bounds.SW.longitude) / cellsize)) / level.factor;
+
+        return raster.at(std::min(row, raster.type.nrows - 1), std::min(column, raster.type.ncols - 1));
+    };
+
+
+    // min, max & mean of the valid DEM values inside a region
+    struct Summary {
+        float min;
+        float max;
+        float mean;
+        size_t count;       // no. of valid DEM values inside the region (min, max & mean are nodata when 0)
+    };
+
+
+    // statistics of the values of `dem` (the DEM the pyramid was built from) inside `box` (edges included),
+    // level cells inside the box are taken whole, only the cells crossing its edges are refined down to the DEM values
+    template <dem_datatype T, std::endian endianness>
+    Summary summarize(const DEM<T, endianness>& dem, const Bounds& box) const {
+        return this->reduce(dem, Box{box});
+    };
+
+
+    // statistics of the values of `dem` inside `polygon` (latitude, longitude vertices, even-odd rule)
+    template <dem_datatype T, std::endian endianness>
+    Summary summarize(const DEM<T, endianness>& dem, std::span<const Coordinate> polygon) const {
+        return this->reduce(dem, Polygon{polygon});
+    };
+
+
+    // whether any value of `dem` inside `box` is above `height`, level cells with a max not above `height` are skipped
+    template <dem_datatype T, std::endian endianness>
+    bool exceeds(const DEM<T, endianness>& dem, const Bounds& box, float height) const {
+        return this->above(dem, Box{box}, height);
+    };
+
+
+    template <dem_datatype T, std::endian endianness>
+    bool exceeds(const DEM<T, endianness>& dem, std::span<const Coordinate> polygon, float height) const {
+        return this->above(dem, Polygon{polygon}, height);
+    };
+
+
+    void save(const std::filesystem::path& filepath) const {
+        std::ofstream fp(filepath, std::ios::binary | std::ios::trunc);
+        if (!fp.good()) {
+            throw std::runtime_error("failed to create '" + filepath.string() + "'");
+        }
+
+        fp.write("DEMO", 4);
+        put<uint16_t>(fp, version);
+        put<uint16_t>(fp, 0);
+        put<uint32_t>(fp, static_cast<uint32_t>(this->levels.size()));
+        put<uint32_t>(fp, 0);
+
+        uint64_t offset = header_size + this->levels.size() * entry_size;
+        for (const Level& level : this->levels) {
+            const auto& type = level.mean.type;
+            put<uint32_t>(fp, static_cast<uint32_t>(level.factor));
+            put<uint32_t>(fp, 0);
+            put<uint64_t>(fp, type.nrows);
+            put<uint64_t>(fp, type.ncols);
+            put<double>(fp, type.yllcorner);
+            put<double>(fp, type.xllcorner);
+            put<double>(fp, type.cellsize);
+            put<double>(fp, type.nodata);
+            put<uint64_t>(fp, offset);
+            offset += type.nrows * type.ncols * (3 * sizeof(float) + sizeof(uint32_t));
+        }
+
+        std::vector<float> values;
+        for (const Level& level : this->levels) {
+            for (const DEM<float>* raster : {&level.min, &level.max, &level.mean}) {
+                values = raster->data();
+                serialize<float, std::endian::little>(values.data(), values.size());
+                fp.write(reinterpret_cast<const char*>(values.data()), static_cast<std::streamsize>(values.size() * sizeof(float)));
+            }
+
+            std::vector<uint32_t> valid = level.valid;
+            serialize<uint32_t, std::endian::little>(valid.data(), valid.size());
+            fp.write(reinterpret_cast<const char*>(valid.data()), static_cast<std::streamsize>(valid.size() * sizeof(uint32_t)));
+        }
+
+        if (!fp.good()) {
+            throw std::runtime_error("failed to write '" + filepath.string() + "'");
+        }
+    };
+
+
+    // levels of an `.ovr` file atleast `factor` times coarser than the base DEM (the coarsest level if none is),
+    // the finer levels are not read
+    static Pyramid load(const std::filesystem::path& filepath, size_t factor = 2) {
+        if (!std::filesystem::exists(filepath)) {
+            std::string e = "overview file '" + filepath.string() + "' not found";
+            throw std::runtime_error(e);
+        }
+
+        MappedFile file(filepath);
+        const uint8_t* bytes = file.data();
+
+        if (file.size() < header_size || std::memcmp(bytes, "DEMO", 4) != 0) {
+            std::string e = "'" + filepath.string() + "' is not a DEM overview file";
+            throw std::runtime_error(e);
+        }
+
+        if (get<uint16_t>(bytes + 4) != version) {
+            std::string e = "DEM overview file '" + filepath.string() + "' is of version " + std::to_string(get<uint16_t>(bytes + 4)) + " instead of " + std::to_string(version) + ", rebuild it";
+            throw std::runtime_error(e);
+        }
+
+        const size_t count = get<uint32_t>(bytes + 8);
+        if (file.size() < header_size + count * entry_size) {
+            std::string e = "truncated DEM overview file '" + filepath.string() + "'";
+            throw std::runtime_error(e);
+        }
+
+        size_t coarsest = 0;
+        for (size_t l = 0; l < count; ++l) {
+            coarsest = std::max<size_t>(coarsest, get<uint32_t>(bytes + header_size + l * entry_size));
+        }
+        factor = std::min(factor, coarsest);
+
+        Pyramid pyramid;
+        for (size_t l = 0; l < count; ++l) {
+            const uint8_t* entry = bytes + header_size + l * entry_size;
+            const size_t level_factor = get<uint32_t>(entry);
+            if (level_factor < factor) continue;
+
+            typename DEM<float>::Type type(
+                static_cast<size_t>(get<uint64_t>(entry + 8)), static_cast<size_t>(get<uint64_t>(entry + 16)),
+                static_cast<float>(get<double>(entry + 24)), static_cast<float>(get<double>(entry + 32)),
+                static_cast<float>(get<double>(entry + 40)), static_cast<float>(get<double>(entry + 48))
+            );
+
+            const size_t cells = type.nrows * type.ncols;
+            const uint64_t offset = get<uint64_t>(entry + 56);
+            if (offset + cells * (3 * sizeof(float) + sizeof(uint32_t)) > file.size()) {
+                std::string e = "truncated DEM overview file '" + filepath.string() + "'";
+                throw std::runtime_error(e);
+            }
+
+            auto raster = [&](size_t i) {
+                std::vector<float> values(cells);
+                std::memcpy(values.data(), bytes + offset + i * cells * sizeof(float), cells * sizeof(float));
+                serialize<float, std::endian::little>(values.data(), cells);
+                return DEM<float>(type, std::move(values));
+            };
+
+            std::vector<uint32_t> valid(cells);
+            std::memcpy(valid.data(), bytes + offset + 3 * cells * sizeof(float), cells * sizeof(uint32_t));
+            serialize<uint32_t, std::endian::little>(valid.data(), cells);
+
+            pyramid.levels.push_back({level_factor, raster(0), raster(1), raster(2), std::move(valid)});
+        }
+
+        return pyramid;
+    };
+
+
+private:
+    static constexpr uint16_t version = 2;
+    static constexpr size_t header_size = 16;
+    static constexpr size_t entry_size = 64;
+
+
+    // min, max & mean of the valid base DEM values under every cell of a level
+    struct Reduction {
+        std::vector<float> min;
+        std::vector<float> max;
+        std::vector<float> mean;
+        std::vector<uint32_t> valid;    // no. of valid base DEM values
+
+        Reduction() = default;
+
+        Reduction(size_t cells, float nodata)
+            : min(cells, nodata),
+            max(cells, nodata),
+            mean(cells, nodata),
+            valid(cells, 0)
+        {};
+    };
+
+
+    enum class Cover {
+        Outside,
+        Partial,
+        Inside
+    };
+
+
+    // box region, `cover()` classifies the rectangle spanned by a group of DEM cells (edges included)
+    struct Box {
+        Bounds box;
+
+        bool contains(float latitude, float longitude) const {
+            return latitude >= this->box.SW.latitude && latitude <= this->box.NE.latitude
+                && longitude >= this->box.SW.longitude && longitude <= this->box.NE.longitude;
+        };
+
+        Cover cover(float south, float north, float west, float east) const {
+            if (north < this->box.SW.latitude || south > this->box.NE.latitude || east < this->box.SW.longitude || west > this->box.NE.longitude) {
+                return Cover::Outside;
+            }
+            if (south >= this->box.SW.latitude && north <= this->box.NE.latitude && west >= this->box.SW.longitude && east <= this->box.NE.longitude) {
+                return Cover::Inside;
+            }
+            return Cover::Partial;
+        };
+    };
+
+
+    // polygon region (even-odd rule)
+    struct Polygon {
+        std::span<const Coordinate> vertices;
+
+        bool contains(float latitude, float longitude) const {
+            bool inside = false;
+            for (size_t i = 0, j = this->vertices.size() - 1; i < this->vertices.size(); j = i++) {
+                const Coordinate& a = this->vertices[i];
+                const Coordinate& b = this->vertices[j];
+                if ((a.latitude > latitude) != (b.latitude > latitude)
+                    && longitude < (b.longitude - a.longitude) * (latitude - a.latitude) / (b.latitude - a.latitude) + a.longitude
+                ) inside = !inside;
+            }
+            return inside;
+        };
+
+        // a rectangle no edge of the polygon reaches into is either inside or outside as a whole,
+        // the rectangle is widened by `margin` so that cells touched within the rounding of `contains()` are refined
+        Cover cover(float south, float north, float west, float east) const {
+            constexpr float margin = 1e-4f;
+            for (size_t i = 0, j = this->vertices.size() - 1; i < this->vertices.size(); j = i++) {
+                if (crosses(this->vertices[j], this->vertices[i], south - margin, north + margin, west - margin, east + margin)) return Cover::Partial;
+            }
+            return this->contains((south + north) / 2, (west + east) / 2) ? Cover::Inside : Cover::Outside;
+        };
+
+        // whether the segment `a` -> `b` reaches into the rectangle (Liang-Barsky clipping)
+        static bool crosses(const Coordinate& a, const Coordinate& b, float south, float north, float west, float east) {
+            double t0 = 0, t1 = 1;
+            auto clip = [&t0, &t1](double p, double q) {
+                if (p == 0) return q >= 0;
+                const double t = q / p;
+                if (p < 0) {
+                    if (t > t1) return false;
+                    t0 = std::max(t0, t);
+                } else {
+                    if (t < t0) return false;
+                    t1 = std::min(t1, t);
+                }
+                return true;
+            };
+
+            const double del_longitude = b.longitude - a.longitude, del_latitude = b.latitude - a.latitude;
+            return clip(-del_longitude, a.longitude - west) && clip(del_longitude, east - a.longitude)
+                && clip(-del_latitude, a.latitude - south) && clip(del_latitude, north - a.latitude);
+        };
+    };
+
+
+    template <dem_datatype T, std::endian endianness, typename Region>
+    Summary reduce(const DEM<T, endianness>& dem, const Region& region) const {
+        float min = std::numeric_limits<float>::max(), max = std::numeric_limits<float>::lowest();
+        double sum = 0;
+        size_t count = 0;
+
+        this->walk(dem, region,
+            [](const Level&, size_t) { return false; },
+            [&](const Level& level, size_t k) {
+                min = std::min(min, level.min.data()[k]);
+                max = std::max(max, level.max.data()[k]);
+                sum += static_cast<double>(level.mean.data()[k]) * level.valid[k];
+                count += level.valid[k];
+                return false;
+            },
+            [&](float value) {
+                min = std::min(min, value);
+                max = std::max(max, value);
+                sum += value;
+                count += 1;
+                return false;
+            }
+        );
+
+        const float nodata = static_cast<float>(dem.type.nodata);
+        if (count == 0) return {nodata, nodata, nodata, 0};
+        return {min, max, static_cast<float>(sum / static_cast<double>(count)), count};
+    };
+
+
+    template <dem_datatype T, std::endian endianness, typename Region>
+    bool above(const DEM<T, endianness>& dem, const Region& region, float height) const {
+        return this->walk(dem, region,
+            [height](const Level& level, size_t k) { return level.max.data()[k] <= height; },
+            [](const Level&, size_t) { return true; },
+            [height](float value) { return value > height; }
+        );
+    };
+
+
+    // walks the level cells covering the region from the coarsest level down : cells outside the region or with
+    // `prune(level, k)` are skipped, `whole(level, k)` takes the cells inside the region and the cells crossing its
+    // edge are split into the cells of the finer level, down to the DEM values inside the region (`value(v)`).
+    // stops as soon as a callback returns true
+    template <dem_datatype T, std::endian endianness, typename Region, typename Prune, typename Whole, typename Value>
+    bool walk(const DEM<T, endianness>& dem, const Region& region, Prune prune, Whole whole, Value value) const {
+        const size_t nrows = dem.type.nrows, ncols = dem.type.ncols;
+        const float cellsize = dem.type.cellsize;
+        const float north = dem.bounds.NE.latitude, west = dem.bounds.SW.longitude;
+
+        for (const Level& level : this->levels) {
+            if (level.mean.type.ncols != (ncols + level.factor - 1) / level.factor || level.valid.size() != level.mean.data().size()) {
+                throw std::runtime_error("pyramid doesn't match the DEM");
+            }
+        }
+
+        // DEM values of the cells [r0, r1) x [c0, c1) inside the region
+        auto base = [&](size_t r0, size_t r1, size_t c0, size_t c1) {
+            for (size_t r = r0; r < r1; ++r) {
+                const float latitude = north - static_cast<float>(r) * cellsize;
+                for (size_t c = c0; c < c1; ++c) {
+                    if (!region.contains(latitude, west + static_cast<float>(c) * cellsize)) continue;
+                    const T v = dem.at(r, c);
+                    if (v != dem.type.nodata && value(static_cast<float>(v))) return true;
+                }
+            }
+            return false;
+        };
+
+        auto visit = [&](auto& self, size_t l, size_t row, size_t column) -> bool {
+            const Level& level = this->levels[l];
+            const size_t factor = level.factor;
+            const size_t r0 = row * factor, r1 = std::min(r0 + factor, nrows);
+            const size_t c0 = column * factor, c1 = std::min(c0 + factor, ncols);
+            const size_t k = row * level.mean.type.ncols + column;
+
+            if (level.valid[k] == 0 || prune(level, k)) return false;
+
+            const Cover cover = region.cover(
+                north - static_cast<float>(r1 - 1) * cellsize, north - static_cast<float>(r0) * cellsize,
+                west + static_cast<float>(c0) * cellsize, west + static_cast<float>(c1 - 1) * cellsize
+            );
+            if (cover == Cover::Outside) return false;
+            if (cover == Cover::Inside) return whole(level, k);
+            if (l == 0) return base(r0, r1, c0, c1);
+
+            const Level& finer = this->levels[l - 1];
+            const size_t ratio = factor / finer.factor;
+            for (size_t i = row * ratio; i < std::min((row + 1) * ratio, finer.mean.type.nrows); ++i) {
+                for (size_t j = column * ratio; j < std::min((column + 1) * ratio, finer.mean.type.ncols); ++j) {
+                    if (self(self, l - 1, i, j)) return true;
+                }
+            }
+            return false;
+        };
+
+        if (this->levels.empty()) return base(0, nrows, 0, ncols);
+
+        const Level& top = this->levels.back();
+        for (size_t r = 0; r < top.mean.type.nrows; ++r) {
+            for (size_t c = 0; c < top.mean.type.ncols; ++c) {
+                if (visit(visit, this->levels.size() - 1, r, c)) return true;
+            }
+        }
+        return false;
+    };
+
+
+    template <typename U>
+    static U get(const uint8_t* bytes) {
+        U value;
+        std::memcpy(&value, bytes, sizeof(U));
+        serialize<U, std::endian::little>(&value, 1);
+        return value;
+    };
+
+
+    template <typename U>
+    static void put(std::ofstream& fp, U value) {
+        serialize<U, std::endian::little>(&value, 1);
+        fp.write(reinterpret_cast<const char*>(&value), sizeof(U));
+    };
+};
@@ -0,0 +1,444 @@
+/*
+MIT License
+
+Copyright (c) 2023 Pritam Halder
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated
+documentation files (the "Software"), to deal in the Software without restriction, including without
+limitation the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the
+Software, and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED
+TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF
+CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+DEALINGS IN THE SOFTWARE.
+
+Author : Pritam Halder
+Email : pritamhalder.portfolio@gmail.com
+*/
+
+
+
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include <memory>
+#include <span>
+#include <vector>
+
+#include "DEM.hpp"
+#include "Map.hpp"
+#include "Parallel.hpp"
+#include "Pyramid.hpp"
+
+
+
+// first intersection of 3D rays with the terrain (bilinear surface between the DEM values, earth curvature included).
+// rays are walked through the min / max quadtree of the DEM (see `Pyramid`) from the coarsest level down,
+// quadtree cells whose max is below the lowest point of the ray across them are skipped whole and only the DEM
+// cells left are intersected with the ray. DEM cells with a nodata value are holes in the terrain.
+class Raycast {
+public:
+    struct Ray {
+        Coordinate origin;
+        float altitude;     // meters, same datum as the DEM values
+        float azimuth;      // degrees clockwise from the north
+        float elevation;    // degrees above the horizontal (negative looks down)
+        float range;        // max. distance (meters) along the ray
+    };
+
+
+    struct Hit {
+        bool hit = false;
+        Coordinate point;       // terrain point hit by the ray
+        float altitude = 0;     // terrain altitude at the point
+        float distance = 0;     // meters along the ray from its origin
+    };
+
+
+    // intersection of `ray` with `dem`, walked through `quadtree` (built from `dem` with `Pyramid::build()`)
+    template <dem_datatype T, std::endian endianness>
+    static Hit cast(const DEM<T, endianness>& dem, const Pyramid& quadtree, const Ray& ray) {
+        check(dem, quadtree);
+        return first(dem, &quadtree, Line(ray), 0, ray.range);
+    };
+
+
+    // same without a quadtree, every DEM cell under the ray is intersected
+    template <dem_datatype T, std::endian endianness>
+    static Hit cast(const DEM<T, endianness>& dem, const Ray& ray) {
+        return first(dem, nullptr, Line(ray), 0, ray.range);
+    };
+
+
+    // batch form, the rays are spread over `threads` threads
+    template <dem_datatype T, std::endian endianness>
+    static void cast(const DEM<T, endianness>& dem, const Pyramid& quadtree, std::span<const Ray> rays, std::span<Hit> hits, size_t threads = 1) {
+        check(dem, quadtree);
+        batch(rays, hits, threads, [&](const Ray& ray) { return first(dem, &quadtree, Line(ray), 0, ray.range); });
+    };
+
+
+    // intersection of `ray` with the DEM tiles of the map (see `Map::quadtree()`), with `Options::halo` set the seams
+    // between the DEM tiles are intersected too (through the strips of the halos, see `Map::halo()`), otherwise a ray
+    // entering the terrain right at a seam is caught at the edge of the next DEM tile
+    template <dem_datatype T, std::endian endianness>
+    static Hit cast(Map<T, endianness>& map, const Ray& ray) {
+        Hit hit;
+        cast(map, std::span<const Ray>(&ray, 1), std::span<Hit>(&hit, 1));
+        return hit;
+    };
+
+
+    // batch form, the DEM tiles under the rays are loaded upfront and the rays are spread over `threads` threads
+    template <dem_datatype T, std::endian endianness>
+    static void cast(Map<T, endianness>& map, std::span<const Ray> rays, std::span<Hit> hits, size_t threads = 1) {
+        if (rays.size() != hits.size()) {
+            throw std::runtime_error("batch ray spans differ in size");
+        }
+
+        // every grid cell under the rays, sampled every 0.25 degree along their horizontal extent
+        std::vector<Tile<T, endianness>> tiles, seams;
+        for (const Ray& ray : rays) {
+            const Line line(ray);
+            const double extent = ray.range * line.horizontal;
+            const size_t steps = static_cast<size_t>(std::ceil(extent / (meters_per_degree * 0.25))) + 1;
+
+            for (size_t i = 0; i <= steps; ++i) {
+                const double t = ray.range * static_cast<double>(i) / static_cast<double>(steps);
+                const double latitude = line.latitude(t), longitude = line.longitude(t);
+                if (!(latitude >= -90 && latitude <= 90 && longitude >= -180 && longitude <= 180)) break;
+
+                // the tile, and the tiles across the borders of its grid cell
+                for (int del_latitude = -1; del_latitude <= 1; ++del_latitude) {
+                    for (int del_longitude = -1; del_longitude <= 1; ++del_longitude) {
+                        const float at_latitude = static_cast<float>(std::floor(latitude)) + 0.5f + static_cast<float>(del_latitude);
+                        const float at_longitude = static_cast<float>(std::floor(longitude)) + 0.5f + static_cast<float>(del_longitude);
+                        if (std::abs(at_latitude - latitude) > 1 || std::abs(at_longitude - longitude) > 1) continue;
+                        if (Map<T, endianness>::key(at_latitude, at_longitude) < 0) continue;
+                        if (std::any_of(tiles.begin(), tiles.end(), [&](const auto& tile) { return tile.dem->bounds.within(at_latitude, at_longitude); })) continue;
+
+                        auto dem = map.acquire(at_latitude, at_longitude);
+                        if (!dem || std::any_of(tiles.begin(), tiles.end(), [&](const auto& tile) { return tile.dem == dem; })) continue;
+                        tiles.push_back({dem, map.quadtree(at_latitude, at_longitude)});
+
+                        // the strips of the halo are walked as DEM tiles of their own
+                        if (auto halo = map.halo(at_latitude, at_longitude)) {
+                            for (const DEM<T, endianness>* strip : {&halo->north, &halo->south, &halo->west, &halo->east}) {
+                                seams.push_back({std::shared_ptr<const DEM<T, endianness>>(halo, strip), nullptr});
+                            }
+                        }
+                    }
+                }
+            }
+        }
+        tiles.insert(tiles.end(), seams.begin(), seams.end());
+
+        batch(rays, hits, threads, [&](const Ray& ray) { return walk(tiles, ray); });
+    };
+
+
+private:
+    static constexpr double meters_per_degree = 111320.0;
+    static constexpr double earth_radius = 6371000.0;
+    static constexpr double degree = 0.017453292519943295;
+    static constexpr size_t splits = 4;         // samples of the ray across a DEM cell before the crossing is refined
+    static constexpr size_t refinements = 24;   // bisections of the crossing
+
+
+    template <dem_datatype T, std::endian endianness>
+    struct Tile {
+        std::shared_ptr<const DEM<T, endianness>> dem;
+        std::shared_ptr<const Pyramid> quadtree;
+    };
+
+
+    // the ray as a function of the distance `t` along it : latitude & longitude are linear in `t` (local tangent plane),
+    // the height above the datum rises with the curvature of the earth
+    struct Line {
+        double origin_latitude;
+        double origin_longitude;
+        double altitude;
+        double vertical;        // sin(elevation)
+        double horizontal;      // cos(elevation)
+        double del_latitude;    // degrees per meter along the ray
+        double del_longitude;
+        double curvature;       // height gained per squared meter along the ray
+
+        explicit Line(const Ray& ray)
+            : origin_latitude(ray.origin.latitude),
+            origin_longitude(ray.origin.longitude),
+            altitude(ray.altitude),
+            vertical(std::sin(ray.elevation * degree)),
+            horizontal(std::cos(ray.elevation * degree))
+        {
+            this->del_latitude = this->horizontal * std::cos(ray.azimuth * degree) / meters_per_degree;
+            this->del_longitude = this->horizontal * std::sin(ray.azimuth * degree) / (meters_per_degree * std::max(std::cos(this->origin_latitude * degree), 1e-6));
+            this->curvature = this->horizontal * this->horizontal / (2 * earth_radius);
+        };
+
+        double latitude(double t) const { return this->origin_latitude + this->del_latitude * t; };
+        double longitude(double t) const { return this->origin_longitude + this->del_longitude * t; };
+        double height(double t) const { return this->altitude + this->vertical * t + this->curvature * t * t; };
+
+        // lowest height of the ray over [t0, t1] (the height is convex in `t`)
+        double lowest(double t0, double t1) const {
+            double t = this->curvature > 0 ? -this->vertical / (2 * this->curvature) : (this->vertical >= 0 ? t0 : t1);
+            return this->height(std::clamp(t, t0, t1));
+        };
+
+        // first `t` past `t0` the ray leaves the latitude & longitude box, `t0` if it is outside already
+        double exit(double t0, double south, double north, double west, double east) const {
+            double t = std::numeric_limits<double>::infinity();
+            if (this->del_latitude > 0) t = std::min(t, (north - this->origin_latitude) / this->del_latitude);
+            if (this->del_latitude < 0) t = std::min(t, (south - this->origin_latitude) / this->del_latitude);
+            if (this->del_longitude > 0) t = std::min(t, (east - this->origin_longitude) / this->del_longitude);
+            if (this->del_longitude < 0) t = std::min(t, (west - this->origin_longitude) / this->del_longitude);
+            return std::max(t, t0);
+        };
+
+        // first `t` past `t0` the ray enters the latitude & longitude box, infinity if it misses the box
+        double entry(double t0, double south, double north, double west, double east) const {
+            double enter = t0, leave = std::numeric_limits<double>::infinity();
+            auto slab = [&enter, &leave](double p0, double dp, double low, double high) {
+                if (dp == 0) {
+                    if (p0 < low || p0 > high) leave = -1;
+                    return;
+                }
+                double a = (low - p0) / dp, b = (high - p0) / dp;
+                if (a > b) std::swap(a, b);
+                enter = std::max(enter, a);
+                leave = std::min(leave, b);
+            };
+            slab(this->origin_latitude, this->del_latitude, south, north);
+            slab(this->origin_longitude, this->del_longitude, west, east);
+            return enter <= leave ? enter : std::numeric_limits<double>::infinity();
+        };
+    };
+
+
+    template <dem_datatype T, std::endian endianness>
+    static void check(const DEM<T, endianness>& dem, const Pyramid& quadtree) {
+        for (const Pyramid::Level& level : quadtree.levels) {
+            if (level.mean.type.ncols != (dem.type.ncols + level.factor - 1) / level.factor || level.valid.size() != level.max.data().size()) {
+                throw std::runtime_error("quadtree doesn't match the DEM");
+            }
+        }
+    };
+
+
+    template <typename Cast>
+    static void batch(std::span<const Ray> rays, std::span<Hit> hits, size_t threads, Cast cast) {
+        if (rays.size() != hits.size()) {
+            throw std::runtime_error("batch ray spans differ in size");
+        }
+
+        // rays are cast in chunks, taken by the threads as they become free
+        static constexpr size_t chunk = 64;
+        parallel_for((rays.size() + chunk - 1) / chunk, threads, [&](size_t b) {
+            for (size_t i = b * chunk; i < std::min((b + 1) * chunk, rays.size()); ++i) hits[i] = cast(rays[i]);
+        });
+    };
+
+
+    // ray walked across the DEM tiles, each DEM tile takes the ray over the box between its first & last DEM values,
+    // grid cells without a DEM tile are crossed in one step
+    template <dem_datatype T, std::endian endianness>
+    static Hit walk(const std::vector<Tile<T, endianness>>& tiles, const Ray& ray) {
+        const Line line(ray);
+        double t = 0;
+
+        while (t <= ray.range) {
+            const double latitude = line.latitude(t), longitude = line.longitude(t);
+            if (!(latitude >= -90 && latitude <= 90 && longitude >= -180 && longitude <= 180)) break;
+
+            // the DEM tile taking the ray the farthest from here, else the nearest DEM tile ahead
+            const Tile<T, endianness>* next = nullptr;
+            double end = t, ahead = std::numeric_limits<double>::infinity();
+            for (const auto& tile : tiles) {
+                const DEM<T, endianness>& dem = *tile.dem;
+                const double north = dem.bounds.NE.latitude, west = dem.bounds.SW.longitude;
+                const double south = north - static_cast<double>(dem.type.nrows - 1) * dem.type.cellsize;
+                const double east = west + static_cast<double>(dem.type.ncols - 1) * dem.type.cellsize;
+
+                if (latitude < south || latitude > north || longitude < west || longitude > east) {
+                    ahead = std::min(ahead, line.entry(t, south, north, west, east));
+                    continue;
+                }
+
+                const double exit = line.exit(t, south, north, west, east);
+                if (exit > end) {
+                    next = &tile;
+                    end = exit;
+                }
+            }
+
+            if (next == nullptr) {
+                end = std::min(ahead, line.exit(t, std::floor(latitude), std::floor(latitude) + 1, std::floor(longitude), std::floor(longitude) + 1));
+            } else {
+                Hit hit = first(*next->dem, next->quadtree.get(), line, t, std::min<double>(end, ray.range));
+                if (hit.hit) return hit;
+            }
+
+            // step just past the border
+            t = end + std::max(1e-3, end * 1e-9);
+        }
+
+        return {};
+    };
+
+
+    // first intersection of the ray with the DEM over [t0, t1]
+    template <dem_datatype T, std::endian endianness>
+    static Hit first(const DEM<T, endianness>& dem, const Pyramid* quadtree, const Line& line, double t0, double t1) {
+        const size_t nrows = dem.type.nrows, ncols = dem.type.ncols;
+        if (nrows < 2 || ncols < 2) return {};
+
+        // (row, column) index of the ray, linear in `t`
+        const double cellsize = dem.type.cellsize;
+        const double row_0 = (dem.bounds.NE.latitude - line.origin_latitude) / cellsize, del_row = -line.del_latitude / cellsize;
+        const double column_0 = (line.origin_longitude - dem.bounds.SW.longitude) / cellsize, del_column = line.del_longitude / cellsize;
+
+        // clip to the DEM cells (between the first & the last DEM values)
+        auto clip = [&t0, &t1](double p0, double dp, double high) {
+            if (dp == 0) {
+                if (p0 < 0 || p0 > high) t1 = -1;
+                return;
+            }
+            double a = (0 - p0) / dp, b = (high - p0) / dp;
+            if (a > b) std::swap(a, b);
+            t0 = std::max(t0, a);
+            t1 = std::min(t1, b);
+        };
+        clip(row_0, del_row, static_cast<double>(nrows - 1));
+        clip(column_0, del_column, static_cast<double>(ncols - 1));
+        if (t0 > t1) return {};
+
+        const T nodata = dem.type.nodata;
+        double hit = -1;
+
+        // DEM cell (r, c) : ray against the bilinear surface between its 4 corner values
+        auto cell = [&](size_t r, size_t c, double ta, double tb) {
+            const T corners[4] = {dem.at(r, c), dem.at(r, c + 1), dem.at(r + 1, c), dem.at(r + 1, c + 1)};
+            float top = -std::numeric_limits<float>::infinity();
+            for (T v : corners) {
+                if (v == nodata) return false;
+                top = std::max(top, static_cast<float>(v));
+            }
+            if (line.lowest(ta, tb) > top) return false;
+
+            auto above = [&](double t) {
+                const double u = std::clamp(row_0 + del_row * t - static_cast<double>(r), 0.0, 1.0);
+                const double v = std::clamp(column_0 + del_column * t - static_cast<double>(c), 0.0, 1.0);
+                const double terrain = (1 - u) * ((1 - v) * corners[0] + v * corners[1]) + u * ((1 - v) * corners[2] + v * corners[3]);
+                return line.height(t) - terrain;
+            };
+
+            if (above(ta) <= 0) {
+                hit = ta;
+                return true;
+            }
+
+            for (size_t k = 1; k <= splits; ++k) {
+                double high = ta + (tb - ta) * static_cast<double>(k) / splits;
+                if (above(high) > 0) continue;
+
+                double low = ta + (tb - ta) * static_cast<double>(k - 1) / splits;
+                for (size_t i = 0; i < refinements; ++i) {
+                    const double middle = (low + high) / 2;
+                    (above(middle) > 0 ? low : high) = middle;
+                }
+                hit = high;
+                return true;
+            }
+            return false;
+        };
+
+        const size_t levels = quadtree != nullptr ? quadtree->levels.size() : 0;
+
+        // cells of a grid `size` DEM cells wide crossed by the ray over [ta, tb] in order, restricted to
+        // rows [r0, r1] & columns [c0, c1], `visit(row, column, ta, tb)` returns true to stop
+        auto march = [&](double size, size_t r0, size_t r1, size_t c0, size_t c1, double ta, double tb, auto visit) {
+            const double dr = del_row / size, dc = del_column / size;
+            const double rt = (row_0 + del_row * ta) / size, ct = (column_0 + del_column * ta) / size;
+
+            size_t r = static_cast<size_t>(std::clamp(std::floor(rt), static_cast<double>(r0), static_cast<double>(r1)));
+            size_t c = static_cast<size_t>(std::clamp(std::floor(ct), static_cast<double>(c0), static_cast<double>(c1)));
+
+            const double infinity = std::numeric_limits<double>::infinity();
+            auto crossing = [](double p0, double dp, double p) { return (p - p0) / dp; };
+
+            double t = ta;
+            while (t < tb) {
+                const double next_r = dr > 0 ? crossing(row_0 / size, dr, static_cast<double>(r + 1)) : (dr < 0 ? crossing(row_0 / size, dr, static_cast<double>(r)) : infinity);
+                const double next_c = dc > 0 ? crossing(column_0 / size, dc, static_cast<double>(c + 1)) : (dc < 0 ? crossing(column_0 / size, dc, static_cast<double>(c)) : infinity);
+                const double end = std::min({next_r, next_c, tb});
+
+                if (end > t && visit(r, c, t, end)) return true;
+                t = std::max(t, end);
+
+                if (next_r <= next_c) {
+                    if (dr > 0 ? r == r1 : r == r0) break;
+                    r = dr > 0 ? r + 1 : r - 1;
+                } else {
+                    if (dc > 0 ? c == c1 : c == c0) break;
+                    c = dc > 0 ? c + 1 : c - 1;
+                }
+            }
+            return false;
+        };
+
+        // quadtree cell (row, column) of level `l`, its DEM cells reach into the next row & column of the level
+        auto descend = [&](auto& self, size_t l, size_t row, size_t column, double ta, double tb) -> bool {
+            const Pyramid::Level& level = quadtree->levels[l];
+            const size_t level_rows = level.max.type.nrows, level_cols = level.max.type.ncols;
+
+            float top = -std::numeric_limits<float>::infinity();
+            for (size_t i = row; i < std::min(row + 2, level_rows); ++i) {
+                for (size_t j = column; j < std::min(column + 2, level_cols); ++j) {
+                    const size_t k = i * level_cols + j;
+                    if (level.valid[k] != 0) top = std::max(top, level.max.data()[k]);
+                }
+            }
+            if (line.lowest(ta, tb) > top) return false;
+
+            // DEM cells or cells of the finer level inside this cell
+            const size_t size = l == 0 ? 1 : quadtree->levels[l - 1].factor;
+            const size_t ratio = level.factor / size;
+            const size_t last_r = (l == 0 ? nrows - 1 : quadtree->levels[l - 1].max.type.nrows) - 1;
+            const size_t last_c = (l == 0 ? ncols - 1 : quadtree->levels[l - 1].max.type.ncols) - 1;
+            const size_t r0 = row * ratio, c0 = column * ratio;
+            if (r0 > last_r || c0 > last_c) return false;
+
+            return march(static_cast<double>(size), r0, std::min(r0 + ratio - 1, last_r), c0, std::min(c0 + ratio - 1, last_c), ta, tb,
+                [&](size_t r, size_t c, double a, double b) {
+                    return l == 0 ? cell(r, c, a, b) : self(self, l - 1, r, c, a, b);
+                }
+            );
+        };
+
+        bool found;
+        if (levels == 0) {
+            found = march(1, 0, nrows - 2, 0, ncols - 2, t0, t1, cell);
+        } else {
+            const Pyramid::Level& top = quadtree->levels.back();
+            found = march(static_cast<double>(top.factor), 0, top.max.type.nrows - 1, 0, top.max.type.ncols - 1, t0, t1,
+                [&](size_t r, size_t c, double a, double b) { return descend(descend, levels - 1, r, c, a, b); }
+            );
+        }
+        if (!found) return {};
+
+        Hit result;
+        result.hit = true;
+        result.point = {static_cast<float>(line.latitude(hit)), static_cast<float>(line.longitude(hit))};
+        result.altitude = static_cast<float>(line.height(hit));
+        result.distance = static_cast<float>(hit);
+        return result;
+    };
+};
@@ -0,0 +1,305 @@
+/*
+MIT License
+
+Copyright (c) 2023 Pritam Halder
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated
+documentation files (the "Software"), to deal in the Software without restriction, including without
+limitation the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the
+Software, and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED
+TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF
+CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+DEALINGS IN THE SOFTWARE.
+
+Author : Pritam Halder
+Email : pritamhalder.portfolio@gmail.com
+*/
+
+
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+    #define DEM_SIMD_SSE2 1
+    #include <emmintrin.h>
+#endif
+
+#if defined(DEM_SIMD_SSE2) && (defined(__x86_64__) || defined(__i386__)) && (defined(__GNUC__) || defined(__clang__))
+    // AVX2 & AVX-512 kernels are compiled for their own targets and selected at runtime
+    #define DEM_SIMD_DISPATCH 1
+    #include <immintrin.h>
+#endif
+
+// the blend kernels must round like the scalar `Bilinear` : GCC would otherwise fuse their multiplies & adds into FMAs
+#if defined(__GNUC__) && !defined(__clang__)
+    #define DEM_SIMD_NO_CONTRACT __attribute__((optimize("fp-contract=off")))
+#else
+    #define DEM_SIMD_NO_CONTRACT
+#endif
+
+
+
+// vectorized kernels used by the batch queries of `DEM` (SoA layout, float lanes)
+class SIMD {
+public:
+    enum class ISA {
+        Scalar,
+        SSE2,
+        AVX2,
+        AVX512
+    };
+
+
+    // widest instruction set available on the running CPU
+    static ISA isa() {
+        static const ISA detected = detect();
+        return detected;
+    };
+
+
+    // fractional (row, column) index of every coordinate from the top left corner of the raster, offsets are
+    // multiplied by `reciprocal` = 1 / cellsize as in `DEM::index`, coordinates outside [south, north) x [west, east) get a row of -1
+    static void index(
+        const float* latitudes, const float* longitudes, size_t count,
+        float north, float south, float west, float east, float reciprocal,
+        float* rows, float* columns
+    ) {
+        size_t i = 0;
+
+        switch (isa()) {
+#if defined(DEM_SIMD_DISPATCH)
+            case ISA::AVX512: i = index_avx512(latitudes, longitudes, count, north, south, west, east, reciprocal, rows, columns); break;
+            case ISA::AVX2: i = index_avx2(latitudes, longitudes, count, north, south, west, east, reciprocal, rows, columns); break;
+#endif
+#if defined(DEM_SIMD_SSE2)
+            case ISA::SSE2: i = index_sse2(latitudes, longitudes, count, north, south, west, east, reciprocal, rows, columns); break;
+#endif
+            default: break;
+        }
+
+        for (; i < count; ++i) {
+            const float latitude = latitudes[i], longitude = longitudes[i];
+            const bool within = latitude >= south && latitude < north && longitude >= west && longitude < east;
+            rows[i] = within ? (north - latitude) * reciprocal : -1.0f;
+            columns[i] = within ? (longitude - west) * reciprocal : -1.0f;
+        }
+    };
+
+
+    // bilinear blend of the four neighbours of every point (weights as in `DEM::interpolated_altitude`)
+    DEM_SIMD_NO_CONTRACT
+    static void blend(
+        const float* v00, const float* v01, const float* v10, const float* v11,
+        const float* dy, const float* dx, size_t count,
+        float* out
+    ) {
+        size_t i = 0;
+
+        switch (isa()) {
+#if defined(DEM_SIMD_DISPATCH)
+            case ISA::AVX512: i = blend_avx512(v00, v01, v10, v11, dy, dx, count, out); break;
+            case ISA::AVX2: i = blend_avx2(v00, v01, v10, v11, dy, dx, count, out); break;
+#endif
+#if defined(DEM_SIMD_SSE2)
+            case ISA::SSE2: i = blend_sse2(v00, v01, v10, v11, dy, dx, count, out); break;
+#endif
+            default: break;
+        }
+
+        for (; i < count; ++i) {
+            out[i] =    (1-dy[i]) * (1-dx[i]) * v00[i] +
+                        dx[i] * (1-dy[i]) * v01[i] +
+                        (1-dx[i]) * dy[i] * v10[i] +
+                        dy[i] * dx[i] * v11[i];
+        }
+    };
+
+
+private:
+    static ISA detect() {
+#if defined(DEM_SIMD_DISPATCH)
+        __builtin_cpu_init();
+        if (__builtin_cpu_supports("avx512f")) return ISA::AVX512;
+        if (__builtin_cpu_supports("avx2")) return ISA::AVX2;
+#endif
+#if defined(DEM_SIMD_SSE2)
+        return ISA::SSE2;
+#else
+        return ISA::Scalar;
+#endif
+    };
+
+
+#if defined(DEM_SIMD_SSE2)
+    static size_t index_sse2(
+        const float* latitudes, const float* longitudes, size_t count,
+        float north, float south, float west, float east, float reciprocal,
+        float* rows, float* columns
+    ) {
+        const __m128 n = _mm_set1_ps(north), s = _mm_set1_ps(south), w = _mm_set1_ps(west), e = _mm_set1_ps(east);
+        const __m128 scale = _mm_set1_ps(reciprocal), outside = _mm_set1_ps(-1.0f);
+
+        size_t i = 0;
+        for (; i + 4 <= count; i += 4) {
+            const __m128 latitude = _mm_loadu_ps(latitudes + i);
+            const __m128 longitude = _mm_loadu_ps(longitudes + i);
+
+            const __m128 within = _mm_and_ps(
+                _mm_and_ps(_mm_cmpge_ps(latitude, s), _mm_cmplt_ps(latitude, n)),
+                _mm_and_ps(_mm_cmpge_ps(longitude, w), _mm_cmplt_ps(longitude, e))
+            );
+
+            const __m128 row = _mm_mul_ps(_mm_sub_ps(n, latitude), scale);
+            const __m128 column = _mm_mul_ps(_mm_sub_ps(longitude, w), scale);
+
+            _mm_storeu_ps(rows + i, _mm_or_ps(_mm_and_ps(within, row), _mm_andnot_ps(within, outside)));
+            _mm_storeu_ps(columns + i, _mm_or_ps(_mm_and_ps(within, column), _mm_andnot_ps(within, outside)));
+        }
+
+        return i;
+    };
+
+
+    DEM_SIMD_NO_CONTRACT
+    static size_t blend_sse2(
+        const float* v00, const float* v01, const float* v10, const float* v11,
+        const float* dy, const float* dx, size_t count,
+        float* out
+    ) {
+        const __m128 one = _mm_set1_ps(1.0f);
+
+        size_t i = 0;
+        for (; i + 4 <= count; i += 4) {
+            const __m128 y = _mm_loadu_ps(dy + i), x = _mm_loadu_ps(dx + i);
+            const __m128 y1 = _mm_sub_ps(one, y), x1 = _mm_sub_ps(one, x);
+
+            __m128 sum = _mm_mul_ps(_mm_mul_ps(y1, x1), _mm_loadu_ps(v00 + i));
+            sum = _mm_add_ps(sum, _mm_mul_ps(_mm_mul_ps(x, y1), _mm_loadu_ps(v01 + i)));
+            sum = _mm_add_ps(sum, _mm_mul_ps(_mm_mul_ps(x1, y), _mm_loadu_ps(v10 + i)));
+            sum = _mm_add_ps(sum, _mm_mul_ps(_mm_mul_ps(y, x), _mm_loadu_ps(v11 + i)));
+
+            _mm_storeu_ps(out + i, sum);
+        }
+
+        return i;
+    };
+#endif
+
+
+#if defined(DEM_SIMD_DISPATCH)
+    __attribute__((target("avx2")))
+    static size_t index_avx2(
+        const float* latitudes, const float* longitudes, size_t count,
+        float north, float south, float west, float east, float reciprocal,
+        float* rows, float* columns
+    ) {
+        const __m256 n = _mm256_set1_ps(north), s = _mm256_set1_ps(south), w = _mm256_set1_ps(west), e = _mm256_set1_ps(east);
+        const __m256 scale = _mm256_set1_ps(reciprocal), outside = _mm256_set1_ps(-1.0f);
+
+        size_t i = 0;
+        for (; i + 8 <= count; i += 8) {
+            const __m256 latitude = _mm256_loadu_ps(latitudes + i);
+            const __m256 longitude = _mm256_loadu_ps(longitudes + i);
+
+            const __m256 within = _mm256_and_ps(
+                _mm256_and_ps(_mm256_cmp_ps(latitude, s, _CMP_GE_OQ), _mm256_cmp_ps(latitude, n, _CMP_LT_OQ)),
+                _mm256_and_ps(_mm256_cmp_ps(longitude, w, _CMP_GE_OQ), _mm256_cmp_ps(longitude, e, _CMP_LT_OQ))
+            );
+
+            const __m256 row = _mm256_mul_ps(_mm256_sub_ps(n, latitude), scale);
+            const __m256 column = _mm256_mul_ps(_mm256_sub_ps(longitude, w), scale);
+
+            _mm256_storeu_ps(rows + i, _mm256_blendv_ps(outside, row, within));
+            _mm256_storeu_ps(columns + i, _mm256_blendv_ps(outside, column, within));
+        }
+
+        return i;
+    };
+
+
+    __attribute__((target("avx2"))) DEM_SIMD_NO_CONTRACT
+    static size_t blend_avx2(
+        const float* v00, const float* v01, const float* v10, const float* v11,
+        const float* dy, const float* dx, size_t count,
+        float* out
+    ) {
+        const __m256 one = _mm256_set1_ps(1.0f);
+
+        size_t i = 0;
+        for (; i + 8 <= count; i += 8) {
+            const __m256 y = _mm256_loadu_ps(dy + i), x = _mm256_loadu_ps(dx + i);
+            const __m256 y1 = _mm256_sub_ps(one, y), x1 = _mm256_sub_ps(one, x);
+
+            __m256 sum = _mm256_mul_ps(_mm256_mul_ps(y1, x1), _mm256_loadu_ps(v00 + i));
+            sum = _mm256_add_ps(sum, _mm256_mul_ps(_mm256_mul_ps(x, y1), _mm256_loadu_ps(v01 + i)));
+            sum = _mm256_add_ps(sum, _mm256_mul_ps(_mm256_mul_ps(x1, y), _mm256_loadu_ps(v10 + i)));
+            sum = _mm256_add_ps(sum, _mm256_mul_ps(_mm256_mul_ps(y, x), _mm256_loadu_ps(v11 + i)));
+
+            _mm256_storeu_ps(out + i, sum);
+        }
+
+        return i;
+    };
+
+
+    __attribute__((target("avx512f")))
+    static size_t index_avx512(
+        const float* latitudes, const float* longitudes, size_t count,
+        float north, float south, float west, float east, float reciprocal,
+        float* rows, float* columns
+    ) {
+        const __m512 n = _mm512_set1_ps(north), s = _mm512_set1_ps(south), w = _mm512_set1_ps(west), e = _mm512_set1_ps(east);
+        const __m512 scale = _mm512_set1_ps(reciprocal), outside = _mm512_set1_ps(-1.0f);
+
+        size_t i = 0;
+        for (; i + 16 <= count; i += 16) {
+            const __m512 latitude = _mm512_loadu_ps(latitudes + i);
+            const __m512 longitude = _mm512_loadu_ps(longitudes + i);
+
+            const __mmask16 within =
+                _mm512_cmp_ps_mask(latitude, s, _CMP_GE_OQ) & _mm512_cmp_ps_mask(latitude, n, _CMP_LT_OQ) &
+                _mm512_cmp_ps_mask(longitude, w, _CMP_GE_OQ) & _mm512_cmp_ps_mask(longitude, e, _CMP_LT_OQ);
+
+            const __m512 row = _mm512_mul_ps(_mm512_sub_ps(n, latitude), scale);
+            const __m512 column = _mm512_mul_ps(_mm512_sub_ps(longitude, w), scale);
+
+            _mm512_storeu_ps(rows + i, _mm512_mask_blend_ps(within, outside, row));
+            _mm512_storeu_ps(columns + i, _mm512_mask_blend_ps(within, outside, column));
+        }
+
+        return i;
+    };
+
+
+    __attribute__((target("avx512f"))) DEM_SIMD_NO_CONTRACT
+    static size_t blend_avx512(
+        const float* v00, const float* v01, const float* v10, const float* v11,
+        const float* dy, const float* dx, size_t count,
+        float* out
+    ) {
+        const __m512 one = _mm512_set1_ps(1.0f);
+
+        size_t i = 0;
+        for (; i + 16 <= count; i += 16) {
+            const __m512 y = _mm512_loadu_ps(dy + i), x = _mm512_loadu_ps(dx + i);
+            const __m512 y1 = _mm512_sub_ps(one, y), x1 = _mm512_sub_ps(one, x);
+
+            __m512 sum = _mm512_mul_ps(_mm512_mul_ps(y1, x1), _mm512_loadu_ps(v00 + i));
+            sum = _mm512_add_ps(sum, _mm512_mul_ps(_mm512_mul_ps(x, y1), _mm512_loadu_ps(v01 + i)));
+            sum = _mm512_add_ps(sum, _mm512_mul_ps(_mm512_mul_ps(x1, y), _mm512_loadu_ps(v10 + i)));
+            sum = _mm512_add_ps(sum, _mm512_mul_ps(_mm512_mul_ps(y, x), _mm512_loadu_ps(v11 + i)));
+
+            _mm512_storeu_ps(out + i, sum);
+        }
+
+        return i;
+    };
+#endif
+};
@@ -0,0 +1,721 @@
+/*
+MIT License
+
+Copyright (c) 2023 Pritam Halder
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated
+documentation files (the "Software"), to deal in the Software without restriction, including without
+limitation the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the
+Software, and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED
+TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF
+CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+DEALINGS IN THE SOFTWARE.
+
+Author : Pritam Halder
+Email : pritamhalder.portfolio@gmail.com
+*/
+
+
+
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <ctime>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <type_traits>
+
+#if !defined(_WIN32)
+    #include <fcntl.h>
+    #include <pthread.h>
+    #include <signal.h>
+    #include <sys/mman.h>
+    #include <sys/stat.h>
+    #include <unistd.h>
+#endif
+
+#include "DEM.hpp"
+#include "Endian.hpp"
+
+
+
+// registry of decoded DEM values in named POSIX shared memory, shared by every process attached to the same
+// store name on a host. every DEM tile is decoded (read & byte swapped) once into its own segment, processes
+// asking for a DEM tile already in the store map its segment instead. the registry counts the references each
+// process holds on a segment, segments no process refers to are kept until they are evicted (least recently used
+// first) to make room under the byte budget of the store. references of processes that died are dropped when the
+// store runs out of room, and a load left behind by a dead process is taken over by the next process asking.
+//
+// segments are found by their full key (see `identity()`) & sample type, a digest of both only speeds up the search.
+// DEM values that don't fit under the budget (or past `max_holders` referring processes, or with keys longer than
+// `max_key` bytes) are decoded onto the heap of the asking process. segments outlive the processes, `remove()` unlinks the store & its segments.
+class SharedStore {
+public:
+    struct Usage {
+        size_t tiles;       // segments in the store
+        size_t bytes;       // bytes of DEM values in the store
+        size_t budget;      // max. bytes of DEM values (0 = no limit)
+        size_t held;        // segments referred to by atleast one process
+    };
+
+
+    // attaches to the store `name` (letters, digits, '_', '-' & '.'), created with room for `slots` segments &
+    // `budget` bytes of DEM values (0 = no limit) by the first process. later processes take the store as created
+    SharedStore(const std::string& name, size_t budget, size_t slots = 1024) {
+#if defined(_WIN32)
+        throw std::runtime_error("shared DEM stores need POSIX shared memory");
+#else
+        check(name);
+        if (slots == 0) {
+            throw std::runtime_error("shared store needs atleast 1 slot");
+        }
+
+        this->name = name;
+        this->registry = std::make_shared<Registry>("/" + name, budget, slots);
+#endif
+    };
+
+
+    SharedStore(const SharedStore&) = delete;
+    SharedStore& operator=(const SharedStore&) = delete;
+    ~SharedStore() = default;
+
+
+    // values of the DEM tile (`.bin` described by `type`, or `.tile`) from the store, decoded into it on a miss
+    // (`decoded` is set to the bytes of values this call decoded, 0 when it attached to values already stored)
+    template <dem_datatype T, std::endian endianness>
+    DEM<T, endianness> open(const typename DEM<T, endianness>::Type& type, const std::filesystem::path& filepath, size_t* decoded = nullptr) {
+        if (!std::filesystem::exists(filepath)) {
+            std::string e = "DEM file '" + filepath.string() + "' not found";
+            throw std::runtime_error(e);
+        }
+
+        const size_t count = type.nrows * type.ncols;
+        if (decoded != nullptr) *decoded = 0;
+
+        auto values = this->acquire<T>(identity<endianness>(filepath), count, [&](T* out) {
+            if (decoded != nullptr) *decoded = count * sizeof(T);
+
+            if (filepath.extension() == ".tile") {
+                const DEM<T, endianness> dem(filepath);
+                if (dem.data().size() != count) {
+                    std::string e = "DEM tile '" + filepath.string() + "' doesn't match the DEM dimensions";
+                    throw std::runtime_error(e);
+                }
+                std::copy(dem.data().begin(), dem.data().end(), out);
+                return;
+            }
+
+            std::ifstream fp(filepath, std::ios::binary);
+            fp.read(reinterpret_cast<char*>(out), static_cast<std::streamsize>(count * sizeof(T)));
+            if (!fp.good() || static_cast<size_t>(fp.gcount()) != count * sizeof(T)) {
+                std::string e = "failed to read DEM data from '" + filepath.string() + "'";
+                throw std::runtime_error(e);
+            }
+
+            serialize<T, endianness>(out, count);
+        });
+
+        return DEM<T, endianness>(type, std::move(values));
+    };
+
+
+    // `count` values stored under `key`, produced by `fill` (run by exactly one process) on a miss.
+    // the values stay mapped as long as the returned handle (or a copy of it) is alive
+    template <dem_datatype T>
+    std::shared_ptr<const T> acquire(std::string_view key, size_t count, const std::function<void(T*)>& fill) {
+#if defined(_WIN32)
+        (void) key;
+        (void) count;
+        (void) fill;
+        return nullptr;
+#else
+        const uint64_t tag = sample<T>();
+        const uint64_t hash = digest(key, tag);
+        const size_t bytes = count * sizeof(T);
+        Registry& r = *this->registry;
+
+        Slot* slot = nullptr;
+        uint64_t generation = 0;
+        bool stored = false;    // `slot` is `Ready` & held by this process
+        {
+            Lock lock(r);
+
+            // keys longer than `max_key` are never stored
+            while (key.size() <= max_key) {
+                slot = r.find(hash, bytes, tag, key);
+
+                if (slot != nullptr && slot->state == Slot::Ready) {
+                    if (!r.hold(*slot)) {
+                        slot = nullptr;
+                        break;
+                    }
+                    slot->used = ++r.header->clock;
+                    stored = true;
+                    break;
+                }
+
+                if (slot != nullptr && slot->state == Slot::Loading) {
+                    // the loading process died, its load is taken over
+                    if (!alive(slot->loader)) {
+                        r.drop(*slot);
+                        continue;
+                    }
+                    lock.wait();
+                    continue;
+                }
+
+                slot = r.claim(hash, bytes, tag, key);
+                break;
+            }
+
+            if (slot != nullptr) generation = slot->generation;
+        }
+
+        // mapped after the registry is unlocked, the reference held keeps the segment from being evicted meanwhile
+        if (stored) return this->attach<T>(r.position(*slot), generation, bytes);
+
+        // no room in the store
+        if (slot == nullptr) {
+            std::shared_ptr<T[]> values(new T[count]);
+            fill(values.get());
+            return std::shared_ptr<const T>(values, values.get());
+        }
+
+        T* values = nullptr;
+        try {
+            values = static_cast<T*>(create(segment(generation), bytes));
+            fill(values);
+            if (bytes != 0) ::mprotect(values, bytes, PROT_READ);
+        } catch (...) {
+            if (values != nullptr) ::munmap(values, bytes);
+
+            Lock lock(r);
+            r.drop(*slot);
+            lock.notify();
+            throw;
+        }
+
+        Lock lock(r);
+        r.hold(*slot);
+        slot->state = Slot::Ready;
+        slot->used = ++r.header->clock;
+        lock.notify();
+
+        return this->release(values, r.position(*slot), generation, bytes);
+#endif
+    };
+
+
+    // key of the DEM values decoded from a file (path, size & modification time), a rewritten file is decoded again
+    template <std::endian endianness>
+    static std::string identity(const std::filesystem::path& filepath) {
+        const auto written = std::filesystem::last_write_time(filepath).time_since_epoch().count();
+        return std::filesystem::absolute(filepath).lexically_normal().string()
+            + "|" + std::to_string(std::filesystem::file_size(filepath))
+            + "|" + std::to_string(written)
+            + "|" + (endianness == std::endian::big ? "be" : "le");
+    };
+
+
+    Usage usage() const {
+        Usage u = {0, 0, 0, 0};
+#if !defined(_WIN32)
+        Registry& r = *this->registry;
+        Lock lock(r);
+
+        u.budget = static_cast<size_t>(r.header->budget);
+        for (size_t i = 0; i < r.header->slots; ++i) {
+            const Slot& slot = r.slots[i];
+            if (slot.state != Slot::Ready) continue;
+
+            ++u.tiles;
+            u.bytes += static_cast<size_t>(slot.bytes);
+            if (slot.holders != 0) ++u.held;
+        }
+#endif
+        return u;
+    };
+
+
+    // unlinks the store `name` & all its segments, processes still attached keep their mappings
+    static void remove(const std::string& name) {
+#if !defined(_WIN32)
+        check(name);
+
+        const std::string path = "/" + name;
+        int fd = ::shm_open(path.c_str(), O_RDWR, 0);
+        if (fd < 0) return;
+
+        struct stat st;
+        if (::fstat(fd, &st) == 0 && static_cast<size_t>(st.st_size) >= sizeof(Header)) {
+            void* p = ::mmap(nullptr, static_cast<size_t>(st.st_size), PROT_READ, MAP_SHARED, fd, 0);
+            if (p != MAP_FAILED) {
+                const Header* header = static_cast<const Header*>(p);
+                const Slot* slots = reinterpret_cast<const Slot*>(header + 1);
+                const size_t n = std::min<size_t>(header->slots, (static_cast<size_t>(st.st_size) - sizeof(Header)) / sizeof(Slot));
+
+                for (size_t i = 0; i < n; ++i) {
+                    if (slots[i].state != Slot::Empty) ::shm_unlink(segment_path(name, slots[i].generation).c_str());
+                }
+                ::munmap(p, static_cast<size_t>(st.st_size));
+            }
+        }
+
+        ::close(fd);
+        ::shm_unlink(path.c_str());
+#else
+        (void) name;
+#endif
+    };
+
+
+private:
+    static constexpr uint32_t magic = 0x44454d53;     // "DEMS"
+    static constexpr uint32_t version = 1;
+    static constexpr size_t max_holders = 64;         // processes referring to one segment
+    static constexpr size_t max_key = 4096;           // bytes of a key kept in a slot
+
+    std::string name;
+
+
+    static void check(const std::string& name) {
+        const bool valid = !name.empty() && name.size() < 200 && std::all_of(name.begin(), name.end(), [](char c) {
+            return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9') || c == '_' || c == '-' || c == '.';
+        });
+        if (!valid) {
+            std::string e = "invalid shared store name '" + name + "'";
+            throw std::runtime_error(e);
+        }
+    };
+
+
+    // sample type tag, values of different types never share a segment
+    template <dem_datatype T>
+    static uint64_t sample() {
+        return sizeof(T) | (std::is_floating_point_v<T> ? 0x100 : 0) | (std::is_signed_v<T> ? 0x200 : 0);
+    };
+
+
+    // FNV-1a of the key & the sample type tag
+    static uint64_t digest(std::string_view key, uint64_t tag) {
+        uint64_t hash = 0xcbf29ce484222325ull;
+        auto mix = [&hash](uint8_t byte) {
+            hash ^= byte;
+            hash *= 0x100000001b3ull;
+        };
+        for (char c : key) mix(static_cast<uint8_t>(c));
+        for (size_t i = 0; i < 8; ++i) mix(static_cast<uint8_t>(tag >> (8 * i)));
+        return hash == 0 ? 1 : hash;
+    };
+
+
+    static std::string segment_path(const std::string& name, uint64_t generation) {
+        return "/" + name + "." + std::to_string(generation);
+    };
+
+
+    std::string segment(uint64_t generation) const {
+        return segment_path(this->name, generation);
+    };
+
+
+#if !defined(_WIN32)
+    struct Holder {
+        pid_t pid;
+        uint32_t references;
+    };
+
+    struct Slot {
+        enum State : uint32_t {Empty, Loading, Ready};
+
+        uint64_t hash;          // digest of `key` & `sample`, compared first
+        uint64_t bytes;
+        uint64_t sample;        // sample type tag of the values
+        uint64_t generation;    // segment name suffix, new for every load
+        uint64_t used;          // `Header::clock` value of the last acquire
+        uint32_t state;
+        pid_t loader;           // process decoding the values while `Loading`
+        uint32_t holders;       // processes referring to the segment
+        uint32_t length;        // bytes of `key`
+        Holder holding[max_holders];
+        char key[max_key];      // last, only read for slots whose digest matches
+
+        bool is(uint64_t hash, uint64_t bytes, uint64_t sample, std::string_view key) const {
+            return this->hash == hash && this->bytes == bytes && this->sample == sample
+                && this->length == key.size() && std::memcmp(this->key, key.data(), key.size()) == 0;
+        };
+    };
+
+    struct Header {
+        uint32_t magic;
+        uint32_t version;
+        std::atomic<uint32_t> ready;    // set once the registry is initialized
+        uint32_t slots;
+        uint64_t budget;
+        uint64_t bytes;
+        uint64_t clock;
+        uint64_t generation;
+        pthread_mutex_t mutex;
+        pthread_cond_t changed;
+    };
+
+
+    static bool alive(pid_t pid) {
+        return pid == ::getpid() || ::kill(pid, 0) == 0 || errno != ESRCH;
+    };
+
+
+    // creates a segment of `bytes` bytes mapped writable
+    static void* create(const std::string& path, size_t bytes) {
+        int fd = ::shm_open(path.c_str(), O_CREAT | O_EXCL | O_RDWR, 0644);
+        if (fd < 0 && errno == EEXIST) {
+            // left behind by a store removed while in use
+            ::shm_unlink(path.c_str());
+            fd = ::shm_open(path.c_str(), O_CREAT | O_EXCL | O_RDWR, 0644);
+        }
+        if (fd < 0) {
+            std::string e = "failed to create shared memory '" + path + "'";
+            throw std::runtime_error(e);
+        }
+
+        if (::ftruncate(fd, static_cast<off_t>(bytes)) != 0) {
+            ::close(fd);
+            ::shm_unlink(path.c_str());
+            std::string e = "failed to size shared memory '" + path + "'";
+            throw std::runtime_error(e);
+        }
+
+        void* p = bytes == 0 ? nullptr : ::mmap(nullptr, bytes, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+        ::close(fd);
+        if (p == MAP_FAILED) {
+            ::shm_unlink(path.c_str());
+            std::string e = "failed to map shared memory '" + path + "'";
+            throw std::runtime_error(e);
+        }
+
+        return p;
+    };
+
+
+    // the registry segment : header followed by the slots
+    struct Registry {
+        std::string path;
+        Header* header = nullptr;
+        Slot* slots = nullptr;
+        size_t length = 0;
+
+
+        Registry(const std::string& path, size_t budget, size_t slots)
+            : path(path)
+        {
+            const size_t length = sizeof(Header) + slots * sizeof(Slot);
+
+            int fd = ::shm_open(path.c_str(), O_CREAT | O_EXCL | O_RDWR, 0644);
+            const bool creator = fd >= 0;
+            if (!creator && errno == EEXIST) fd = ::shm_open(path.c_str(), O_RDWR, 0);
+            if (fd < 0) {
+                std::string e = "failed to open shared store '" + path + "'";
+                throw std::runtime_error(e);
+            }
+
+            if (creator) {
+                if (::ftruncate(fd, static_cast<off_t>(length)) != 0) {
+                    ::close(fd);
+                    ::shm_unlink(path.c_str());
+                    std::string e = "failed to size shared store '" + path + "'";
+                    throw std::runtime_error(e);
+                }
+                this->length = length;
+            } else {
+                // the creating process may still be sizing the registry
+                struct stat st;
+                for (size_t i = 0; ::fstat(fd, &st) == 0 && static_cast<size_t>(st.st_size) < sizeof(Header); ++i) {
+                    if (i == 5000) break;
+                    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+                }
+                if (static_cast<size_t>(st.st_size) < sizeof(Header)) {
+                    ::close(fd);
+                    std::string e = "shared store '" + path + "' is not initialized";
+                    throw std::runtime_error(e);
+                }
+                this->length = static_cast<size_t>(st.st_size);
+            }
+
+            void* p = ::mmap(nullptr, this->length, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+            ::close(fd);
+            if (p == MAP_FAILED) {
+                std::string e = "failed to map shared store '" + path + "'";
+                throw std::runtime_error(e);
+            }
+
+            this->header = static_cast<Header*>(p);
+            this->slots = reinterpret_cast<Slot*>(this->header + 1);
+
+            if (creator) {
+                // zero filled by ftruncate, every slot starts `Empty`
+                this->header->magic = magic;
+                this->header->version = version;
+                this->header->slots = static_cast<uint32_t>(slots);
+                this->header->budget = budget;
+
+                pthread_mutexattr_t mutex_attributes;
+                pthread_mutexattr_init(&mutex_attributes);
+                pthread_mutexattr_setpshared(&mutex_attributes, PTHREAD_PROCESS_SHARED);
+                pthread_mutexattr_setrobust(&mutex_attributes, PTHREAD_MUTEX_ROBUST);
+                pthread_mutex_init(&this->header->mutex, &mutex_attributes);
+                pthread_mutexattr_destroy(&mutex_attributes);
+
+                pthread_condattr_t condition_attributes;
+                pthread_condattr_init(&condition_attributes);
+                pthread_condattr_setpshared(&condition_attributes, PTHREAD_PROCESS_SHARED);
+                pthread_cond_init(&this->header->changed, &condition_attributes);
+                pthread_condattr_destroy(&condition_attributes);
+
+                this->header->ready.store(magic, std::memory_order_release);
+            } else {
+                for (size_t i = 0; this->header->ready.load(std::memory_order_acquire) != magic && i < 5000; ++i) {
+                    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+                }
+
+                if (
+                    this->header->ready.load(std::memory_order_acquire) != magic
+                    || this->header->version != version
+                    || this->length < sizeof(Header) + this->header->slots * sizeof(Slot)
+                ) {
+                    ::munmap(this->header, this->length);
+                    std::string e = "shared store '" + path + "' has an incompatible layout";
+                    throw std::runtime_error(e);
+                }
+            }
+        };
+
+
+        Registry(const Registry&) = delete;
+        Registry& operator=(const Registry&) = delete;
+
+
+        ~Registry() {
+            if (this->header != nullptr) ::munmap(this->header, this->length);
+        };
+
+
+        Slot* find(uint64_t hash, uint64_t bytes, uint64_t sample, std::string_view key) {
+            for (size_t i = 0; i < this->header->slots; ++i) {
+                Slot& slot = this->slots[i];
+                if (slot.state != Slot::Empty && slot.is(hash, bytes, sample, key)) return &slot;
+            }
+            return nullptr;
+        };
+
+
+        size_t position(const Slot& slot) const {
+            return static_cast<size_t>(&slot - this->slots);
+        };
+
+
+        // a slot (marked `Loading` by this process) for `bytes` bytes of values under `key`, evicting the least
+        // recently used segments no live process refers to, nullptr if there is no room
+        Slot* claim(uint64_t hash, uint64_t bytes, uint64_t sample, std::string_view key) {
+            const uint64_t budget = this->header->budget;
+            if (budget != 0 && bytes > budget) return nullptr;
+
+            bool pruned = false;
+            while (true) {
+                Slot* empty = nullptr;
+                Slot* lru = nullptr;
+
+                for (size_t i = 0; i < this->header->slots; ++i) {
+                    Slot& slot = this->slots[i];
+                    if (slot.state == Slot::Empty) {
+                        if (empty == nullptr) empty = &slot;
+                    } else if (slot.state == Slot::Ready && slot.holders == 0 && (lru == nullptr || slot.used < lru->used)) {
+                        lru = &slot;
+                    }
+                }
+
+                const bool fits = budget == 0 || this->header->bytes + bytes <= budget;
+                if (empty != nullptr && fits) {
+                    empty->hash = hash;
+                    empty->bytes = bytes;
+                    empty->sample = sample;
+                    empty->length = static_cast<uint32_t>(key.size());
+                    std::memcpy(empty->key, key.data(), key.size());
+                    empty->generation = ++this->header->generation;
+                    empty->used = ++this->header->clock;
+                    empty->state = Slot::Loading;
+                    empty->loader = ::getpid();
+                    empty->holders = 0;
+                    this->header->bytes += bytes;
+                    return empty;
+                }
+
+                if (lru != nullptr) {
+                    this->drop(*lru);
+                    continue;
+                }
+
+                // references of dead processes are dropped once, then the store is full
+                if (pruned) return nullptr;
+                pruned = true;
+                for (size_t i = 0; i < this->header->slots; ++i) this->prune(this->slots[i]);
+            }
+        };
+
+
+        // frees a slot & unlinks its segment (processes that mapped it keep their mapping)
+        void drop(Slot& slot) {
+            ::shm_unlink((this->path + "." + std::to_string(slot.generation)).c_str());
+            this->header->bytes -= slot.bytes;
+            slot.state = Slot::Empty;
+            slot.hash = 0;
+            slot.length = 0;
+            slot.holders = 0;
+        };
+
+
+        // one more reference of this process, false if the slot can't take another process
+        bool hold(Slot& slot) {
+            const pid_t pid = ::getpid();
+            for (size_t i = 0; i < slot.holders; ++i) {
+                if (slot.holding[i].pid == pid) {
+                    ++slot.holding[i].references;
+                    return true;
+                }
+            }
+
+            if (slot.holders == max_holders) this->prune(slot);
+            if (slot.holders == max_holders) return false;
+
+            slot.holding[slot.holders++] = {pid, 1};
+            return true;
+        };
+
+
+        void unhold(Slot& slot) {
+            const pid_t pid = ::getpid();
+            for (size_t i = 0; i < slot.holders; ++i) {
+                if (slot.holding[i].pid == pid) {
+                    if (--slot.holding[i].references == 0) slot.holding[i] = slot.holding[--slot.holders];
+                    return;
+                }
+            }
+        };
+
+
+        // drops the references of dead processes
+        void prune(Slot& slot) {
+            if (slot.state != Slot::Ready) return;
+            for (size_t i = 0; i < slot.holders;) {
+                if (alive(slot.holding[i].pid)) {
+                    ++i;
+                } else {
+                    slot.holding[i] = slot.holding[--slot.holders];
+                }
+            }
+        };
+    };
+
+
+    // registry mutex, robust against processes dying while holding it
+    class Lock {
+    public:
+        explicit Lock(Registry& registry)
+            : header(registry.header)
+        {
+            if (pthread_mutex_lock(&this->header->mutex) == EOWNERDEAD) {
+                pthread_mutex_consistent(&this->header->mutex);
+            }
+        };
+
+        Lock(const Lock&) = delete;
+        Lock& operator=(const Lock&) = delete;
+
+        ~Lock() {
+            pthread_mutex_unlock(&this->header->mutex);
+        };
+
+        // waits for a change of the registry, atmost 100 ms (a loading process may die without notifying)
+        void wait() {
+            timespec deadline;
+            ::clock_gettime(CLOCK_REALTIME, &deadline);
+            deadline.tv_nsec += 100000000;
+            if (deadline.tv_nsec >= 1000000000) {
+                deadline.tv_sec += 1;
+                deadline.tv_nsec -= 1000000000;
+            }
+            if (pthread_cond_timedwait(&this->header->changed, &this->header->mutex, &deadline) == EOWNERDEAD) {
+                pthread_mutex_consistent(&this->header->mutex);
+            }
+        };
+
+        void notify() {
+            pthread_cond_broadcast(&this->header->changed);
+        };
+
+    private:
+        Header* header;
+    };
+
+
+    std::shared_ptr<Registry> registry;
+
+
+    // maps the segment of the `Ready` slot at `index` (of `generation`, already held by this process),
+    // called without the registry lock
+    template <dem_datatype T>
+    std::shared_ptr<const T> attach(size_t index, uint64_t generation, size_t bytes) {
+        const std::string path = this->segment(generation);
+
+        void* p = nullptr;
+        if (bytes != 0) {
+            int fd = ::shm_open(path.c_str(), O_RDONLY, 0);
+            p = fd < 0 ? MAP_FAILED : ::mmap(nullptr, bytes, PROT_READ, MAP_SHARED, fd, 0);
+            if (fd >= 0) ::close(fd);
+
+            if (p == MAP_FAILED) {
+                unhold(*this->registry, index, generation);
+                std::string e = "failed to map shared memory '" + path + "'";
+                throw std::runtime_error(e);
+            }
+        }
+
+        return this->release(static_cast<T*>(p), index, generation, bytes);
+    };
+
+
+    // handle over mapped values, dropping the reference of this process on the slot with the last copy
+    template <dem_datatype T>
+    std::shared_ptr<const T> release(T* values, size_t index, uint64_t generation, size_t bytes) {
+        std::shared_ptr<Registry> registry = this->registry;
+
+        return std::shared_ptr<const T>(values, [registry, index, generation, bytes](const T* p) {
+            if (p != nullptr) ::munmap(const_cast<T*>(p), bytes);
+            unhold(*registry, index, generation);
+        });
+    };
+
+
+    // drops the reference of this process on the slot at `index`, unless the slot was reused since
+    static void unhold(Registry& registry, size_t index, uint64_t generation) {
+        Lock lock(registry);
+        Slot& slot = registry.slots[index];
+        if (slot.state == Slot::Ready && slot.generation == generation) registry.unhold(slot);
+    };
+#endif
+};
@@ -0,0 +1,146 @@
+/*
+MIT License
+
+Copyright (c) 2023 Pritam Halder
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated
+documentation files (the "Software"), to deal in the Software without restriction, including without
+limitation the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the
+Software, and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED
+TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF
+CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+DEALINGS IN THE SOFTWARE.
+
+Author : Pritam Halder
+Email : pritamhalder.portfolio@gmail.com
+*/
+
+
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <bit>
+#include <chrono>
+#include <cstdint>
+#include <filesystem>
+#include <string>
+
+// counters are compiled in unless `DEM_STATISTICS` is defined as 0,
+// compiled in counters still count only once enabled at runtime
+#ifndef DEM_STATISTICS
+    #define DEM_STATISTICS 1
+#endif
+
+
+
+// counters & load latency histogram of a `Map` / `ConcurrentMap` (relaxed atomics, safe to snapshot from any thread)
+class Statistics {
+public:
+    enum Counter {
+        Queries = 0,        // altitude queries served
+        Nodata,             // queries answered with the nodata value (outside the grid / DEM tile or nodata DEM value)
+        Hits,               // DEM tile lookups answered from memory
+        Loads,              // DEM tiles read from their files
+        Prefetched,         // DEM tile lookups answered by the prefetcher
+        Evictions,          // DEM tiles dropped from memory
+        Misses,             // DEM tile lookups of grid cells without a DEM file
+        Bytes,              // bytes of DEM values read or decoded : whole DEM tiles, decoded blocks & values decoded into a shared store (mapped pages aren't counted)
+        LoadNanoseconds,    // total time spent reading DEM files
+        Counters
+    };
+
+
+    static constexpr size_t buckets = 24;   // bucket i : loads taking [2^(i-1), 2^i) microseconds, the last one everything longer
+
+
+    struct Snapshot {
+        std::array<uint64_t, Counters> counters{};
+        std::array<uint64_t, buckets> latency{};    // load latency histogram
+
+        uint64_t operator[](Counter counter) const {
+            return this->counters[counter];
+        };
+
+
+        std::string json() const {
+            static constexpr const char* names[Counters] = {
+                "queries", "nodata", "hits", "loads", "prefetched", "evictions", "misses", "bytes", "load_nanoseconds"
+            };
+
+            std::string out = "{";
+            for (size_t i = 0; i < Counters; ++i) {
+                out += "\"" + std::string(names[i]) + "\": " + std::to_string(this->counters[i]) + ", ";
+            }
+            out += "\"load_latency_us\": [";
+            for (size_t i = 0; i < buckets; ++i) {
+                out += std::to_string(this->latency[i]) + (i + 1 < buckets ? ", " : "");
+            }
+            return out + "]}";
+        };
+    };
+
+
+    explicit Statistics(bool enabled = false)
+        : on(enabled)
+    {};
+
+
+    bool enabled() const {
+#if DEM_STATISTICS
+        return this->on.load(std::memory_order_relaxed);
+#else
+        return false;
+#endif
+    };
+
+
+    void enable(bool enabled = true) {
+        this->on.store(enabled, std::memory_order_relaxed);
+    };
+
+
+    void add(Counter counter, uint64_t count = 1) {
+        if (this->enabled()) this->counters[counter].fetch_add(count, std::memory_order_relaxed);
+    };
+
+
+    // records the load of a DEM tile that started at `start` & read or decoded `bytes` of DEM values
+    void load(std::chrono::steady_clock::time_point start, uint64_t bytes) {
+        if (!this->enabled()) return;
+
+        const uint64_t nanoseconds = static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count());
+        const size_t bucket = std::min<size_t>(buckets - 1, static_cast<size_t>(std::bit_width(nanoseconds / 1000)));
+
+        this->counters[Loads].fetch_add(1, std::memory_order_relaxed);
+        this->counters[Bytes].fetch_add(bytes, std::memory_order_relaxed);
+        this->counters[LoadNanoseconds].fetch_add(nanoseconds, std::memory_order_relaxed);
+        this->latency[bucket].fetch_add(1, std::memory_order_relaxed);
+    };
+
+
+    Snapshot snapshot() const {
+        Snapshot snapshot;
+        for (size_t i = 0; i < Counters; ++i) snapshot.counters[i] = this->counters[i].load(std::memory_order_relaxed);
+        for (size_t i = 0; i < buckets; ++i) snapshot.latency[i] = this->latency[i].load(std::memory_order_relaxed);
+        return snapshot;
+    };
+
+
+    void reset() {
+        for (auto& counter : this->counters) counter.store(0, std::memory_order_relaxed);
+        for (auto& bucket : this->latency) bucket.store(0, std::memory_order_relaxed);
+    };
+
+
+private:
+    std::atomic<bool> on;
+    std::array<std::atomic<uint64_t>, Counters> counters{};
+    std::array<std::atomic<uint64_t>, buckets> latency{};
+};
@@ -0,0 +1,199 @@
+/*
+MIT License
+
+Copyright (c) 2023 Pritam Halder
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated
+documentation files (the "Software"), to deal in the Software without restriction, including without
+limitation the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the
+Software, and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED
+TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF
+CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+DEALINGS IN THE SOFTWARE.
+
+Author : Pritam Halder
+Email : pritamhalder.portfolio@gmail.com
+*/
+
+
+#pragma once
+
+#include <algorithm>
+#include <bit>
+#include <cmath>
+#include <cstdint>
+#include <vector>
+
+#include "DEM.hpp"
+#include "Parallel.hpp"
+
+
+
+// derived rasters of a DEM computed with 3x3 stencils (Horn's method for the gradients),
+// cells with a nodata value in their neighbourhood are set to the nodata value of the DEM.
+// the DEM is processed in row bands (one per thread) of cache sized column blocks, every row of a block is
+// converted to float once (with a mask of its nodata cells) and every kernel is a plain loop over the columns of
+// a block. curvature, the gradients & the nodata masking vectorize, the kernels of slope, aspect & hillshade are
+// scalar (a call into the math library for the `atan` / `atan2` / `sqrt` of every cell).
+class Terrain {
+public:
+    // slope in degrees (0 = flat)
+    template <dem_datatype T, std::endian endianness>
+    static DEM<float> slope(const DEM<T, endianness>& dem, size_t threads = 1) {
+        return stencil(dem, threads, [](const float* n, const float* c, const float* s, size_t count, float dx, float dy, float* out) {
+            for (size_t j = 0; j < count; ++j) {
+                const float p = ((n[j+2] + 2*c[j+2] + s[j+2]) - (n[j] + 2*c[j] + s[j])) / (8*dx);
+                const float q = ((s[j] + 2*s[j+1] + s[j+2]) - (n[j] + 2*n[j+1] + n[j+2])) / (8*dy);
+                out[j] = std::atan(std::sqrt(p*p + q*q)) * degrees;
+            }
+        });
+    };
+
+
+    // aspect in degrees clockwise from the north ([0, 360), -1 = flat)
+    template <dem_datatype T, std::endian endianness>
+    static DEM<float> aspect(const DEM<T, endianness>& dem, size_t threads = 1) {
+        return stencil(dem, threads, [](const float* n, const float* c, const float* s, size_t count, float dx, float dy, float* out) {
+            for (size_t j = 0; j < count; ++j) {
+                // gradients towards the east & the north
+                const float p = ((n[j+2] + 2*c[j+2] + s[j+2]) - (n[j] + 2*c[j] + s[j])) / (8*dx);
+                const float q = ((n[j] + 2*n[j+1] + n[j+2]) - (s[j] + 2*s[j+1] + s[j+2])) / (8*dy);
+
+                // downslope direction
+                const float a = std::atan2(-p, -q) * degrees;
+                out[j] = (p == 0 && q == 0) ? -1.0f : (a < 0 ? a + 360.0f : a);
+            }
+        });
+    };
+
+
+    // shaded relief ([0, 255]) lit from `azimuth` (degrees clockwise from the north) at `altitude` (degrees above the horizon)
+    template <dem_datatype T, std::endian endianness>
+    static DEM<float> hillshade(const DEM<T, endianness>& dem, float azimuth = 315, float altitude = 45, float z_factor = 1, size_t threads = 1) {
+        const float zenith = (90.0f - altitude) / degrees;
+        const float cos_zenith = std::cos(zenith), sin_zenith = std::sin(zenith);
+        const float sun = azimuth / degrees;
+        const float sun_x = std::sin(sun), sun_y = std::cos(sun);
+
+        return stencil(dem, threads, [=](const float* n, const float* c, const float* s, size_t count, float dx, float dy, float* out) {
+            for (size_t j = 0; j < count; ++j) {
+                const float p = z_factor * ((n[j+2] + 2*c[j+2] + s[j+2]) - (n[j] + 2*c[j] + s[j])) / (8*dx);
+                const float q = z_factor * ((n[j] + 2*n[j+1] + n[j+2]) - (s[j] + 2*s[j+1] + s[j+2])) / (8*dy);
+
+                // cosine of the angle between the surface normal (-p, -q, 1) and the direction of the sun
+                const float shade = (cos_zenith - sin_zenith * (p * sun_x + q * sun_y)) / std::sqrt(1 + p*p + q*q);
+                out[j] = 255.0f * (shade > 0 ? shade : 0.0f);
+            }
+        });
+    };
+
+
+    // curvature (Zevenbergen & Thorne, 1/100 m, positive = convex / upwardly convex surface)
+    template <dem_datatype T, std::endian endianness>
+    static DEM<float> curvature(const DEM<T, endianness>& dem, size_t threads = 1) {
+        return stencil(dem, threads, [](const float* n, const float* c, const float* s, size_t count, float dx, float dy, float* out) {
+            for (size_t j = 0; j < count; ++j) {
+                const float d = ((c[j] + c[j+2]) / 2 - c[j+1]) / (dx*dx);
+                const float e = ((n[j+1] + s[j+1]) / 2 - c[j+1]) / (dy*dy);
+                out[j] = -2 * (d + e) * 100;
+            }
+        });
+    };
+
+
+private:
+    static constexpr float meters_per_degree = 111320.0f;
+    static constexpr float degrees = 57.29577951308232f;    // degrees per radian
+    static constexpr size_t block = 2048;                   // columns per block
+
+
+    // converts row `r`, columns [c0 - 1, c0 + count] (clamped at the edges) to float & marks its nodata cells in `mask`
+    // (nodata converted as 0 so that the kernels stay finite, a branch free loop over the row for DEM values on
+    // the heap, `DEM::at()` per value otherwise)
+    template <dem_datatype T, std::endian endianness>
+    static void load(const DEM<T, endianness>& dem, size_t r, size_t c0, size_t count, float* buffer, uint8_t* mask) {
+        const size_t ncols = dem.type.ncols;
+        const T nodata = dem.type.nodata;
+        auto convert = [nodata](T value, float& converted, uint8_t& missing) {
+            missing = value == nodata;
+            converted = missing ? 0.0f : static_cast<float>(value);
+        };
+
+        convert(dem.at(r, c0 > 0 ? c0 - 1 : 0), buffer[0], mask[0]);
+        convert(dem.at(r, std::min(c0 + count, ncols - 1)), buffer[count + 1], mask[count + 1]);
+
+        if (dem.storage() == Storage::Heap) {
+            const T* row = dem.data().data() + r * ncols + c0;
+            for (size_t j = 0; j < count; ++j) convert(row[j], buffer[j + 1], mask[j + 1]);
+        } else {
+            for (size_t j = 0; j < count; ++j) convert(dem.at(r, c0 + j), buffer[j + 1], mask[j + 1]);
+        }
+    };
+
+
+    template <dem_datatype T, std::endian endianness, typename Kernel>
+    static DEM<float> stencil(const DEM<T, endianness>& dem, size_t threads, Kernel kernel) {
+        const size_t nrows = dem.type.nrows, ncols = dem.type.ncols;
+        const float nodata = static_cast<float>(dem.type.nodata);
+        const float dy = dem.type.cellsize * meters_per_degree;
+
+        std::vector<float> values(nrows * ncols);
+
+        auto band = [&](size_t row_begin, size_t row_end) {
+            std::vector<float> rows(3 * (block + 2));
+            std::vector<uint8_t> masks(3 * (block + 2));
+
+            for (size_t c0 = 0; c0 < ncols; c0 += block) {
+                const size_t count = std::min(block, ncols - c0);
+
+                float* north = rows.data();
+                float* center = north + block + 2;
+                float* south = center + block + 2;
+                uint8_t* north_mask = masks.data();
+                uint8_t* center_mask = north_mask + block + 2;
+                uint8_t* south_mask = center_mask + block + 2;
+
+                load(dem, row_begin > 0 ? row_begin - 1 : 0, c0, count, north, north_mask);
+                load(dem, row_begin, c0, count, center, center_mask);
+
+                for (size_t r = row_begin; r < row_end; ++r) {
+                    load(dem, std::min(r + 1, nrows - 1), c0, count, south, south_mask);
+
+                    const float latitude = dem.bounds.NE.latitude - (static_cast<float>(r) + 0.5f) * dem.type.cellsize;
+                    const float dx = dy * std::cos(latitude / degrees);
+
+                    float* out = values.data() + r * ncols + c0;
+                    kernel(north, center, south, count, dx, dy, out);
+
+                    for (size_t j = 0; j < count; ++j) {
+                        const uint8_t missing =
+                            north_mask[j] | north_mask[j+1] | north_mask[j+2] |
+                            center_mask[j] | center_mask[j+1] | center_mask[j+2] |
+                            south_mask[j] | south_mask[j+1] | south_mask[j+2];
+                        out[j] = missing ? nodata : out[j];
+                    }
+
+                    // slide the 3 row window down by one row
+                    std::swap(north, center);
+                    std::swap(center, south);
+                    std::swap(north_mask, center_mask);
+                    std::swap(center_mask, south_mask);
+                }
+            }
+        };
+
+        const size_t bands = std::max<size_t>(1, std::min(threads, nrows));
+        parallel_for(bands, bands, [&](size_t b) {
+            const auto [row_begin, row_end] = split(nrows, bands, b);
+            band(row_begin, row_end);
+        });
+
+        typename DEM<float>::Type type(nrows, ncols, dem.type.yllcorner, dem.type.xllcorner, dem.type.cellsize, nodata);
+        return DEM<float>(type, std::move(values));
+    };
+};
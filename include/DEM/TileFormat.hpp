@@ -0,0 +1,436 @@
+/*
+MIT License
+
+Copyright (c) 2023 Pritam Halder
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated
+documentation files (the "Software"), to deal in the Software without restriction, including without
+limitation the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the
+Software, and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED
+TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF
+CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+DEALINGS IN THE SOFTWARE.
+
+Author : Pritam Halder
+Email : pritamhalder.portfolio@gmail.com
+*/
+
+
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <numeric>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+#include "Endian.hpp"
+
+
+
+// `.tile` : self describing DEM file format
+//
+//  header (72 bytes, little-endian)
+//      magic "DEMT", version, sample type, byte order of the samples, codec, block order,
+//      block size, nrows, ncols, yllcorner, xllcorner, cellsize, nodata & CRC-32 of the block table
+//  block table (16 bytes per block, row-major over the blocks)
+//      offset & size of every block in the file, CRC-32 of the stored block
+//  blocks
+//      `block` x `block` square blocks of DEM values (edge blocks padded with nodata), stored in Z-order
+//      so that spatially close blocks are close in the file
+class TileFormat {
+public:
+    static constexpr uint16_t version = 1;
+    static constexpr size_t header_size = 72;
+    static constexpr size_t entry_size = 16;
+    static constexpr uint32_t default_block = 256;
+
+
+    enum class Codec : uint8_t {
+        Raw = 0,        // samples as is (in the byte order of the header)
+        Delta = 1       // integer samples only : residuals of the left (first column : upper) neighbour, zigzag coded
+                        // & bit-packed in groups of 64 (1 byte bit width + bit width x 8 bytes little-endian words)
+    };
+
+
+    struct Header {
+        uint8_t sample = 0;                                 // sample type (see `sample()`)
+        std::endian byte_order = std::endian::little;       // byte order of the stored samples
+        Codec codec = Codec::Raw;
+        uint32_t block = default_block;                     // block edge (no. of DEM values)
+        uint64_t nrows = 0;
+        uint64_t ncols = 0;
+        double yllcorner = 0;
+        double xllcorner = 0;
+        double cellsize = 0;
+        double nodata = 0;
+        uint32_t checksum = 0;                              // CRC-32 of the block table
+
+        size_t block_rows() const { return static_cast<size_t>((this->nrows + this->block - 1) / this->block); };
+        size_t block_cols() const { return static_cast<size_t>((this->ncols + this->block - 1) / this->block); };
+        size_t blocks() const { return this->block_rows() * this->block_cols(); };
+    };
+
+
+    struct Block {
+        uint64_t offset = 0;    // from the start of the file
+        uint32_t size = 0;      // stored bytes
+        uint32_t checksum = 0;  // CRC-32 of the stored bytes
+    };
+
+
+    // sample type code of `T` : size in bytes | 0x10 signed | 0x20 floating point
+    template <typename T>
+    static constexpr uint8_t sample() {
+        static_assert(std::is_arithmetic_v<T> && (sizeof(T) == 2 || sizeof(T) == 4 || sizeof(T) == 8), "unsupported DEM sample type");
+        return static_cast<uint8_t>(
+            sizeof(T)
+            | (std::is_signed_v<T> ? 0x10 : 0)
+            | (std::is_floating_point_v<T> ? 0x20 : 0)
+        );
+    };
+
+
+    static uint32_t crc32(const uint8_t* data, size_t size, uint32_t crc = 0) {
+        static const std::array<uint32_t, 256> table = []() {
+            std::array<uint32_t, 256> t{};
+            for (uint32_t i = 0; i < 256; ++i) {
+                uint32_t c = i;
+                for (int k = 0; k < 8; ++k) c = (c & 1) ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+                t[i] = c;
+            }
+            return t;
+        }();
+
+        crc = ~crc;
+        for (size_t i = 0; i < size; ++i) crc = table[(crc ^ data[i]) & 0xFF] ^ (crc >> 8);
+        return ~crc;
+    };
+
+
+    // Z-order (Morton) code of a block
+    static uint64_t morton(uint32_t row, uint32_t column) {
+        auto spread = [](uint64_t v) {
+            v = (v | (v << 16)) & 0x0000FFFF0000FFFFull;
+            v = (v | (v << 8)) & 0x00FF00FF00FF00FFull;
+            v = (v | (v << 4)) & 0x0F0F0F0F0F0F0F0Full;
+            v = (v | (v << 2)) & 0x3333333333333333ull;
+            v = (v | (v << 1)) & 0x5555555555555555ull;
+            return v;
+        };
+        return (spread(row) << 1) | spread(column);
+    };
+
+
+    static bool is_tile(const std::filesystem::path& path) {
+        std::ifstream fp(path, std::ios::binary);
+        char magic[4] = {};
+        fp.read(magic, 4);
+        return fp.good() && std::memcmp(magic, "DEMT", 4) == 0;
+    };
+
+
+    static Header parse(const uint8_t* bytes, size_t size) {
+        if (size < header_size || std::memcmp(bytes, "DEMT", 4) != 0) {
+            throw std::runtime_error("not a DEM tile file");
+        }
+        if (get<uint16_t>(bytes + 4) != version) {
+            throw std::runtime_error("unsupported DEM tile version " + std::to_string(get<uint16_t>(bytes + 4)));
+        }
+
+        Header header;
+        header.sample = bytes[6];
+        header.byte_order = bytes[7] == 0 ? std::endian::little : std::endian::big;
+        header.codec = static_cast<Codec>(bytes[8]);
+        // bytes[9] : block order (0 = Z-order), bytes[10..11] : reserved
+        header.block = get<uint32_t>(bytes + 12);
+        header.nrows = get<uint64_t>(bytes + 16);
+        header.ncols = get<uint64_t>(bytes + 24);
+        header.yllcorner = get<double>(bytes + 32);
+        header.xllcorner = get<double>(bytes + 40);
+        header.cellsize = get<double>(bytes + 48);
+        header.nodata = get<double>(bytes + 56);
+        header.checksum = get<uint32_t>(bytes + 64);
+
+        if (header.block == 0 || header.nrows == 0 || header.ncols == 0) {
+            throw std::runtime_error("invalid DEM tile dimensions");
+        }
+
+        return header;
+    };
+
+
+    // block table following the header, verified against the header checksum
+    static std::vector<Block> table(const Header& header, const uint8_t* bytes, size_t size) {
+        const size_t n = header.blocks();
+        if (size < header_size + n * entry_size) {
+            throw std::runtime_error("truncated DEM tile block table");
+        }
+
+        const uint8_t* entries = bytes + header_size;
+        if (crc32(entries, n * entry_size) != header.checksum) {
+            throw std::runtime_error("DEM tile block table checksum mismatch");
+        }
+
+        std::vector<Block> blocks(n);
+        for (size_t i = 0; i < n; ++i) {
+            blocks[i].offset = get<uint64_t>(entries + i * entry_size);
+            blocks[i].size = get<uint32_t>(entries + i * entry_size + 8);
+            blocks[i].checksum = get<uint32_t>(entries + i * entry_size + 12);
+
+            if (blocks[i].offset + blocks[i].size > size) {
+                throw std::runtime_error("truncated DEM tile block");
+            }
+        }
+
+        return blocks;
+    };
+
+
+    // decodes a stored block into `block` x `block` native DEM values
+    template <typename T>
+    static void decode(const Header& header, const Block& block, const uint8_t* bytes, T* values) {
+        const size_t count = static_cast<size_t>(header.block) * header.block;
+        const uint8_t* stored = bytes + block.offset;
+
+        if (crc32(stored, block.size) != block.checksum) {
+            throw std::runtime_error("DEM tile block checksum mismatch");
+        }
+
+        switch (header.codec) {
+            case Codec::Raw:
+                if (block.size != count * sizeof(T)) {
+                    throw std::runtime_error("invalid DEM tile block size");
+                }
+                std::memcpy(values, stored, count * sizeof(T));
+                if (header.byte_order != std::endian::native) byteswap(values, count);
+                break;
+
+            case Codec::Delta:
+                if constexpr (std::is_integral_v<T>) {
+                    unpack(stored, block.size, header.block, values);
+                    break;
+                }
+                throw std::runtime_error("delta codec needs integer DEM values");
+
+            default:
+                throw std::runtime_error("unsupported DEM tile codec");
+        }
+    };
+
+
+    // writes the row-major native DEM values as a `.tile` file
+    template <typename T>
+    static void write(const std::filesystem::path& path, Header header, const T* values) {
+        header.sample = sample<T>();
+
+        const size_t n = header.blocks();
+        const size_t edge = header.block;
+        const T nodata = static_cast<T>(header.nodata);
+
+        // storage order of the blocks
+        std::vector<size_t> order(n);
+        std::iota(order.begin(), order.end(), 0);
+        std::sort(order.begin(), order.end(), [&header](size_t a, size_t b) {
+            return morton(static_cast<uint32_t>(a / header.block_cols()), static_cast<uint32_t>(a % header.block_cols()))
+                < morton(static_cast<uint32_t>(b / header.block_cols()), static_cast<uint32_t>(b % header.block_cols()));
+        });
+
+        std::ofstream fp(path, std::ios::binary | std::ios::trunc);
+        if (!fp.good()) {
+            throw std::runtime_error("failed to create '" + path.string() + "'");
+        }
+
+        std::vector<uint8_t> head(header_size + n * entry_size, 0);
+        fp.write(reinterpret_cast<const char*>(head.data()), static_cast<std::streamsize>(head.size()));
+
+        std::vector<Block> blocks(n);
+        std::vector<T> samples(edge * edge);
+        std::vector<uint8_t> stored;
+        uint64_t offset = head.size();
+
+        for (size_t b : order) {
+            const size_t r0 = (b / header.block_cols()) * edge;
+            const size_t c0 = (b % header.block_cols()) * edge;
+
+            for (size_t r = 0; r < edge; ++r) {
+                for (size_t c = 0; c < edge; ++c) {
+                    samples[r * edge + c] = (r0 + r < header.nrows && c0 + c < header.ncols)
+                        ? values[(r0 + r) * header.ncols + (c0 + c)]
+                        : nodata;
+                }
+            }
+
+            encode(header, samples.data(), stored);
+
+            blocks[b] = {offset, static_cast<uint32_t>(stored.size()), crc32(stored.data(), stored.size())};
+            fp.write(reinterpret_cast<const char*>(stored.data()), static_cast<std::streamsize>(stored.size()));
+            offset += stored.size();
+        }
+
+        for (size_t i = 0; i < n; ++i) {
+            put<uint64_t>(head.data() + header_size + i * entry_size, blocks[i].offset);
+            put<uint32_t>(head.data() + header_size + i * entry_size + 8, blocks[i].size);
+            put<uint32_t>(head.data() + header_size + i * entry_size + 12, blocks[i].checksum);
+        }
+        header.checksum = crc32(head.data() + header_size, n * entry_size);
+
+        std::memcpy(head.data(), "DEMT", 4);
+        put<uint16_t>(head.data() + 4, version);
+        head[6] = header.sample;
+        head[7] = header.byte_order == std::endian::little ? 0 : 1;
+        head[8] = static_cast<uint8_t>(header.codec);
+        head[9] = 0;
+        put<uint32_t>(head.data() + 12, header.block);
+        put<uint64_t>(head.data() + 16, header.nrows);
+        put<uint64_t>(head.data() + 24, header.ncols);
+        put<double>(head.data() + 32, header.yllcorner);
+        put<double>(head.data() + 40, header.xllcorner);
+        put<double>(head.data() + 48, header.cellsize);
+        put<double>(head.data() + 56, header.nodata);
+        put<uint32_t>(head.data() + 64, header.checksum);
+
+        fp.seekp(0);
+        fp.write(reinterpret_cast<const char*>(head.data()), static_cast<std::streamsize>(head.size()));
+
+        if (!fp.good()) {
+            throw std::runtime_error("failed to write '" + path.string() + "'");
+        }
+    };
+
+
+private:
+    template <typename U>
+    static U get(const uint8_t* bytes) {
+        U value;
+        std::memcpy(&value, bytes, sizeof(U));
+        if constexpr (std::endian::native == std::endian::big) value = byteswap(value);
+        return value;
+    };
+
+
+    template <typename U>
+    static void put(uint8_t* bytes, U value) {
+        if constexpr (std::endian::native == std::endian::big) value = byteswap(value);
+        std::memcpy(bytes, &value, sizeof(U));
+    };
+
+
+    template <typename T>
+    static void encode(const Header& header, const T* values, std::vector<uint8_t>& stored) {
+        const size_t count = static_cast<size_t>(header.block) * header.block;
+
+        switch (header.codec) {
+            case Codec::Raw: {
+                stored.resize(count * sizeof(T));
+                std::memcpy(stored.data(), values, count * sizeof(T));
+                if (header.byte_order != std::endian::native) byteswap(reinterpret_cast<T*>(stored.data()), count);
+                break;
+            }
+
+            case Codec::Delta:
+                if constexpr (std::is_integral_v<T>) {
+                    pack(values, header.block, stored);
+                    break;
+                }
+                throw std::runtime_error("delta codec needs integer DEM values");
+
+            default:
+                throw std::runtime_error("unsupported DEM tile codec");
+        }
+    };
+
+    static constexpr size_t group = 64;    // residuals per bit-packed group of the delta codec
+
+
+    // residuals of a block (`edge` x `edge`) from its left (first column : upper) neighbour
+    template <typename T>
+    static uint64_t residual(const T* values, size_t edge, size_t i) {
+        const T predicted = i == 0 ? T(0) : (i % edge == 0 ? values[i - edge] : values[i - 1]);
+        const uint64_t delta = static_cast<uint64_t>(values[i]) - static_cast<uint64_t>(predicted);
+        return (delta << 1) ^ static_cast<uint64_t>(static_cast<int64_t>(delta) >> 63);
+    };
+
+
+    template <typename T>
+    static void pack(const T* values, size_t edge, std::vector<uint8_t>& stored) {
+        const size_t count = edge * edge;
+        uint64_t residuals[group], words[group];
+
+        stored.clear();
+        for (size_t g = 0; g < count; g += group) {
+            const size_t n = std::min(group, count - g);
+            uint64_t bits = 0;
+            for (size_t i = 0; i < group; ++i) {
+                residuals[i] = i < n ? residual(values, edge, g + i) : 0;
+                bits |= residuals[i];
+            }
+
+            // a group of 64 residuals of `width` bits fills exactly `width` words
+            const size_t width = static_cast<size_t>(std::bit_width(bits));
+            std::fill(words, words + width, 0);
+            for (size_t i = 0; width != 0 && i < group; ++i) {
+                const size_t position = i * width, word = position / 64, offset = position % 64;
+                words[word] |= residuals[i] << offset;
+                if (offset + width > 64) words[word + 1] |= residuals[i] >> (64 - offset);
+            }
+
+            const size_t size = stored.size();
+            stored.resize(size + 1 + width * sizeof(uint64_t));
+            stored[size] = static_cast<uint8_t>(width);
+            for (size_t w = 0; w < width; ++w) put<uint64_t>(stored.data() + size + 1 + w * sizeof(uint64_t), words[w]);
+        }
+    };
+
+
+    template <typename T>
+    static void unpack(const uint8_t* stored, size_t size, size_t edge, T* values) {
+        const size_t count = edge * edge;
+        uint64_t words[group];
+        size_t cursor = 0;
+
+        for (size_t g = 0; g < count; g += group) {
+            const size_t width = cursor < size ? stored[cursor] : 65;
+            if (width > 64 || cursor + 1 + width * sizeof(uint64_t) > size) {
+                throw std::runtime_error("invalid DEM tile block size");
+            }
+
+            for (size_t w = 0; w < width; ++w) words[w] = get<uint64_t>(stored + cursor + 1 + w * sizeof(uint64_t));
+            cursor += 1 + width * sizeof(uint64_t);
+
+            const uint64_t mask = width == 64 ? ~uint64_t(0) : (uint64_t(1) << width) - 1;
+            const size_t n = std::min(group, count - g);
+            for (size_t i = 0; i < n; ++i) {
+                uint64_t zigzag = 0;
+                if (width != 0) {
+                    const size_t position = i * width, word = position / 64, offset = position % 64;
+                    zigzag = words[word] >> offset;
+                    if (offset + width > 64) zigzag |= words[word + 1] << (64 - offset);
+                    zigzag &= mask;
+                }
+
+                const uint64_t delta = (zigzag >> 1) ^ (~(zigzag & 1) + 1);
+                const size_t k = g + i;
+                const T predicted = k == 0 ? T(0) : (k % edge == 0 ? values[k - edge] : values[k - 1]);
+                values[k] = static_cast<T>(static_cast<uint64_t>(predicted) + delta);
+            }
+        }
+
+        if (cursor != size) {
+            throw std::runtime_error("invalid DEM tile block size");
+        }
+    };
+};
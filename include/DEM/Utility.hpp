@@ -20,22 +20,36 @@ Author : Pritam Halder
 Email : pritamhalder.portfolio@gmail.com
 */
 
+
 #pragma once
 
+#include <algorithm>
 #include <bit>
+#include <cctype>
+#include <charconv>
+#include <chrono>
 #include <filesystem>
 #include <fstream>
-#include <sstream>
+#include <functional>
+#include <mutex>
 #include <string>
+#include <string_view>
 #include <system_error>
+#include <thread>
 #include <vector>
 
 #include "DEM.hpp"
+#include "MappedFile.hpp"
+#include "Parallel.hpp"
+#include "Pyramid.hpp"
 
 
 template <dem_datatype T, std::endian endianness = std::endian::native>
 class Utility {
 private:
+    static constexpr size_t chunk_size = 16 << 20;     // bytes of text parsed at a time by the streaming converters
+
+
     static T serialize(T value) {
         static union {T value; uint8_t bytes[sizeof(T)];} t{};
         t.value = value;
@@ -47,24 +61,204 @@ private:
         }
     }
 
-    static void dynamic_metadata_skip(std::ifstream& ifp) {
-        std::string line;
-        std::streampos data_position;
+    static TileFormat::Header tile_header(const typename DEM<T, endianness>::Type& type, uint32_t block, TileFormat::Codec codec) {
+        TileFormat::Header header;
+        header.byte_order = endianness;
+        header.codec = codec;
+        header.block = block;
+        header.nrows = type.nrows;
+        header.ncols = type.ncols;
+        header.yllcorner = type.yllcorner;
+        header.xllcorner = type.xllcorner;
+        header.cellsize = type.cellsize;
+        header.nodata = static_cast<double>(type.nodata);
+        return header;
+    }
 
-        while (std::getline(ifp, line)) {
-            line.erase(line.begin(), std::find_if(line.begin(), line.end(), [](unsigned char ch) {
-                return !std::isspace(ch);
-            }));
+    // ESRI ASCII grid header (`key value` lines before the first line of values), sets `data` to the first value line
+    static typename DEM<T, endianness>::Type asc_header(const char* begin, const char* end, const char*& data) {
+        double nrows = -1, ncols = -1, x = 0, y = 0, cellsize = -1;
+        double nodata = std::is_signed_v<T> ? -9999 : 0;
+        bool x_center = false, y_center = false, x_found = false, y_found = false;
+
+        const char* p = begin;
+        while (p < end) {
+            const char* line_end = std::find(p, end, '\n');
+            const char* q = p;
+            while (q < line_end && std::isspace(static_cast<unsigned char>(*q))) ++q;
+
+            if (q < line_end && !std::isalpha(static_cast<unsigned char>(*q))) break;
+
+            if (q < line_end) {
+                const char* key_end = q;
+                while (key_end < line_end && !std::isspace(static_cast<unsigned char>(*key_end))) ++key_end;
+
+                std::string key(q, key_end);
+                std::transform(key.begin(), key.end(), key.begin(), [](unsigned char c) { return static_cast<char>(std::tolower(c)); });
+
+                const char* v = key_end;
+                while (v < line_end && std::isspace(static_cast<unsigned char>(*v))) ++v;
+                if (v < line_end && *v == '+') ++v;
+
+                double value = 0;
+                if (std::from_chars(v, line_end, value).ec != std::errc()) {
+                    throw std::runtime_error("invalid ESRI ASCII grid header entry '" + key + "'");
+                }
+
+                if (key == "nrows") nrows = value;
+                else if (key == "ncols") ncols = value;
+                else if (key == "xllcorner" || key == "xllcenter") { x = value; x_center = key == "xllcenter"; x_found = true; }
+                else if (key == "yllcorner" || key == "yllcenter") { y = value; y_center = key == "yllcenter"; y_found = true; }
+                else if (key == "cellsize") cellsize = value;
+                else if (key == "nodata_value") nodata = value;
+            }
+
+            p = line_end < end ? line_end + 1 : end;
+        }
+        data = p;
 
-            if (!line.empty() && std::isdigit(line[0])) {
-                data_position = ifp.tellg();
-                data_position -= line.size()+1;
-                break;
+        if (nrows <= 0 || ncols <= 0 || cellsize <= 0 || !x_found || !y_found) {
+            throw std::runtime_error("incomplete ESRI ASCII grid header (ncols, nrows, xllcorner, yllcorner & cellsize are required)");
+        }
+
+        // cell center references are moved onto the lower left corner of the lower left cell
+        if (x_center) x -= cellsize / 2;
+        if (y_center) y -= cellsize / 2;
+
+        return {
+            static_cast<size_t>(nrows), static_cast<size_t>(ncols),
+            static_cast<float>(y), static_cast<float>(x),
+            static_cast<float>(cellsize), static_cast<T>(nodata)
+        };
+    }
+
+    // appends the values of [begin, end) separated by whitespace or commas
+    static void parse(const char* begin, const char* end, std::vector<T>& values) {
+        const char* p = begin;
+
+        while (p < end) {
+            while (p < end && (std::isspace(static_cast<unsigned char>(*p)) || *p == ',')) ++p;
+            if (p == end) break;
+            if (*p == '+') ++p;
+
+            T value = 0;
+            auto [next, ec] = std::from_chars(p, end, value);
+
+            // integer DEM values written with a fraction or an exponent
+            if constexpr (std::is_integral_v<T>) {
+                if (ec == std::errc() && next < end && (*next == '.' || *next == 'e' || *next == 'E')) {
+                    double real = 0;
+                    auto result = std::from_chars(p, end, real);
+                    next = result.ptr;
+                    ec = result.ec;
+                    value = static_cast<T>(real);
+                }
             }
+
+            if (ec != std::errc() || (next < end && !std::isspace(static_cast<unsigned char>(*next)) && *next != ',')) {
+                const char* token_end = std::find_if(p, end, [](char c) { return std::isspace(static_cast<unsigned char>(c)) || c == ','; });
+                throw std::runtime_error("invalid DEM value '" + std::string(p, token_end) + "'");
+            }
+
+            values.push_back(value);
+            p = next;
         }
+    }
 
-        ifp.clear();
-        ifp.seekg(data_position);
+    // streams the values of the text [begin, end) to `sink(values)` in order, about `chunk_size` bytes at a time,
+    // every chunk is split between values across `threads` threads
+    template <typename Sink>
+    static void stream(const char* begin, const char* end, size_t threads, Sink sink) {
+        threads = std::max<size_t>(1, threads);
+        std::vector<std::vector<T>> parts(threads);
+
+        // just past the first separator at or after `p`, searched atmost `chunk_size` bytes ahead
+        // so that text without line breaks still streams in bounded chunks
+        auto boundary = [end](const char* p) {
+            p = std::min(p, end);
+            const char* limit = p + std::min<size_t>(chunk_size, static_cast<size_t>(end - p));
+            p = std::find_if(p, limit, [](char c) { return std::isspace(static_cast<unsigned char>(c)) || c == ','; });
+            if (p == limit && limit < end) {
+                throw std::runtime_error("DEM value longer than " + std::to_string(chunk_size) + " bytes");
+            }
+            return p < end ? p + 1 : end;
+        };
+
+        for (const char* chunk = begin; chunk < end;) {
+            const char* chunk_end = boundary(chunk + std::min<size_t>(chunk_size, static_cast<size_t>(end - chunk)) - 1);
+            const size_t part_size = static_cast<size_t>(chunk_end - chunk) / threads + 1;
+
+            std::vector<const char*> bounds(threads + 1, chunk_end);
+            bounds[0] = chunk;
+            for (size_t t = 1; t < threads; ++t) {
+                bounds[t] = std::clamp(boundary(chunk + std::min(t * part_size, static_cast<size_t>(chunk_end - chunk))), bounds[t-1], chunk_end);
+            }
+
+            for (std::vector<T>& part : parts) part.clear();
+
+            parallel_for(threads, threads, [&](size_t t) { parse(bounds[t], bounds[t+1], parts[t]); });
+
+            for (std::vector<T>& part : parts) sink(part);
+            chunk = chunk_end;
+        }
+    }
+
+    // streams an output file in chunks to `<path>.tmp` (DEM values in the byte order of the DEM for `.bin`, text
+    // for `.csv`), renamed to `path` by `commit()`, a writer destroyed before (on a failed conversion) removes it
+    struct Writer {
+        std::filesystem::path path;
+        std::filesystem::path temporary;
+        std::ofstream ofp;
+        size_t count = 0;
+
+        Writer(const std::filesystem::path& path)
+            : path(path),
+            temporary(path.string() + ".tmp"),
+            ofp(this->temporary, std::ios::binary | std::ios::trunc)
+        {
+            if (!this->ofp.good()) {
+                throw std::runtime_error("failed to create '" + this->temporary.string() + "'");
+            }
+        }
+
+        Writer(const Writer&) = delete;
+        Writer& operator=(const Writer&) = delete;
+
+        ~Writer() {
+            if (this->temporary.empty()) return;
+            this->ofp.close();
+            std::error_code ec;
+            std::filesystem::remove(this->temporary, ec);
+        }
+
+        void operator()(std::vector<T>& values) {
+            ::serialize<T, endianness>(values.data(), values.size());
+            this->ofp.write(reinterpret_cast<const char*>(values.data()), static_cast<std::streamsize>(values.size() * sizeof(T)));
+            this->count += values.size();
+        }
+
+        // text of `count` DEM values
+        void write(const std::string& text, size_t count) {
+            this->ofp.write(text.data(), static_cast<std::streamsize>(text.size()));
+            this->count += count;
+        }
+
+        // publishes the complete output under its final name
+        void commit() {
+            this->ofp.close();
+            if (this->ofp.fail()) {
+                throw std::runtime_error("failed to write '" + this->temporary.string() + "'");
+            }
+            std::filesystem::rename(this->temporary, this->path);
+            this->temporary.clear();
+        }
+    };
+
+    static void require(const std::filesystem::path& path) {
+        if (!std::filesystem::exists(path)) {
+            std::string e = "file '" + path.string() + "' not found";
+            throw std::runtime_error(e);
+        }
     }
 
     static std::filesystem::path generate_output_file_path(const std::filesystem::path& input_path, const std::string& extension) {
@@ -73,87 +267,201 @@ private:
     }
 
 public:
-    static void create_dem_asc_bin(const std::filesystem::path& path) {
-        if (!std::filesystem::exists(path)) {
-            std::string e = "file '" + path.string() + "' not found";
-            throw std::runtime_error(e);
-        }
+    // output format of `convert_directory()`
+    enum class Format {
+        Bin,
+        Csv,
+        Tile
+    };
 
-        std::vector<T> dem_data;
-        T value = 0;
-        std::ifstream ifp(path);
-        dynamic_metadata_skip(ifp);
 
-        // read values to `dem_data`
-        while (ifp >> value) dem_data.push_back(serialize(value));
-        ifp.close();
+    // result of converting one file
+    struct Conversion {
+        std::filesystem::path input;
+        std::filesystem::path output;
+        bool converted = false;
+        std::string error;          // reason of the failure (empty when converted)
+        size_t bytes = 0;           // size of the input file
+        double seconds = 0;         // wall time of the conversion
+    };
 
-        // write `dem_data` in binary format
-        std::ofstream ofp(generate_output_file_path(path, "bin"), std::ios::binary | std::ios::trunc);
-        ofp.write(reinterpret_cast<char*>(dem_data.data()), dem_data.size() * sizeof(T));
-        ofp.close();
+
+    struct Report {
+        std::vector<Conversion> files;  // in the order of completion
+        size_t bytes = 0;               // input bytes converted
+        double seconds = 0;             // wall time of the whole directory
+
+        size_t failed() const {
+            return static_cast<size_t>(std::count_if(this->files.begin(), this->files.end(), [](const Conversion& c) { return !c.converted; }));
+        };
+
+        // input bytes converted per second
+        double throughput() const {
+            return this->seconds > 0 ? static_cast<double>(this->bytes) / this->seconds : 0;
+        };
     };
 
 
-    static void create_dem_asc_csv(const std::filesystem::path& path, const typename DEM<T, endianness>::Type type) {
-        if (!std::filesystem::exists(path)) {
-            std::string e = "file '" + path.string() + "' not found";
-            throw std::runtime_error(e);
+    // converts every `.asc` (to any format) & `.csv` (to `.bin` only) file of a directory, next to the input files,
+    // on a pool of `threads` workers each converting whole files (largest first). there are no separate read / parse
+    // / write stages : an input is mapped & read by the parsing itself, a page at a time, & every file is already
+    // streamed through bounded chunks to its writer, so a worker waiting for its disk lets the others parse, while
+    // each output is written sequentially & committed by one thread. a failed file doesn't stop the others,
+    // `progress` is called (serialized, outside the lock of the report) as every file completes
+    static Report convert_directory(
+        const std::filesystem::path& directory,
+        Format format = Format::Bin,
+        size_t threads = std::max(1u, std::thread::hardware_concurrency()),
+        std::function<void(const Conversion&)> progress = nullptr
+    ) {
+        std::vector<Conversion> pending;
+
+        try {
+            for (const auto& entry : std::filesystem::directory_iterator(directory)) {
+                const std::string extension = entry.path().extension().string();
+                if (!entry.is_regular_file() || (extension != ".asc" && extension != ".csv")) continue;
+
+                Conversion conversion;
+                conversion.input = entry.path();
+                conversion.output = generate_output_file_path(entry.path(), format == Format::Bin ? "bin" : format == Format::Csv ? "csv" : "tile");
+                conversion.bytes = static_cast<size_t>(entry.file_size());
+                pending.push_back(std::move(conversion));
+            }
+        } catch (const std::filesystem::filesystem_error& e) {
+            throw std::runtime_error(std::string(e.what()) + "\n");
         }
 
-        std::vector<T> dem_data;
-        T value = 0;
-        std::ifstream ifp(path);
-        dynamic_metadata_skip(ifp);
+        std::sort(pending.begin(), pending.end(), [](const Conversion& a, const Conversion& b) { return a.bytes > b.bytes; });
 
-        // read values to `dem_data`
-        while (ifp >> value) dem_data.push_back(value);
-        ifp.close();
+        Report report;
+        std::mutex report_mutex, progress_mutex;
+        const auto start = std::chrono::steady_clock::now();
 
-        // write as per '.csv' format
-        std::ofstream ofp(generate_output_file_path(path, "csv"));
-        for (size_t i = 0; i < type.nrows * type.ncols; ++i) {
-            if (i % type.ncols == type.ncols - 1)
-                ofp << dem_data[i] << "\n";
-            else
-                ofp << dem_data[i] << ",";
-        }
-        ofp.close();
+        // an exception of `progress` stops the conversions not started yet & is rethrown once every worker is done
+        parallel_for(pending.size(), threads, [&](size_t i) {
+            Conversion& conversion = pending[i];
+            const auto begin = std::chrono::steady_clock::now();
+
+            try {
+                const bool asc = conversion.input.extension() == ".asc";
+                if (!asc && format != Format::Bin) {
+                    throw std::runtime_error("'.csv' files convert to '.bin' only");
+                }
+
+                if (!asc) create_dem_csv_bin(conversion.input);
+                else if (format == Format::Bin) create_dem_asc_bin(conversion.input);
+                else if (format == Format::Csv) create_dem_asc_csv(conversion.input);
+                else create_dem_asc_tile(conversion.input);
+
+                conversion.converted = true;
+            } catch (const std::exception& e) {
+                conversion.error = e.what();
+            }
+
+            conversion.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+
+            {
+                std::lock_guard<std::mutex> lock(report_mutex);
+                if (conversion.converted) report.bytes += conversion.bytes;
+                report.files.push_back(conversion);
+            }
+
+            if (progress) {
+                std::lock_guard<std::mutex> lock(progress_mutex);
+                progress(conversion);
+            }
+        });
+
+        report.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        return report;
     };
 
 
-    static void create_dem_csv_bin(const std::filesystem::path& path){
-        if (!std::filesystem::exists(path)) {
-            std::string e = "file '" + path.string() + "' not found";
+    // DEM type described by the header of an ESRI ASCII grid (`.asc`) file
+    static typename DEM<T, endianness>::Type read_asc_header(const std::filesystem::path& path) {
+        require(path);
+
+        MappedFile file(path);
+        const char* text = reinterpret_cast<const char*>(file.data());
+        const char* data = nullptr;
+        return asc_header(text, text + file.size(), data);
+    };
+
+
+    // streams the `.asc` values to `.bin` with bounded memory (optionally parsing on `threads` threads),
+    // returns the DEM type described by the `.asc` header
+    static typename DEM<T, endianness>::Type create_dem_asc_bin(const std::filesystem::path& path, size_t threads = 1) {
+        require(path);
+
+        MappedFile file(path);
+        const char* text = reinterpret_cast<const char*>(file.data());
+        const char* data = nullptr;
+        typename DEM<T, endianness>::Type type = asc_header(text, text + file.size(), data);
+
+        Writer writer(generate_output_file_path(path, "bin"));
+        stream(data, text + file.size(), threads, [&writer](std::vector<T>& values) { writer(values); });
+
+        if (writer.count != type.nrows * type.ncols) {
+            std::string e = "'" + path.string() + "' doesn't hold nrows x ncols DEM values";
             throw std::runtime_error(e);
         }
+        writer.commit();
+
+        return type;
+    };
 
-        std::vector<T> dem_data;
-        T value = 0;
-        std::ifstream ifp(path);
 
-        // read values to `dem_data`
+    // streams the `.asc` values to `.csv` rows with bounded memory (optionally parsing on `threads` threads),
+    // returns the DEM type described by the `.asc` header
+    static typename DEM<T, endianness>::Type create_dem_asc_csv(const std::filesystem::path& path, size_t threads = 1) {
+        require(path);
+
+        MappedFile file(path);
+        const char* text = reinterpret_cast<const char*>(file.data());
+        const char* data = nullptr;
+        typename DEM<T, endianness>::Type type = asc_header(text, text + file.size(), data);
+
+        // write as per '.csv' format
+        Writer writer(generate_output_file_path(path, "csv"));
         std::string line;
-        while (std::getline(ifp, line)) {
-            std::istringstream iss(line);
-            std::string token;
-            while (std::getline(iss, token, ','))
-                dem_data.push_back(serialize(static_cast<T>(std::stod(token))));
+        char number[64];
+        size_t column = 0;
+
+        stream(data, text + file.size(), threads, [&](std::vector<T>& values) {
+            for (T value : values) {
+                line.append(number, std::to_chars(number, number + sizeof(number), value).ptr);
+                line += (++column == type.ncols) ? '\n' : ',';
+                if (column == type.ncols) column = 0;
+            }
+            writer.write(line, values.size());
+            line.clear();
+        });
+
+        if (writer.count != type.nrows * type.ncols) {
+            std::string e = "'" + path.string() + "' doesn't hold nrows x ncols DEM values";
+            throw std::runtime_error(e);
         }
-        ifp.close();
+        writer.commit();
 
-        // write `dem_data` in binary format
-        std::ofstream ofp(generate_output_file_path(path, "bin"), std::ios::binary | std::ios::trunc);
-        ofp.write(reinterpret_cast<char*>(dem_data.data()), dem_data.size() * sizeof(T));
-        ofp.close();
+        return type;
+    };
+
+
+    // streams the `.csv` values to `.bin` with bounded memory (optionally parsing on `threads` threads)
+    static void create_dem_csv_bin(const std::filesystem::path& path, size_t threads = 1) {
+        require(path);
+
+        MappedFile file(path);
+        const char* text = reinterpret_cast<const char*>(file.data());
+
+        Writer writer(generate_output_file_path(path, "bin"));
+        stream(text, text + file.size(), threads, [&writer](std::vector<T>& values) { writer(values); });
+        writer.commit();
     };
 
 
     static void create_dem_bin_csv(const std::filesystem::path& path, const typename DEM<T, endianness>::Type type) {
-        if (!std::filesystem::exists(path)) {
-            std::string e = "file '" + path.string() + "' not found";
-            throw std::runtime_error(e);
-        }
+        require(path);
 
         std::vector<T> dem_data;
         T value = 0;
@@ -173,4 +481,43 @@ public:
         }
         ofp.close();
     };
+
+
+    // `.bin` -> `.tile` (raw samples are kept in the byte order of the `.bin` file),
+    // `TileFormat::Codec::Delta` compresses every block (integer DEM values only)
+    static void create_dem_bin_tile(const std::filesystem::path& path, const typename DEM<T, endianness>::Type type, uint32_t block = TileFormat::default_block, TileFormat::Codec codec = TileFormat::Codec::Raw) {
+        DEM<T, endianness> dem(type, path);
+        TileFormat::write(generate_output_file_path(path, "tile"), tile_header(type, block, codec), dem.data().data());
+    };
+
+
+    // `.asc` -> `.tile`, the geometry is read from the `.asc` header
+    static void create_dem_asc_tile(const std::filesystem::path& path, uint32_t block = TileFormat::default_block, TileFormat::Codec codec = TileFormat::Codec::Raw, size_t threads = 1) {
+        require(path);
+
+        MappedFile file(path);
+        const char* text = reinterpret_cast<const char*>(file.data());
+        const char* data = nullptr;
+        typename DEM<T, endianness>::Type type = asc_header(text, text + file.size(), data);
+
+        std::vector<T> dem_data;
+        dem_data.reserve(type.nrows * type.ncols);
+        stream(data, text + file.size(), threads, [&dem_data](std::vector<T>& values) {
+            dem_data.insert(dem_data.end(), values.begin(), values.end());
+        });
+
+        if (dem_data.size() != type.nrows * type.ncols) {
+            std::string e = "'" + path.string() + "' doesn't hold nrows x ncols DEM values";
+            throw std::runtime_error(e);
+        }
+
+        TileFormat::write(generate_output_file_path(path, "tile"), tile_header(type, block, codec), dem_data.data());
+    };
+
+
+    // overview levels (see `Pyramid`) of a `.bin` or `.tile` file, saved as `.ovr` next to it
+    static void create_dem_ovr(const std::filesystem::path& path, const typename DEM<T, endianness>::Type type, size_t levels = 0, size_t threads = 1) {
+        DEM<T, endianness> dem = DEM<T, endianness>::open(type, path);
+        Pyramid::build(dem, levels, threads).save(Pyramid::path(path));
+    };
 };
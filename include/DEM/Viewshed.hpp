@@ -0,0 +1,234 @@
+/*
+MIT License
+
+Copyright (c) 2023 Pritam Halder
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated
+documentation files (the "Software"), to deal in the Software without restriction, including without
+limitation the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the
+Software, and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED
+TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF
+CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+DEALINGS IN THE SOFTWARE.
+
+Author : Pritam Halder
+Email : pritamhalder.portfolio@gmail.com
+*/
+
+
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <bit>
+#include <cmath>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include "DEM.hpp"
+#include "Map.hpp"
+#include "Parallel.hpp"
+
+
+
+// visibility raster around an observer, 1 bit per DEM cell
+class Viewshed {
+public:
+    size_t nrows = 0;       // no. of cells in a column
+    size_t ncols = 0;       // no. of cells in a row
+    float yllcorner = 0;    // bottom left latitude
+    float xllcorner = 0;    // bottom left longitude
+    float cellsize = 0;     // same as that of the DEM
+    std::vector<uint64_t> mask;     // row-major visibility bits (row 0 is the northern most row)
+
+
+    Viewshed() = default;
+
+
+    bool visible(size_t row, size_t column) const {
+        if (row >= this->nrows || column >= this->ncols) return false;
+        const size_t i = row * this->ncols + column;
+        return (this->mask[i / 64] >> (i % 64)) & 1u;
+    };
+
+
+    bool visible(float latitude, float longitude) const {
+        const float north = this->yllcorner + this->cellsize * this->nrows;
+        if (latitude < this->yllcorner || latitude >= north || longitude < this->xllcorner) return false;
+
+        return this->visible(
+            static_cast<size_t>((north - latitude) / this->cellsize),
+            static_cast<size_t>((longitude - this->xllcorner) / this->cellsize)
+        );
+    };
+
+
+    // no. of visible cells
+    size_t count() const {
+        size_t n = 0;
+        for (uint64_t word : this->mask) n += static_cast<size_t>(std::popcount(word));
+        return n;
+    };
+
+
+    // cells within `radius` (meters) of the observer visible from `observer_height` above the terrain at the observer,
+    // a cell is visible when the terrain `target_height` above it is visible (accounts for the earth curvature)
+    template <dem_datatype T, std::endian endianness>
+    static Viewshed compute(const DEM<T, endianness>& dem, const Coordinate& observer, float observer_height, float radius, float target_height = 0, size_t threads = 1) {
+        // non owning handle, `dem` outlives the computation
+        std::vector<std::shared_ptr<const DEM<T, endianness>>> tiles{
+            std::shared_ptr<const DEM<T, endianness>>(std::shared_ptr<const DEM<T, endianness>>(), &dem)
+        };
+        return sweep(tiles, observer, observer_height, radius, target_height, threads);
+    };
+
+
+    // viewshed over all the DEM tiles of the map within `radius` of the observer, each tile is loaded once
+    template <dem_datatype T, std::endian endianness>
+    static Viewshed compute(Map<T, endianness>& map, const Coordinate& observer, float observer_height, float radius, float target_height = 0, size_t threads = 1) {
+        std::vector<std::shared_ptr<const DEM<T, endianness>>> tiles;
+
+        auto origin = map.acquire(observer.latitude, observer.longitude);
+        if (!origin) return Viewshed();
+        tiles.push_back(origin);
+
+        const float del_latitude = radius / meters_per_degree;
+        const float del_longitude = radius / (meters_per_degree * std::max(std::cos(observer.latitude * degree), 0.01f));
+
+        for (float latitude = std::floor(observer.latitude - del_latitude); latitude <= std::floor(observer.latitude + del_latitude); ++latitude) {
+            for (float longitude = std::floor(observer.longitude - del_longitude); longitude <= std::floor(observer.longitude + del_longitude); ++longitude) {
+                if (latitude < -90 || latitude >= 90 || longitude < -180 || longitude >= 180) continue;
+
+                auto dem = map.acquire(latitude + 0.5f, longitude + 0.5f);
+                if (dem && std::find(tiles.begin(), tiles.end(), dem) == tiles.end()) tiles.push_back(dem);
+            }
+        }
+
+        return sweep(tiles, observer, observer_height, radius, target_height, threads);
+    };
+
+
+private:
+    static constexpr float meters_per_degree = 111320.0f;
+    static constexpr float earth_radius = 6371000.0f;
+    static constexpr float degree = 0.017453292519943295f;
+
+
+    // DEM value of the tile containing the coordinate (`nan` without data), remembers the last tile used
+    template <dem_datatype T, std::endian endianness>
+    static float terrain(const std::vector<std::shared_ptr<const DEM<T, endianness>>>& tiles, float latitude, float longitude, const DEM<T, endianness>*& last) {
+        if (last == nullptr || !last->bounds.within(latitude, longitude)) {
+            last = nullptr;
+            for (const auto& dem : tiles) {
+                if (dem->bounds.within(latitude, longitude)) {
+                    last = dem.get();
+                    break;
+                }
+            }
+            if (last == nullptr) return NAN;
+        }
+
+        T value = last->altitude(latitude, longitude);
+        return value == last->type.nodata ? NAN : static_cast<float>(value);
+    };
+
+
+    // radial sweep (R2) : a ray is cast from the observer to every cell on the perimeter of the viewshed,
+    // cells along a ray are visible while their elevation angle is not below the highest angle seen before them.
+    // the perimeter is split into sectors which are swept in parallel.
+    template <dem_datatype T, std::endian endianness>
+    static Viewshed sweep(const std::vector<std::shared_ptr<const DEM<T, endianness>>>& tiles, const Coordinate& observer, float observer_height, float radius, float target_height, size_t threads) {
+        const DEM<T, endianness>& origin = *tiles.front();
+        const float cellsize = origin.type.cellsize;
+
+        const float cell_height = cellsize * meters_per_degree;
+        const float cell_width = cell_height * std::cos(observer.latitude * degree);
+        const long half_rows = static_cast<long>(std::ceil(radius / cell_height));
+        const long half_cols = static_cast<long>(std::ceil(radius / std::max(cell_width, 1e-3f)));
+
+        // viewshed cells are aligned with the cells of the observer's DEM tile
+        const long observer_r = static_cast<long>((origin.bounds.NE.latitude - observer.latitude) / cellsize);
+        const long observer_c = static_cast<long>((observer.longitude - origin.bounds.SW.longitude) / cellsize);
+        const float north = origin.bounds.NE.latitude - static_cast<float>(observer_r - half_rows) * cellsize;
+        const float west = origin.bounds.SW.longitude + static_cast<float>(observer_c - half_cols) * cellsize;
+
+        Viewshed viewshed;
+        viewshed.nrows = static_cast<size_t>(2 * half_rows + 1);
+        viewshed.ncols = static_cast<size_t>(2 * half_cols + 1);
+        viewshed.cellsize = cellsize;
+        viewshed.yllcorner = north - cellsize * viewshed.nrows;
+        viewshed.xllcorner = west;
+        viewshed.mask.assign((viewshed.nrows * viewshed.ncols + 63) / 64, 0);
+
+        // cells are sampled a quarter cell inside, away from the tile edges
+        auto latitude_of = [&](long r) { return north - (static_cast<float>(r) + 0.25f) * cellsize; };
+        auto longitude_of = [&](long c) { return west + (static_cast<float>(c) + 0.25f) * cellsize; };
+
+        const DEM<T, endianness>* last = nullptr;
+        const float ground = terrain(tiles, latitude_of(half_rows), longitude_of(half_cols), last);
+        if (std::isnan(ground)) return viewshed;
+
+        const float eye = ground + observer_height;
+        const float radius_squared = radius * radius;
+
+        auto mark = [&viewshed](size_t r, size_t c) {
+            const size_t i = r * viewshed.ncols + c;
+            std::atomic_ref<uint64_t>(viewshed.mask[i / 64]).fetch_or(uint64_t{1} << (i % 64), std::memory_order_relaxed);
+        };
+        mark(static_cast<size_t>(half_rows), static_cast<size_t>(half_cols));
+
+        // perimeter cells, clockwise from the north west corner
+        std::vector<std::pair<long, long>> perimeter;
+        for (long c = 0; c < 2 * half_cols; ++c) perimeter.emplace_back(0, c);
+        for (long r = 0; r < 2 * half_rows; ++r) perimeter.emplace_back(r, 2 * half_cols);
+        for (long c = 2 * half_cols; c > 0; --c) perimeter.emplace_back(2 * half_rows, c);
+        for (long r = 2 * half_rows; r > 0; --r) perimeter.emplace_back(r, 0);
+
+        auto cast = [&](size_t first, size_t last_ray) {
+            const DEM<T, endianness>* tile = nullptr;
+
+            for (size_t p = first; p < last_ray; ++p) {
+                const long del_r = perimeter[p].first - half_rows;
+                const long del_c = perimeter[p].second - half_cols;
+                const long steps = std::max(std::abs(del_r), std::abs(del_c));
+                float horizon = -INFINITY;
+
+                for (long k = 1; k <= steps; ++k) {
+                    const long r = half_rows + static_cast<long>(std::lround(static_cast<double>(del_r) * k / steps));
+                    const long c = half_cols + static_cast<long>(std::lround(static_cast<double>(del_c) * k / steps));
+
+                    const float dy = static_cast<float>(r - half_rows) * cell_height;
+                    const float dx = static_cast<float>(c - half_cols) * cell_width;
+                    const float distance_squared = dx * dx + dy * dy;
+                    if (distance_squared > radius_squared) break;
+
+                    const float z = terrain(tiles, latitude_of(r), longitude_of(c), tile);
+                    if (std::isnan(z)) continue;
+
+                    const float distance = std::sqrt(distance_squared);
+                    const float drop = distance_squared / (2 * earth_radius);
+                    const float angle = (z - drop - eye) / distance;
+
+                    if ((z + target_height - drop - eye) / distance >= horizon) {
+                        mark(static_cast<size_t>(r), static_cast<size_t>(c));
+                    }
+                    horizon = std::max(horizon, angle);
+                }
+            }
+        };
+
+        const size_t sectors = std::max<size_t>(1, std::min(threads, perimeter.size()));
+        parallel_for(sectors, sectors, [&](size_t sector) {
+            const auto [first, end] = split(perimeter.size(), sectors, sector);
+            cast(first, end);
+        });
+
+        return viewshed;
+    };
+};
@@ -0,0 +1,104 @@
+/*
+MIT License
+
+Copyright (c) 2023 Pritam Halder
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated
+documentation files (the "Software"), to deal in the Software without restriction, including without
+limitation the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the
+Software, and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED
+TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF
+CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+DEALINGS IN THE SOFTWARE.
+
+Author : Pritam Halder
+Email : pritamhalder.portfolio@gmail.com
+*/
+
+
+
+#pragma once
+
+#include <bit>
+#include <cstdint>
+#include <cstdio>
+#include <filesystem>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <unistd.h>
+
+#include "DEM/DEM.hpp"
+#include "DEM/Map.hpp"
+#include "Synthetic.hpp"
+
+
+
+// minimal assertions shared by the tests : a failed check prints its location & fails the test at `finish()`
+inline int failures = 0;
+
+
+inline bool check(bool passed, const char* expression, const char* file, int line) {
+    if (!passed) {
+        std::fprintf(stderr, "%s:%d: check failed: %s\n", file, line, expression);
+        ++failures;
+    }
+    return passed;
+}
+
+
+#define CHECK(expression) check(static_cast<bool>(expression), #expression, __FILE__, __LINE__)
+
+
+// exit status of the test
+inline int finish() {
+    if (failures != 0) std::fprintf(stderr, "%d check(s) failed\n", failures);
+    return failures == 0 ? 0 : 1;
+}
+
+
+// directory of the files written by a test, removed with it
+class Scratch {
+public:
+    std::filesystem::path path;
+
+
+    explicit Scratch(const std::string& name)
+        : path(std::filesystem::temp_directory_path() / ("dem_test_" + name + "_" + std::to_string(::getpid())))
+    {
+        std::filesystem::remove_all(this->path);
+        std::filesystem::create_directories(this->path);
+    };
+
+
+    Scratch(const Scratch&) = delete;
+    Scratch& operator=(const Scratch&) = delete;
+
+
+    ~Scratch() {
+        std::error_code ec;
+        std::filesystem::remove_all(this->path, ec);
+    };
+};
+
+
+// big-endian int16 synthetic tiles (`size` x `size` values per degree) the tests run on
+using Tile = DEM<int16_t, std::endian::big>;
+using TileMap = Map<int16_t, std::endian::big>;
+
+constexpr int16_t nodata = -32768;
+
+
+// writes `<latitude>_<longitude>.bin` for every (latitude, longitude) south west corner, returns the grid of the map over them
+inline TileMap::Grid write_grid(const Synthetic& synthetic, size_t size, const std::filesystem::path& directory, const std::vector<std::pair<int, int>>& corners) {
+    for (const auto& [latitude, longitude] : corners) {
+        synthetic.write_bin<int16_t, std::endian::big>(directory, latitude, longitude);
+    }
+    return TileMap::initialize(directory, size, size, 1.0f / static_cast<float>(size), nodata);
+}
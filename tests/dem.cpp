@@ -0,0 +1,108 @@
+/*
+MIT License
+
+Copyright (c) 2023 Pritam Halder
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated
+documentation files (the "Software"), to deal in the Software without restriction, including without
+limitation the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the
+Software, and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED
+TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF
+CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+DEALINGS IN THE SOFTWARE.
+
+Author : Pritam Halder
+Email : pritamhalder.portfolio@gmail.com
+*/
+
+
+
+
+// `DEM` : values read in one piece or mapped answer at the cells they were written for, in the scalar & batch forms
+
+#include <random>
+#include <stdexcept>
+#include <vector>
+
+#include "DEM/DEM.hpp"
+#include "Test.hpp"
+
+
+
+int main() {
+    Scratch scratch("dem");
+    const size_t size = 150;
+    const Synthetic synthetic(size);
+
+    const std::filesystem::path bin = synthetic.write_bin<int16_t, std::endian::big>(scratch.path, 27, 86);
+    const Tile::Type type = synthetic.type<int16_t, std::endian::big>(27, 86);
+    const std::vector<int16_t> values = synthetic.values<int16_t>(27, 86);
+
+    // every DEM value at the coordinate of its cell, row-major from the north
+    Tile dem(type, bin);
+    size_t off = 0;
+    for (size_t r = 0; r < size; ++r) {
+        const float latitude = dem.bounds.NE.latitude - (static_cast<float>(r) + 0.25f) * type.cellsize;
+        for (size_t c = 0; c < size; ++c) {
+            const float longitude = dem.bounds.SW.longitude + (static_cast<float>(c) + 0.25f) * type.cellsize;
+            off += dem.altitude(latitude, longitude) != values[r * size + c];
+        }
+    }
+    CHECK(off == 0);
+    CHECK(dem.altitude(26.5f, 86.5f) == nodata);
+
+    // mapped values answer the same
+    Tile mapped(type, bin, Storage::Mapped);
+    CHECK(mapped.storage() == Storage::Mapped && dem.storage() == Storage::Heap);
+    off = 0;
+    for (size_t r = 0; r < size; ++r) {
+        const float latitude = dem.bounds.NE.latitude - (static_cast<float>(r) + 0.25f) * type.cellsize;
+        for (size_t c = 0; c < size; ++c) {
+            const float longitude = dem.bounds.SW.longitude + (static_cast<float>(c) + 0.25f) * type.cellsize;
+            off += mapped.altitude(latitude, longitude) != values[r * size + c];
+            off += mapped.interpolated_altitude(latitude, longitude) != dem.interpolated_altitude(latitude, longitude);
+        }
+    }
+    CHECK(off == 0);
+
+    // batch forms answer as the scalar forms, over the DEM tile & a little outside of it
+    std::mt19937 generator(7);
+    std::uniform_real_distribution<float> uniform(0, 1);
+    const size_t n = 10000;
+    std::vector<float> latitudes(n), longitudes(n);
+    for (size_t i = 0; i < n; ++i) {
+        latitudes[i] = 26.95f + uniform(generator) * 1.1f;
+        longitudes[i] = 85.95f + uniform(generator) * 1.1f;
+    }
+
+    for (const Tile* from : {&dem, &mapped}) {
+        std::vector<int16_t> altitudes(n);
+        std::vector<float> interpolated(n);
+        from->altitude(latitudes, longitudes, altitudes);
+        from->interpolated_altitude(latitudes, longitudes, interpolated);
+
+        off = 0;
+        for (size_t i = 0; i < n; ++i) {
+            off += altitudes[i] != dem.altitude(latitudes[i], longitudes[i]);
+            off += interpolated[i] != dem.interpolated_altitude(latitudes[i], longitudes[i]);
+        }
+        CHECK(off == 0);
+    }
+
+    // files shorter than their rows & columns are refused
+    std::filesystem::resize_file(bin, size * size);
+    bool refused = false;
+    try {
+        Tile truncated(type, bin);
+    } catch (const std::runtime_error&) {
+        refused = true;
+    }
+    CHECK(refused);
+
+    return finish();
+}
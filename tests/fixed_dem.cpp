@@ -0,0 +1,161 @@
+/*
+MIT License
+
+Copyright (c) 2023 Pritam Halder
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated
+documentation files (the "Software"), to deal in the Software without restriction, including without
+limitation the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the
+Software, and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED
+TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF
+CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+DEALINGS IN THE SOFTWARE.
+
+Author : Pritam Halder
+Email : pritamhalder.portfolio@gmail.com
+*/
+
+
+
+
+// `FixedDEM` & the interpolation kernels : answers as the DEM tile under every kernel, kernels on planes & nodes
+
+#include <cmath>
+#include <memory>
+#include <random>
+#include <stdexcept>
+#include <vector>
+
+#include "DEM/FixedDEM.hpp"
+#include "DEM/Interpolation.hpp"
+#include "Test.hpp"
+
+
+
+// the fixed DEM over `tile` answers as `tile` with the same kernel, at every point, interpolated altitudes within `tolerance`
+template <typename Kernel>
+static size_t differ(const std::shared_ptr<const Tile>& tile, const std::vector<float>& latitudes, const std::vector<float>& longitudes, float tolerance) {
+    const FixedDEM<int16_t, 120, 120, 120, Kernel, std::endian::big> fixed(tile);
+
+    size_t off = 0;
+    for (size_t i = 0; i < latitudes.size(); ++i) {
+        off += fixed.altitude(latitudes[i], longitudes[i]) != tile->altitude(latitudes[i], longitudes[i]);
+        off += std::abs(fixed.interpolated_altitude(latitudes[i], longitudes[i]) - tile->template interpolated_altitude<Kernel>(latitudes[i], longitudes[i])) > tolerance;
+    }
+
+    // batch forms answer as the scalar ones
+    std::vector<int16_t> altitudes(latitudes.size());
+    std::vector<float> interpolated(latitudes.size());
+    fixed.altitude(latitudes, longitudes, altitudes);
+    fixed.interpolated_altitude(latitudes, longitudes, interpolated);
+    for (size_t i = 0; i < latitudes.size(); ++i) {
+        off += altitudes[i] != fixed.altitude(latitudes[i], longitudes[i]);
+        off += interpolated[i] != fixed.interpolated_altitude(latitudes[i], longitudes[i]);
+    }
+
+    return off;
+}
+
+
+int main() {
+    Scratch scratch("fixed_dem");
+    const size_t size = 120;
+    const Synthetic synthetic(size);
+    const TileMap::Grid grid = write_grid(synthetic, size, scratch.path, {{45, 6}});
+    const auto& [type, path] = grid.begin()->second;
+    const auto tile = std::make_shared<const Tile>(type, path);
+
+    std::mt19937 generator(11);
+    std::uniform_real_distribution<float> uniform(0, 1);
+
+    // points over the DEM tile & a little outside of it
+    const size_t n = 5000;
+    std::vector<float> latitudes(n), longitudes(n);
+    for (size_t i = 0; i < n; ++i) {
+        latitudes[i] = 44.95f + uniform(generator) * 1.1f;
+        longitudes[i] = 5.95f + uniform(generator) * 1.1f;
+    }
+
+    // the fixed DEM multiplies by the cells per degree where the DEM multiplies by the reciprocal of its cellsize,
+    // the fractional offsets may then round onto neighbouring steps of the bicubic weight table
+    CHECK(differ<Nearest>(tile, latitudes, longitudes, 0) == 0);
+    CHECK(differ<Bilinear>(tile, latitudes, longitudes, 1e-2f) == 0);
+    CHECK(differ<Bicubic>(tile, latitudes, longitudes, 0.5f) == 0);
+
+    // a fixed DEM read from the file answers as one over the DEM tile, outside of it with nodata
+    {
+        const FixedDEM<int16_t, 120, 120, 120, Bilinear, std::endian::big> read(type, path), shared(tile);
+        CHECK(read.interpolated_altitude(45.37f, 6.81f) == shared.interpolated_altitude(45.37f, 6.81f));
+        CHECK(read.altitude(44.5f, 6.5f) == nodata);
+        CHECK(read.interpolated_altitude(45.5f, 7.5f) == nodata);
+        CHECK(read.dem().storage() == Storage::Heap);
+    }
+
+    // DEMs of another geometry or with their values off the heap are refused, as are batches of spans differing in size
+    {
+        size_t thrown = 0;
+        try { FixedDEM<int16_t, 100, 120, 120, Bilinear, std::endian::big> rows(tile); } catch (const std::runtime_error&) { ++thrown; }
+        try { FixedDEM<int16_t, 120, 120, 100, Bilinear, std::endian::big> cells(tile); } catch (const std::runtime_error&) { ++thrown; }
+        try { FixedDEM<int16_t, 120, 120, 120, Bilinear, std::endian::big> mapped(std::make_shared<const Tile>(type, path, Storage::Mapped)); } catch (const std::runtime_error&) { ++thrown; }
+        try { FixedDEM<int16_t, 120, 120, 120, Bilinear, std::endian::big> empty(nullptr); } catch (const std::runtime_error&) { ++thrown; }
+
+        const FixedDEM<int16_t, 120, 120, 120, Bilinear, std::endian::big> fixed(tile);
+        std::vector<float> altitudes(n - 1);
+        try { fixed.interpolated_altitude(latitudes, longitudes, altitudes); } catch (const std::runtime_error&) { ++thrown; }
+        CHECK(thrown == 5);
+    }
+
+    // the kernels on a plane raster : every kernel passes through the values at the cells, the bilinear &
+    // bicubic kernels follow the plane between them, the nearest kernel takes the closest cell
+    {
+        const size_t nrows = 8, ncols = 10;
+        auto plane = [](float row, float column) { return 3 * row - 2 * column + 50; };
+        auto at = [&](size_t r, size_t c) { return plane(static_cast<float>(r), static_cast<float>(c)); };
+
+        size_t off = 0;
+        for (size_t r = 0; r < nrows; ++r) {
+            for (size_t c = 0; c < ncols; ++c) {
+                const float row = static_cast<float>(r), column = static_cast<float>(c);
+                off += Nearest::sample(row, column, nrows, ncols, at) != at(r, c);
+                off += Bilinear::sample(row, column, nrows, ncols, at) != at(r, c);
+                off += std::abs(Bicubic::sample(row, column, nrows, ncols, at) - at(r, c)) > 1e-4f;
+            }
+        }
+        CHECK(off == 0);
+
+        off = 0;
+        for (float row = 1; row < nrows - 2; row += 0.37f) {
+            for (float column = 1; column < ncols - 2; column += 0.29f) {
+                off += Nearest::sample(row, column, nrows, ncols, at) != plane(std::round(row), std::round(column));
+                off += std::abs(Bilinear::sample(row, column, nrows, ncols, at) - plane(row, column)) > 1e-3f;
+
+                // the bicubic weights are tabled in steps of 1/1024 cell
+                off += std::abs(Bicubic::sample(row, column, nrows, ncols, at) - plane(row, column)) > 5.0f / Bicubic::steps + 1e-3f;
+            }
+        }
+        CHECK(off == 0);
+
+        // the southern & eastern edges round onto the last row & column
+        CHECK(Nearest::sample(nrows - 0.2f, ncols - 0.2f, nrows, ncols, at) == at(nrows - 1, ncols - 1));
+        CHECK(Bilinear::sample(static_cast<float>(nrows), static_cast<float>(ncols), nrows, ncols, at) == at(nrows - 1, ncols - 1));
+        CHECK(std::abs(Bicubic::sample(static_cast<float>(nrows), static_cast<float>(ncols), nrows, ncols, at) - at(nrows - 1, ncols - 1)) < 1e-4f);
+    }
+
+    // the bicubic kernel passes through a curved surface at the cells, unlike a straight line between them
+    {
+        auto at = [](size_t r, size_t c) { return static_cast<float>(r * r + c * c); };
+        CHECK(std::abs(Bicubic::sample(3, 4, 8, 8, at) - 25) < 1e-4f);
+        CHECK(std::abs(Bicubic::sample(3.5f, 3, 8, 8, at) - (3.5f * 3.5f + 9)) < std::abs(Bilinear::sample(3.5f, 3, 8, 8, at) - (3.5f * 3.5f + 9)));
+    }
+
+    // the SRTM tiles pin their geometry
+    static_assert(SRTM1<>::nrows == 3601 && SRTM1<>::ncols == 3601);
+    static_assert(SRTM3<Bicubic>::nrows == 1201 && SRTM3<Bicubic>::ncols == 1201);
+
+    return finish();
+}
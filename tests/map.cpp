@@ -0,0 +1,352 @@
+/*
+MIT License
+
+Copyright (c) 2023 Pritam Halder
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated
+documentation files (the "Software"), to deal in the Software without restriction, including without
+limitation the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the
+Software, and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED
+TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF
+CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+DEALINGS IN THE SOFTWARE.
+
+Author : Pritam Halder
+Email : pritamhalder.portfolio@gmail.com
+*/
+
+
+
+// `Map` : answers as the DEM tile bounding every coordinate, in the scalar & batch forms, under its cache limits
+
+#include <cmath>
+#include <random>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+#include "DEM/ConcurrentMap.hpp"
+#include "DEM/Map.hpp"
+#include "Test.hpp"
+
+
+
+int main() {
+    Scratch scratch("map");
+    const size_t size = 120;
+    const Synthetic synthetic(size);
+    const TileMap::Grid grid = write_grid(synthetic, size, scratch.path, {{27, 86}, {27, 87}, {28, 86}, {28, 87}});
+    CHECK(grid.size() == 4);
+
+    // reference DEM tiles, read whole
+    std::vector<Tile> tiles;
+    for (const auto& [corner, entry] : grid) tiles.emplace_back(entry.first, entry.second);
+
+    auto reference = [&tiles](float latitude, float longitude) -> const Tile* {
+        for (const Tile& tile : tiles) {
+            if (tile.bounds.within(latitude, longitude)) return &tile;
+        }
+        return nullptr;
+    };
+
+    // a `Type` filled in field by field indexes like one from its constructor
+    {
+        Tile::Type type;
+        type.nrows = size;
+        type.ncols = size;
+        type.yllcorner = 27;
+        type.xllcorner = 86;
+        type.cellsize = 1.0f / static_cast<float>(size);
+        type.nodata = nodata;
+
+        const Tile& tile = *reference(27.5f, 86.5f);
+        const Tile fields(type, std::vector<int16_t>(tile.data()));
+        CHECK(fields.altitude(27.73f, 86.41f) == tile.altitude(27.73f, 86.41f));
+        CHECK(fields.interpolated_altitude(27.73f, 86.41f) == tile.interpolated_altitude(27.73f, 86.41f));
+        CHECK(fields.altitude(27.73f, 86.41f) != fields.at(0, 0));
+    }
+
+    std::mt19937 generator(3);
+    std::uniform_real_distribution<float> uniform(0, 1);
+
+    // points over the grid & a little outside of it
+    const size_t n = 5000;
+    std::vector<float> latitudes(n), longitudes(n);
+    for (size_t i = 0; i < n; ++i) {
+        latitudes[i] = 26.9f + uniform(generator) * 2.2f;
+        longitudes[i] = 85.9f + uniform(generator) * 2.2f;
+    }
+
+    TileMap::Options options;
+    options.capacity = 2;
+    options.statistics = true;
+    TileMap map(grid, options);
+
+    std::vector<int16_t> altitudes(n);
+    std::vector<float> interpolated(n);
+    for (size_t i = 0; i < n; ++i) {
+        altitudes[i] = map.altitude(latitudes[i], longitudes[i]);
+        interpolated[i] = map.interpolated_altitude(latitudes[i], longitudes[i]);
+        CHECK(map.resident() <= options.capacity);
+
+        const Tile* tile = reference(latitudes[i], longitudes[i]);
+        CHECK(altitudes[i] == (tile ? tile->altitude(latitudes[i], longitudes[i]) : nodata));
+        CHECK(interpolated[i] == (tile ? tile->interpolated_altitude(latitudes[i], longitudes[i]) : nodata));
+    }
+
+    const Statistics::Snapshot counters = map.statistics().snapshot();
+    CHECK(counters[Statistics::Queries] == 2 * n);
+    CHECK(counters[Statistics::Loads] >= 4);
+    CHECK(counters[Statistics::Evictions] + options.capacity >= counters[Statistics::Loads]);
+    CHECK(counters[Statistics::Bytes] == counters[Statistics::Loads] * size * size * sizeof(int16_t));
+
+    // batch forms, on one & on several threads
+    for (size_t threads : {1, 3}) {
+        std::vector<int16_t> batch(n);
+        std::vector<float> batch_interpolated(n);
+        map.altitude(latitudes, longitudes, batch, threads);
+        map.interpolated_altitude(latitudes, longitudes, batch_interpolated, threads);
+        CHECK(batch == altitudes);
+        CHECK(batch_interpolated == interpolated);
+        CHECK(map.resident() <= options.capacity);
+    }
+
+    // the DEM tiles loaded by the workers are cached : a second batch over them loads none
+    {
+        TileMap::Options roomy = options;
+        roomy.capacity = 4;
+        TileMap batched(grid, roomy);
+        std::vector<int16_t> batch(n);
+        batched.altitude(latitudes, longitudes, batch, 3);
+        CHECK(batched.resident() == 4);
+
+        const uint64_t loads = batched.statistics().snapshot()[Statistics::Loads];
+        batched.altitude(latitudes, longitudes, batch, 3);
+        CHECK(batched.statistics().snapshot()[Statistics::Loads] == loads);
+        CHECK(batch == altitudes);
+
+        // invalid coordinates throw in the batch forms as in the scalar ones
+        std::vector<float> invalid = latitudes;
+        invalid[n / 2] = 91;
+        for (size_t threads : {1, 3}) {
+            bool thrown = false;
+            try { batched.altitude(invalid, longitudes, batch, threads); } catch (const std::runtime_error&) { thrown = true; }
+            CHECK(thrown);
+        }
+    }
+
+    // the concurrent map answers the same from several threads, each through its own reader
+    {
+        ConcurrentMap<int16_t, std::endian::big> concurrent(grid, options);
+        std::vector<size_t> differ(3, 0);
+        std::vector<std::thread> threads;
+        for (size_t t = 0; t < differ.size(); ++t) {
+            threads.emplace_back([&, t]() {
+                for (size_t i = t; i < n; i += differ.size()) {
+                    differ[t] += concurrent.altitude(latitudes[i], longitudes[i]) != altitudes[i];
+                    differ[t] += concurrent.interpolated_altitude(latitudes[i], longitudes[i]) != interpolated[i];
+                }
+            });
+        }
+        for (std::thread& thread : threads) thread.join();
+        CHECK(differ == std::vector<size_t>(3, 0));
+        CHECK(concurrent.resident() <= options.capacity);
+        CHECK(concurrent.statistics().snapshot()[Statistics::Queries] == 2 * n);
+    }
+
+    // a tile queried again after a later load survives the next eviction, though its reader never missed it
+    {
+        ConcurrentMap<int16_t, std::endian::big> concurrent(grid, options);
+        concurrent.altitude(27.5f, 86.5f);
+        concurrent.altitude(27.5f, 87.5f);
+        concurrent.altitude(27.5f, 86.5f);
+        concurrent.altitude(28.5f, 86.5f);
+
+        const size_t loads = concurrent.statistics().snapshot()[Statistics::Loads];
+        concurrent.altitude(27.5f, 86.5f);
+        concurrent.tile(27.5f, 86.5f);
+        CHECK(concurrent.statistics().snapshot()[Statistics::Loads] == loads);
+    }
+
+    // readers count their queries on their own & release the tiles evicted from the map on their next query
+    {
+        TileMap::Options single = options;
+        single.capacity = 1;
+        ConcurrentMap<int16_t, std::endian::big> concurrent(grid, single);
+        ConcurrentMap<int16_t, std::endian::big>::Reader reader(concurrent);
+
+        reader.altitude(27.5f, 86.5f);
+        const std::weak_ptr<const Tile> first = concurrent.tile(27.5f, 86.5f);
+        concurrent.altitude(28.5f, 86.5f);
+        CHECK(!first.expired());
+
+        reader.altitude(28.5f, 86.5f);
+        CHECK(first.expired());
+
+        const size_t queries = concurrent.statistics().snapshot()[Statistics::Queries];
+        reader.flush();
+        CHECK(queries < 3 && concurrent.statistics().snapshot()[Statistics::Queries] == 3);
+    }
+
+    // options the concurrent map can't honour are refused
+    for (size_t refused : {0, 1}) {
+        TileMap::Options unsupported;
+        (refused == 0 ? unsupported.halo : unsupported.prefetch) = 1;
+        bool thrown = false;
+        try { ConcurrentMap<int16_t, std::endian::big> concurrent(grid, unsupported); } catch (const std::runtime_error&) { thrown = true; }
+        CHECK(thrown);
+    }
+
+    // prefetching maps & their copies, queried along tracks from their own threads, answer as the DEM tiles
+    {
+        TileMap::Options prefetched = options;
+        prefetched.prefetch = 2;
+        prefetched.horizon = 1;
+        TileMap original(grid, prefetched);
+        TileMap copy = original;
+
+        std::vector<size_t> differ(2, 0);
+        std::vector<std::thread> threads;
+        for (size_t t = 0; t < differ.size(); ++t) {
+            threads.emplace_back([&, t]() {
+                TileMap& queried = t == 0 ? original : copy;
+                for (size_t i = 0; i < n; ++i) {
+                    const float f = static_cast<float>(i) / static_cast<float>(n);
+                    const float latitude = t == 0 ? 27.05f + 1.9f * f : 28.95f - 1.9f * f, longitude = 86.05f + 1.9f * f;
+                    const Tile* tile = reference(latitude, longitude);
+                    differ[t] += queried.altitude(latitude, longitude) != (tile ? tile->altitude(latitude, longitude) : nodata);
+                }
+            });
+        }
+        for (std::thread& thread : threads) thread.join();
+        CHECK(differ == std::vector<size_t>(2, 0));
+
+        // a DEM tile is loaded once, either by the prefetcher or by the query missing it, however fast the queries
+        prefetched.capacity = 4;
+        prefetched.horizon = 1000;
+        TileMap counted(grid, prefetched);
+        for (size_t i = 0; i < n; ++i) {
+            const float f = static_cast<float>(i) / static_cast<float>(n);
+            counted.altitude(27.05f + 1.9f * f, 86.05f + 1.9f * f);
+        }
+        const Statistics::Snapshot loaded = counted.statistics().snapshot();
+        CHECK(loaded[Statistics::Loads] <= 4);
+        CHECK(loaded[Statistics::Bytes] == loaded[Statistics::Loads] * size * size * sizeof(int16_t));
+    }
+
+    // every storage answers the same, mapped DEM tiles read no bytes up front
+    for (Storage storage : {Storage::Mapped, Storage::Blocks}) {
+        TileMap::Options stored;
+        stored.storage = storage;
+        stored.statistics = true;
+        TileMap other(grid, stored);
+        size_t differ = 0;
+        for (size_t i = 0; i < n; ++i) differ += other.altitude(latitudes[i], longitudes[i]) != altitudes[i];
+        CHECK(differ == 0);
+        CHECK(other.statistics().snapshot()[Statistics::Bytes] == 0);
+    }
+
+    // every storage counts towards the byte budget, in both maps
+    const size_t tile_bytes = size * size * sizeof(int16_t);
+    for (Storage storage : {Storage::Heap, Storage::Mapped}) {
+        TileMap::Options limited;
+        limited.capacity = 4;
+        limited.budget = tile_bytes + tile_bytes / 2;
+        limited.storage = storage;
+
+        TileMap small(grid, limited);
+        ConcurrentMap<int16_t, std::endian::big> concurrent(grid, limited);
+        for (const auto& [corner, entry] : grid) {
+            small.altitude(corner.latitude + 0.5f, corner.longitude + 0.5f);
+            concurrent.altitude(corner.latitude + 0.5f, corner.longitude + 0.5f);
+        }
+
+        CHECK(small.get_dem().resident_bytes() == tile_bytes);
+        CHECK(small.resident() == 1);
+        CHECK(concurrent.resident() == 1);
+    }
+
+    // with halos the kernels interpolate across the seams of the DEM tiles as over one DEM tile of the whole grid
+    {
+        std::vector<int16_t> whole(4 * size * size);
+        for (const auto& [corner, entry] : grid) {
+            const Tile& tile = *reference(corner.latitude + 0.5f, corner.longitude + 0.5f);
+            const size_t r0 = corner.latitude == 27 ? size : 0, c0 = corner.longitude == 87 ? size : 0;
+            for (size_t r = 0; r < size; ++r) {
+                for (size_t c = 0; c < size; ++c) whole[(r0 + r) * 2 * size + c0 + c] = tile.at(r, c);
+            }
+        }
+        const Tile merged(Tile::Type(2 * size, 2 * size, 27, 86, 1.0f / static_cast<float>(size), nodata), whole);
+
+        TileMap::Options surrounded = options;
+        TileMap plain(grid, options);
+        surrounded.halo = 1;
+        TileMap bilinear(grid, surrounded);
+        surrounded.halo = 2;
+        TileMap bicubic(grid, surrounded);
+
+        // points within a few cells of the seams, along them up to the edges of the grid
+        size_t off = 0, clamped = 0;
+        std::vector<float> latitudes(n), longitudes(n), expected(n);
+        for (size_t i = 0; i < n; ++i) {
+            const float along = 0.0001f + 1.9998f * uniform(generator), across = 4 * (uniform(generator) - 0.5f) / static_cast<float>(size);
+            const float latitude = i % 2 == 0 ? 28 + across : 27 + along, longitude = i % 2 == 0 ? 86 + along : 87 + across;
+            latitudes[i] = latitude;
+            longitudes[i] = longitude;
+
+            expected[i] = merged.interpolated_altitude(latitude, longitude);
+            off += std::abs(bilinear.interpolated_altitude(latitude, longitude) - expected[i]) > 0.1f;
+            clamped += std::abs(plain.interpolated_altitude(latitude, longitude) - expected[i]) > 0.1f;
+
+            // past the centers of the last row & column of the grid the bicubic kernel of the whole grid stops
+            // interpolating, while over a halo repeating the edge it keeps weighing the cells inside
+            const float edge = 1.0f / static_cast<float>(size);
+            if (latitude > 27 + edge && longitude < 88 - edge) {
+                off += std::abs(bicubic.interpolated_altitude<Bicubic>(latitude, longitude) - merged.interpolated_altitude<Bicubic>(latitude, longitude)) > 0.5f;
+            }
+        }
+        CHECK(off == 0);
+        CHECK(clamped > 0);
+
+        // batch queries, with the DEM tiles loaded by the workers too
+        for (size_t threads : {1, 4}) {
+            TileMap batched(grid, surrounded);
+            std::vector<float> altitudes(n);
+            batched.interpolated_altitude(latitudes, longitudes, altitudes, threads);
+            for (size_t i = 0; i < n; ++i) off += std::abs(altitudes[i] - expected[i]) > 0.1f;
+        }
+        CHECK(off == 0);
+
+        // the DEM tiles are kept as they are, only the strips of their halos are added
+        const auto strips = bicubic.halo(27.5f, 86.5f);
+        CHECK(strips && bicubic.get_dem().type.nrows == size && bicubic.get_dem().type.ncols == size);
+        CHECK(strips->north.type.nrows == 3 && strips->north.type.ncols == size + 4 && strips->west.type.nrows == size && strips->east.type.ncols == 3);
+        CHECK(!plain.halo(27.5f, 86.5f));
+    }
+
+    // profiles across the seams of the DEM tiles follow the DEM tiles
+    const std::vector<Sample> profile = map.profile({27.2f, 86.3f}, {28.8f, 87.6f});
+    CHECK(profile.size() == map.get_dem().samples({27.2f, 86.3f}, {28.8f, 87.6f}));
+    size_t off = 0;
+    for (const Sample& sample : profile) {
+        const Tile* tile = reference(sample.latitude, sample.longitude);
+        off += !tile || std::abs(sample.altitude - tile->interpolated_altitude(sample.latitude, sample.longitude)) > 0.5f;
+    }
+    CHECK(off == 0);
+
+    // manifests list the same grid
+    TileMap::save_manifest(grid, scratch.path / "grid.manifest");
+    const TileMap::Grid manifest = TileMap::load_manifest(scratch.path / "grid.manifest", true);
+    CHECK(manifest.size() == grid.size());
+    for (const auto& [corner, entry] : grid) {
+        auto listed = manifest.find(corner);
+        CHECK(listed != manifest.end() && std::filesystem::equivalent(listed->second.second, entry.second));
+    }
+
+    return finish();
+}
@@ -0,0 +1,221 @@
+/*
+MIT License
+
+Copyright (c) 2023 Pritam Halder
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated
+documentation files (the "Software"), to deal in the Software without restriction, including without
+limitation the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the
+Software, and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED
+TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF
+CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+DEALINGS IN THE SOFTWARE.
+
+Author : Pritam Halder
+Email : pritamhalder.portfolio@gmail.com
+*/
+
+
+
+// `Mosaic` : every resampling against the map queries & the DEM values it stands for
+
+#include <cmath>
+#include <filesystem>
+#include <fstream>
+#include <map>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "DEM/Mosaic.hpp"
+#include "Test.hpp"
+
+
+
+int main() {
+    Scratch scratch("mosaic");
+    const size_t size = 120;
+    const Synthetic synthetic(size);
+    const TileMap::Grid grid = write_grid(synthetic, size, scratch.path, {{27, 86}, {27, 87}, {28, 86}, {28, 87}});
+    const float source = 1.0f / size;
+
+    TileMap::Options options;
+    options.capacity = 2;
+    TileMap map(grid, options);
+
+    // output cells half a DEM cell off the DEM values, at the resolution of the DEM & 4x coarser
+    const Bounds region({28.9f, 86 + source / 2}, {28.9f, 87.9f}, {27 + source / 2, 86 + source / 2}, {27 + source / 2, 87.9f});
+
+    for (size_t threads : {1, 3}) {
+        // `Nearest` & `Bilinear` answer as the map at the output cells
+        const DEM<float> nearest = Mosaic::compute(map, region, source, Mosaic::Resampling::Nearest, threads, 64);
+        const DEM<float> bilinear = Mosaic::compute(map, region, source, Mosaic::Resampling::Bilinear, threads, 64);
+        CHECK(nearest.type.nrows == bilinear.type.nrows && nearest.type.ncols == bilinear.type.ncols);
+
+        size_t off = 0;
+        for (size_t r = 0; r < nearest.type.nrows; ++r) {
+            const float latitude = nearest.bounds.NE.latitude - static_cast<float>(r) * source;
+            for (size_t c = 0; c < nearest.type.ncols; ++c) {
+                const float longitude = nearest.bounds.SW.longitude + static_cast<float>(c) * source;
+                off += nearest.at(r, c) != static_cast<float>(map.altitude(latitude, longitude));
+                off += bilinear.at(r, c) != map.interpolated_altitude(latitude, longitude);
+            }
+        }
+        CHECK(off == 0);
+
+        // `Average` : mean of the DEM values within half an output cell of every output cell
+        const float cellsize = 4 * source;
+        const DEM<float> average = Mosaic::compute(map, region, cellsize, Mosaic::Resampling::Average, threads, 16);
+
+        std::vector<double> sums(average.data().size(), 0);
+        std::vector<size_t> counts(average.data().size(), 0);
+        for (const auto& [corner, entry] : grid) {
+            const Tile dem(entry.first, entry.second);
+            for (size_t i = 0; i < dem.type.nrows; ++i) {
+                const double latitude = static_cast<double>(dem.bounds.NE.latitude) - static_cast<double>(i) * source;
+                const double r = std::floor((static_cast<double>(average.bounds.NE.latitude) + cellsize / 2.0 - latitude) / cellsize);
+                if (r < 0 || r >= static_cast<double>(average.type.nrows)) continue;
+
+                for (size_t j = 0; j < dem.type.ncols; ++j) {
+                    const double longitude = static_cast<double>(dem.bounds.SW.longitude) + static_cast<double>(j) * source;
+                    const double c = std::floor((longitude - static_cast<double>(average.bounds.SW.longitude) + cellsize / 2.0) / cellsize);
+                    if (c < 0 || c >= static_cast<double>(average.type.ncols)) continue;
+
+                    const size_t k = static_cast<size_t>(r) * average.type.ncols + static_cast<size_t>(c);
+                    sums[k] += dem.at(i, j);
+                    counts[k] += 1;
+                }
+            }
+        }
+
+        off = 0;
+        for (size_t k = 0; k < average.data().size(); ++k) {
+            const float expected = counts[k] == 0 ? static_cast<float>(nodata) : static_cast<float>(sums[k] / static_cast<double>(counts[k]));
+            off += std::abs(average.data()[k] - expected) > 1e-2f;
+        }
+        CHECK(off == 0);
+    }
+
+    // `Average` finer than the DEM tiles : cells without a DEM value in their footprint interpolate as the map
+    {
+        const float cellsize = source / 3;
+        const Bounds seams({28.05f, 86.95f}, {28.05f, 87.05f}, {27.95f, 86.95f}, {27.95f, 87.05f});
+        const DEM<float> average = Mosaic::compute(map, seams, cellsize, Mosaic::Resampling::Average, 3, 16);
+
+        std::vector<double> sums(average.data().size(), 0);
+        std::vector<size_t> counts(average.data().size(), 0);
+        for (const auto& [corner, entry] : grid) {
+            const Tile dem(entry.first, entry.second);
+            for (size_t i = 0; i < dem.type.nrows; ++i) {
+                const double latitude = static_cast<double>(dem.bounds.NE.latitude) - static_cast<double>(i) * source;
+                const double r = std::floor((static_cast<double>(average.bounds.NE.latitude) + cellsize / 2.0 - latitude) / cellsize);
+                if (r < 0 || r >= static_cast<double>(average.type.nrows)) continue;
+
+                for (size_t j = 0; j < dem.type.ncols; ++j) {
+                    const double longitude = static_cast<double>(dem.bounds.SW.longitude) + static_cast<double>(j) * source;
+                    const double c = std::floor((longitude - static_cast<double>(average.bounds.SW.longitude) + cellsize / 2.0) / cellsize);
+                    if (c < 0 || c >= static_cast<double>(average.type.ncols)) continue;
+
+                    const size_t k = static_cast<size_t>(r) * average.type.ncols + static_cast<size_t>(c);
+                    sums[k] += dem.at(i, j);
+                    counts[k] += 1;
+                }
+            }
+        }
+
+        size_t off = 0, sampled = 0;
+        for (size_t r = 0; r < average.type.nrows; ++r) {
+            const float latitude = average.bounds.NE.latitude - static_cast<float>(r) * cellsize;
+            for (size_t c = 0; c < average.type.ncols; ++c) {
+                const float longitude = average.bounds.SW.longitude + static_cast<float>(c) * cellsize;
+                const size_t k = r * average.type.ncols + c;
+                const float expected = counts[k] == 0 ? map.interpolated_altitude(latitude, longitude) : static_cast<float>(sums[k] / static_cast<double>(counts[k]));
+                off += std::abs(average.data()[k] - expected) > 1e-2f;
+                sampled += counts[k] == 0;
+            }
+        }
+        CHECK(off == 0);
+        CHECK(sampled > average.data().size() / 2);
+    }
+
+    // DEM tiles repeating the first row / column of their southern / eastern neighbour (SRTM style) :
+    // `Average` counts every DEM value once
+    {
+        const size_t n = size + 1;
+        TileMap::Grid shared;
+        for (const auto& [latitude, longitude] : std::vector<std::pair<int, int>>{{27, 86}, {27, 87}, {28, 86}, {28, 87}}) {
+            const std::vector<int16_t> own = synthetic.values<int16_t>(latitude, longitude);
+            const std::vector<int16_t> south = synthetic.values<int16_t>(latitude - 1, longitude);
+            const std::vector<int16_t> east = synthetic.values<int16_t>(latitude, longitude + 1);
+            const std::vector<int16_t> corner = synthetic.values<int16_t>(latitude - 1, longitude + 1);
+
+            std::vector<int16_t> values(n * n);
+            for (size_t i = 0; i < n; ++i) {
+                for (size_t j = 0; j < n; ++j) {
+                    const std::vector<int16_t>& from = i < size ? (j < size ? own : east) : (j < size ? south : corner);
+                    values[i * n + j] = from[(i % size) * size + j % size];
+                }
+            }
+
+            const std::filesystem::path path = scratch.path / ("srtm_" + std::to_string(latitude) + "_" + std::to_string(longitude) + ".bin");
+            serialize<int16_t, std::endian::big>(values.data(), values.size());
+            std::ofstream(path, std::ios::binary).write(reinterpret_cast<const char*>(values.data()), static_cast<std::streamsize>(values.size() * sizeof(int16_t)));
+
+            const Tile::Type type(n, n, static_cast<float>(latitude) - source, static_cast<float>(longitude), source, nodata);
+            shared[{static_cast<float>(latitude), static_cast<float>(longitude)}] = {type, path};
+        }
+        TileMap srtm(shared, options);
+
+        const float cellsize = 4 * source;
+        const DEM<float> average = Mosaic::compute(srtm, region, cellsize, Mosaic::Resampling::Average, 3, 16);
+
+        // the DEM values of the 2 x 2 degrees, each once, at their global rows & columns
+        std::map<std::pair<int, int>, std::vector<int16_t>> tiles;
+        for (int latitude : {26, 27, 28}) {
+            for (int longitude : {86, 87, 88}) tiles[{latitude, longitude}] = synthetic.values<int16_t>(latitude, longitude);
+        }
+
+        std::vector<double> sums(average.data().size(), 0);
+        std::vector<size_t> counts(average.data().size(), 0);
+        for (size_t i = 0; i <= 2 * size; ++i) {
+            const int latitude = i < size ? 28 : (i < 2 * size ? 27 : 26);
+            const double y = 29.0 - static_cast<double>(i) * source;
+            const double r = std::floor((static_cast<double>(average.bounds.NE.latitude) + cellsize / 2.0 - y) / cellsize);
+            if (r < 0 || r >= static_cast<double>(average.type.nrows)) continue;
+
+            for (size_t j = 0; j <= 2 * size; ++j) {
+                const int longitude = j < size ? 86 : (j < 2 * size ? 87 : 88);
+                const double x = 86.0 + static_cast<double>(j) * source;
+                const double c = std::floor((x - static_cast<double>(average.bounds.SW.longitude) + cellsize / 2.0) / cellsize);
+                if (c < 0 || c >= static_cast<double>(average.type.ncols)) continue;
+
+                const size_t k = static_cast<size_t>(r) * average.type.ncols + static_cast<size_t>(c);
+                sums[k] += tiles[{latitude, longitude}][(i % size) * size + j % size];
+                counts[k] += 1;
+            }
+        }
+
+        size_t off = 0;
+        for (size_t k = 0; k < average.data().size(); ++k) {
+            const float expected = counts[k] == 0 ? static_cast<float>(nodata) : static_cast<float>(sums[k] / static_cast<double>(counts[k]));
+            off += std::abs(average.data()[k] - expected) > 1e-2f;
+        }
+        CHECK(off == 0);
+    }
+
+    // written mosaics read back as a DEM tile of the map's data type
+    const Tile::Type type = Mosaic::write(map, region, source, scratch.path / "mosaic.bin", Mosaic::Resampling::Nearest);
+    const Tile written(type, scratch.path / "mosaic.bin");
+    const DEM<float> nearest = Mosaic::compute(map, region, source, Mosaic::Resampling::Nearest);
+    size_t off = 0;
+    for (size_t i = 0; i < nearest.data().size(); ++i) off += static_cast<float>(written.data()[i]) != nearest.data()[i];
+    CHECK(written.data().size() == nearest.data().size());
+    CHECK(off == 0);
+
+    return finish();
+}
@@ -0,0 +1,225 @@
+/*
+MIT License
+
+Copyright (c) 2023 Pritam Halder
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated
+documentation files (the "Software"), to deal in the Software without restriction, including without
+limitation the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the
+Software, and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED
+TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF
+CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+DEALINGS IN THE SOFTWARE.
+
+Author : Pritam Halder
+Email : pritamhalder.portfolio@gmail.com
+*/
+
+
+
+// `Pyramid` : overview cells & region statistics against brute force over the base DEM values
+
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <limits>
+#include <random>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+#include "DEM/Pyramid.hpp"
+#include "Test.hpp"
+
+
+
+int main() {
+    Scratch scratch("pyramid");
+    const size_t size = 181;    // odd, the overviews have partial cells at the southern & eastern edges
+    const Synthetic synthetic(size);
+
+    std::vector<int16_t> values = synthetic.values<int16_t>(45, 7);
+    for (size_t i = 0; i < values.size(); i += 97) values[i] = nodata;
+    const Tile dem(synthetic.type<int16_t, std::endian::big>(45, 7), values);
+
+    const Pyramid pyramid = Pyramid::build(dem, 0, 2);
+    CHECK(!pyramid.levels.empty());
+    CHECK(pyramid.levels.back().mean.type.nrows == 1 && pyramid.levels.back().mean.type.ncols == 1);
+
+    // every overview cell against the base DEM values it covers
+    size_t off = 0;
+    for (const Pyramid::Level& level : pyramid.levels) {
+        const size_t f = level.factor;
+        CHECK(level.mean.type.ncols == (size + f - 1) / f);
+
+        for (size_t r = 0; r < level.mean.type.nrows; ++r) {
+            for (size_t c = 0; c < level.mean.type.ncols; ++c) {
+                float min = std::numeric_limits<float>::max(), max = std::numeric_limits<float>::lowest();
+                double sum = 0;
+                uint32_t valid = 0;
+                for (size_t i = r * f; i < std::min((r + 1) * f, size); ++i) {
+                    for (size_t j = c * f; j < std::min((c + 1) * f, size); ++j) {
+                        const int16_t v = dem.at(i, j);
+                        if (v == nodata) continue;
+                        min = std::min(min, static_cast<float>(v));
+                        max = std::max(max, static_cast<float>(v));
+                        sum += v;
+                        ++valid;
+                    }
+                }
+
+                const size_t k = r * level.mean.type.ncols + c;
+                off += level.valid[k] != valid;
+                if (valid == 0) continue;
+                off += level.min.data()[k] != min || level.max.data()[k] != max;
+                off += std::abs(level.mean.data()[k] - static_cast<float>(sum / valid)) > 1e-2f;
+            }
+        }
+    }
+    CHECK(off == 0);
+
+    // coarse min & max of a coordinate against the window of base DEM values under the overview cell
+    // covering the base value the DEM answers the coordinate with
+    auto window = [](const Tile& base, size_t f, float latitude, float longitude) -> std::pair<float, float> {
+        const size_t n = base.type.nrows;
+        const size_t r = std::min<size_t>(static_cast<size_t>(std::round((base.bounds.NE.latitude - latitude) / base.type.cellsize)), n - 1) / f * f;
+        const size_t c = std::min<size_t>(static_cast<size_t>(std::round((longitude - base.bounds.SW.longitude) / base.type.cellsize)), n - 1) / f * f;
+
+        float min = std::numeric_limits<float>::max(), max = std::numeric_limits<float>::lowest();
+        for (size_t i = r; i < std::min(r + f, n); ++i) {
+            for (size_t j = c; j < std::min(c + f, n); ++j) {
+                if (base.at(i, j) == nodata) continue;
+                min = std::min(min, static_cast<float>(base.at(i, j)));
+                max = std::max(max, static_cast<float>(base.at(i, j)));
+            }
+        }
+        return {min, max};
+    };
+
+    std::mt19937 coordinates(11);
+    std::uniform_real_distribution<float> unit(0, 1);
+
+    off = 0;
+    for (size_t f : {2, 4, 16}) {
+        const float resolution = dem.type.cellsize * static_cast<float>(f);
+        for (int i = 0; i < 2000; ++i) {
+            const float latitude = 45 + unit(coordinates), longitude = 7 + unit(coordinates);
+            const auto [min, max] = window(dem, f, latitude, longitude);
+            if (min > max) continue;
+
+            const int16_t value = dem.altitude(latitude, longitude);
+            off += pyramid.altitude(latitude, longitude, resolution, Pyramid::Statistic::Min) != min;
+            off += pyramid.altitude(latitude, longitude, resolution, Pyramid::Statistic::Max) != max;
+            off += value != nodata && (value < min || value > max);
+        }
+    }
+    CHECK(off == 0);
+
+    // the same through a map, which keeps the overviews of atmost `capacity` DEM tiles
+    {
+        Scratch tiles("pyramid_map");
+        const TileMap::Grid grid = write_grid(synthetic, size, tiles.path, {{45, 7}, {45, 8}, {46, 7}});
+        std::vector<Tile> bases;
+        for (const auto& [corner, entry] : grid) bases.emplace_back(entry.first, entry.second);
+
+        TileMap::Options options;
+        options.capacity = 1;
+        TileMap map(grid, options);
+
+        off = 0;
+        const float resolution = dem.type.cellsize * 4;
+        for (int i = 0; i < 3000; ++i) {
+            const float latitude = 45 + unit(coordinates) * 2, longitude = 7 + unit(coordinates) * 2;
+            const auto base = std::find_if(bases.begin(), bases.end(), [&](const Tile& t) { return t.bounds.within(latitude, longitude); });
+            if (base == bases.end()) {
+                off += map.coarse_altitude(latitude, longitude, resolution, Pyramid::Statistic::Min) != nodata;
+                continue;
+            }
+
+            const auto [min, max] = window(*base, 4, latitude, longitude);
+            off += map.coarse_altitude(latitude, longitude, resolution, Pyramid::Statistic::Min) != min;
+            off += map.coarse_altitude(latitude, longitude, resolution, Pyramid::Statistic::Max) != max;
+        }
+        CHECK(off == 0);
+
+        // the overviews built are saved next to the DEM tiles
+        for (const auto& [corner, entry] : grid) CHECK(std::filesystem::exists(Pyramid::path(entry.second)));
+
+        // an `.ovr` file of another DEM is rebuilt from the DEM tile
+        const std::filesystem::path stale = Pyramid::path(grid.begin()->second.second);
+        Pyramid::build(Tile(Tile::Type(10, 10, 45, 7, 0.1f, nodata), std::vector<int16_t>(100, 5))).save(stale);
+        TileMap rebuilt(grid, options);
+        const auto [min, max] = window(bases.front(), 4, 45.5f, 7.5f);
+        CHECK(rebuilt.coarse_altitude(45.5f, 7.5f, resolution, Pyramid::Statistic::Min) == min);
+        CHECK(rebuilt.coarse_altitude(45.5f, 7.5f, resolution, Pyramid::Statistic::Max) == max);
+        CHECK(Pyramid::load(stale).fits(size, size));
+    }
+
+    // region statistics & clearance checks
+    std::mt19937 generator(5);
+    std::uniform_real_distribution<float> uniform(0, 1);
+    const float cellsize = dem.type.cellsize, north = dem.bounds.NE.latitude, west = dem.bounds.SW.longitude;
+
+    for (int i = 0; i < 100; ++i) {
+        const float south = 45 + uniform(generator) * 0.8f, east_of = 7 + uniform(generator) * 0.8f;
+        const float top = south + uniform(generator) * 0.3f, east = east_of + uniform(generator) * 0.3f;
+        const Bounds box({top, east_of}, {top, east}, {south, east_of}, {south, east});
+
+        float min = std::numeric_limits<float>::max(), max = std::numeric_limits<float>::lowest();
+        double sum = 0;
+        size_t count = 0;
+        for (size_t r = 0; r < size; ++r) {
+            const float latitude = north - static_cast<float>(r) * cellsize;
+            if (latitude < south || latitude > top) continue;
+            for (size_t c = 0; c < size; ++c) {
+                const float longitude = west + static_cast<float>(c) * cellsize;
+                const int16_t v = dem.at(r, c);
+                if (longitude < east_of || longitude > east || v == nodata) continue;
+                min = std::min(min, static_cast<float>(v));
+                max = std::max(max, static_cast<float>(v));
+                sum += v;
+                ++count;
+            }
+        }
+
+        const Pyramid::Summary summary = pyramid.summarize(dem, box);
+        CHECK(summary.count == count);
+        if (count != 0) {
+            CHECK(summary.min == min);
+            CHECK(summary.max == max);
+            CHECK(std::abs(summary.mean - static_cast<float>(sum / static_cast<double>(count))) < 1e-2f);
+            CHECK(pyramid.exceeds(dem, box, max - 1));
+            CHECK(!pyramid.exceeds(dem, box, max));
+        }
+    }
+
+    // `.ovr` files read back the levels they were saved with
+    pyramid.save(scratch.path / "45_7.ovr");
+    const Pyramid loaded = Pyramid::load(scratch.path / "45_7.ovr");
+    CHECK(loaded.levels.size() == pyramid.levels.size());
+    for (size_t l = 0; l < std::min(loaded.levels.size(), pyramid.levels.size()); ++l) {
+        CHECK(loaded.levels[l].factor == pyramid.levels[l].factor);
+        CHECK(loaded.levels[l].min.data() == pyramid.levels[l].min.data());
+        CHECK(loaded.levels[l].max.data() == pyramid.levels[l].max.data());
+        CHECK(loaded.levels[l].mean.data() == pyramid.levels[l].mean.data());
+        CHECK(loaded.levels[l].valid == pyramid.levels[l].valid);
+    }
+
+    // only the levels atleast 8x coarser are read
+    const Pyramid coarse = Pyramid::load(scratch.path / "45_7.ovr", 8);
+    CHECK(!coarse.levels.empty() && coarse.levels.front().factor == 8);
+
+    // `.ovr` files of another version are refused
+    std::filesystem::copy_file(scratch.path / "45_7.ovr", scratch.path / "older.ovr");
+    std::fstream(scratch.path / "older.ovr", std::ios::binary | std::ios::in | std::ios::out).seekp(4).write("\x01\x00", 2);
+    bool thrown = false;
+    try { Pyramid::load(scratch.path / "older.ovr"); } catch (const std::runtime_error&) { thrown = true; }
+    CHECK(thrown);
+
+    return finish();
+}
@@ -0,0 +1,140 @@
+/*
+MIT License
+
+Copyright (c) 2023 Pritam Halder
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated
+documentation files (the "Software"), to deal in the Software without restriction, including without
+limitation the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the
+Software, and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED
+TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF
+CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+DEALINGS IN THE SOFTWARE.
+
+Author : Pritam Halder
+Email : pritamhalder.portfolio@gmail.com
+*/
+
+
+
+// `Raycast` : first hits against a brute force march along the rays, with & without the quadtree & through a `Map` (with & without halos)
+
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <random>
+#include <vector>
+
+#include "DEM/Raycast.hpp"
+#include "Test.hpp"
+
+
+
+// bilinear terrain at the coordinate, nan next to nodata DEM values or outside the DEM
+static double surface(const Tile& dem, double latitude, double longitude) {
+    const double cellsize = dem.type.cellsize;
+    const size_t last_row = dem.type.nrows - 1, last_column = dem.type.ncols - 1;
+
+    const double row = (dem.bounds.NE.latitude - latitude) / cellsize, column = (longitude - dem.bounds.SW.longitude) / cellsize;
+    if (row < 0 || column < 0 || row > static_cast<double>(last_row) || column > static_cast<double>(last_column)) return NAN;
+
+    const size_t r = std::min<size_t>(static_cast<size_t>(row), last_row - 1), c = std::min<size_t>(static_cast<size_t>(column), last_column - 1);
+    const int16_t v[4] = {dem.at(r, c), dem.at(r, c + 1), dem.at(r + 1, c), dem.at(r + 1, c + 1)};
+    if (std::find(v, v + 4, nodata) != v + 4) return NAN;
+
+    const double u = row - static_cast<double>(r), w = column - static_cast<double>(c);
+    return (1 - u) * ((1 - w) * v[0] + w * v[1]) + u * ((1 - w) * v[2] + w * v[3]);
+}
+
+
+// first point of the ray at or below the terrain, marched every meter (-1 without a hit)
+static double march(const Tile& dem, const Raycast::Ray& ray) {
+    const double radians = 0.017453292519943295;
+    const double elevation = ray.elevation * radians, azimuth = ray.azimuth * radians;
+
+    for (double t = 0; t <= ray.range; t += 1) {
+        const double horizontal = t * std::cos(elevation);
+        const double latitude = ray.origin.latitude + horizontal * std::cos(azimuth) / 111320.0;
+        const double longitude = ray.origin.longitude + horizontal * std::sin(azimuth) / (111320.0 * std::cos(ray.origin.latitude * radians));
+        const double height = ray.altitude + t * std::sin(elevation) + horizontal * horizontal / (2 * 6371000.0);
+
+        const double terrain = surface(dem, latitude, longitude);
+        if (height <= terrain) return t;
+    }
+    return -1;
+}
+
+
+int main() {
+    Scratch scratch("raycast");
+    const size_t size = 600;
+    const Synthetic synthetic(size);
+
+    std::vector<int16_t> values = synthetic.values<int16_t>(27, 86);
+    for (size_t i = 0; i < 3000; ++i) values[(i * 7919) % values.size()] = nodata;
+    const Tile dem(synthetic.type<int16_t, std::endian::big>(27, 86), values);
+    const Pyramid quadtree = Pyramid::build(dem);
+
+    std::mt19937 generator(7);
+    std::uniform_real_distribution<float> uniform(0, 1);
+
+    // rays from just above the terrain, looking down to slightly up
+    std::vector<Raycast::Ray> rays;
+    while (rays.size() < 300) {
+        const float latitude = 27.3f + uniform(generator) * 0.4f, longitude = 86.3f + uniform(generator) * 0.4f;
+        const double ground = surface(dem, latitude, longitude);
+        if (std::isnan(ground)) continue;
+        rays.push_back({{latitude, longitude}, static_cast<float>(ground) + 5 + uniform(generator) * 300, uniform(generator) * 360, -8 + uniform(generator) * 10, 20000});
+    }
+
+    std::vector<Raycast::Hit> batch(rays.size());
+    Raycast::cast(dem, quadtree, std::span<const Raycast::Ray>(rays), std::span<Raycast::Hit>(batch), 3);
+
+    size_t hits = 0, off = 0, differ = 0;
+    for (size_t i = 0; i < rays.size(); ++i) {
+        const Raycast::Hit hit = Raycast::cast(dem, quadtree, rays[i]);
+        const Raycast::Hit flat = Raycast::cast(dem, rays[i]);
+        const double brute = march(dem, rays[i]);
+
+        hits += hit.hit;
+        off += hit.hit != (brute >= 0) || (hit.hit && std::abs(hit.distance - brute) > 1.5);
+        differ += hit.hit != flat.hit || (hit.hit && std::abs(hit.distance - flat.distance) > 0.01f);
+        differ += hit.hit != batch[i].hit || hit.distance != batch[i].distance;
+
+        // the point hit isn't above the terrain (it is below it only on the walls of the holes)
+        if (hit.hit) off += hit.altitude > surface(dem, hit.point.latitude, hit.point.longitude) + 1.0;
+    }
+    CHECK(hits > rays.size() / 4);
+    CHECK(off == 0);
+    CHECK(differ == 0);
+
+    // rays looking up from above the highest point never hit
+    const Raycast::Hit up = Raycast::cast(dem, quadtree, {{27.5f, 86.5f}, 9000, 45, 10, 50000});
+    CHECK(!up.hit);
+
+    // through a map over the same terrain (rays kept inside the DEM tile)
+    serialize<int16_t, std::endian::big>(values.data(), values.size());
+    std::ofstream(scratch.path / "27_86.bin", std::ios::binary).write(reinterpret_cast<const char*>(values.data()), static_cast<std::streamsize>(values.size() * sizeof(int16_t)));
+    const TileMap::Grid grid = TileMap::initialize(scratch.path, size, size, 1.0f / size, nodata);
+    TileMap map(grid);
+
+    // & with the strips of a halo walked beside the DEM tile
+    TileMap::Options surrounded;
+    surrounded.halo = 1;
+    TileMap haloed(grid, surrounded);
+
+    differ = 0;
+    for (size_t i = 0; i < rays.size(); ++i) {
+        const Raycast::Hit mapped = Raycast::cast(map, rays[i]), through = Raycast::cast(haloed, rays[i]);
+        differ += mapped.hit != batch[i].hit || (mapped.hit && std::abs(mapped.distance - batch[i].distance) > 0.01f);
+        differ += through.hit != batch[i].hit || (through.hit && std::abs(through.distance - batch[i].distance) > 0.01f);
+    }
+    CHECK(differ == 0);
+
+    return finish();
+}
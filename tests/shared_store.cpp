@@ -0,0 +1,168 @@
+/*
+MIT License
+
+Copyright (c) 2023 Pritam Halder
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated
+documentation files (the "Software"), to deal in the Software without restriction, including without
+limitation the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the
+Software, and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED
+TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF
+CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+DEALINGS IN THE SOFTWARE.
+
+Author : Pritam Halder
+Email : pritamhalder.portfolio@gmail.com
+*/
+
+
+
+// `SharedStore` : DEM values decoded once & attached by other processes, budget, heap fallback & removal
+
+#include <algorithm>
+#include <cstdlib>
+#include <random>
+#include <string>
+#include <vector>
+
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include "DEM/Map.hpp"
+#include "DEM/SharedStore.hpp"
+#include "Test.hpp"
+
+
+
+// exit status of `child()` run in a forked process
+template <typename Child>
+static int forked(Child child) {
+    const pid_t pid = ::fork();
+    if (pid == 0) ::_exit(child());
+
+    int status = 0;
+    ::waitpid(pid, &status, 0);
+    return WIFEXITED(status) ? WEXITSTATUS(status) : -1;
+}
+
+
+int main() {
+    Scratch scratch("shared_store");
+    const size_t size = 100;
+    const Synthetic synthetic(size);
+    const TileMap::Grid grid = write_grid(synthetic, size, scratch.path, {{-34, 18}, {-34, 19}, {-33, 18}, {-33, 19}});
+    const size_t tile_bytes = size * size * sizeof(int16_t);
+
+    const std::string name = "dem_test_" + std::to_string(::getpid());
+    SharedStore::remove(name);
+
+    {
+        auto store = std::make_shared<SharedStore>(name, 3 * tile_bytes, 16);
+        const auto& [type, path] = grid.begin()->second;
+        const Tile heap(type, path);
+
+        // decoded into the store on the first open
+        size_t decoded = 0;
+        Tile shared = store->open<int16_t, std::endian::big>(type, path, &decoded);
+        CHECK(shared.storage() == Storage::Shared);
+        CHECK(decoded == tile_bytes);
+
+        // the DEM file constructors refuse shared values, as `DEM::open()` does
+        size_t refused = 0;
+        for (int i = 0; i < 3; ++i) {
+            try {
+                if (i == 0) Tile(type, path, Storage::Shared);
+                else if (i == 1) Tile(scratch.path / "missing.tile", Storage::Shared);
+                else Tile::open(type, path, Storage::Shared);
+            } catch (const std::runtime_error& e) {
+                refused += std::string(e.what()).find("SharedStore") != std::string::npos;
+            }
+        }
+        CHECK(refused == 3);
+
+        // opened again, the values are attached to only
+        {
+            const Tile again = store->open<int16_t, std::endian::big>(type, path, &decoded);
+            CHECK(again.storage() == Storage::Shared && decoded == 0);
+        }
+        CHECK(shared.type.nrows == size && shared.bounds.SW == heap.bounds.SW);
+
+        size_t differ = 0;
+        for (size_t r = 0; r < size; ++r) {
+            for (size_t c = 0; c < size; ++c) differ += shared.at(r, c) != heap.at(r, c);
+        }
+        CHECK(differ == 0);
+
+        SharedStore::Usage usage = store->usage();
+        CHECK(usage.tiles == 1 && usage.held == 1 && usage.bytes == tile_bytes);
+
+        // another process attaches to the values without decoding them again
+        const int attached = forked([&]() {
+            SharedStore other(name, 0);
+            bool decoded = false;
+            auto values = other.acquire<int16_t>(SharedStore::identity<std::endian::big>(path), size * size, [&decoded](int16_t*) { decoded = true; });
+            const bool same = std::equal(heap.data().begin(), heap.data().end(), values.get());
+            return !decoded && same ? 0 : 1;
+        });
+        CHECK(attached == 0);
+
+        // released handles leave the values in the store, unheld
+        shared = Tile();
+        usage = store->usage();
+        CHECK(usage.tiles == 1 && usage.held == 0);
+
+        // values beyond the budget evict the unheld values, values larger than the budget stay on the heap
+        for (int i = 0; i < 6; ++i) {
+            auto values = store->acquire<int16_t>("filler " + std::to_string(i), size * size, [i](int16_t* out) { std::fill(out, out + size * size, static_cast<int16_t>(i)); });
+            CHECK(values.get()[size] == i);
+            CHECK(store->usage().bytes <= 3 * tile_bytes);
+        }
+
+        auto large = store->acquire<int16_t>("large", 4 * size * size, [](int16_t* out) { std::fill(out, out + 4 * size * size, int16_t{7}); });
+        CHECK(large.get()[3 * size * size] == 7);
+        CHECK(store->usage().bytes <= 3 * tile_bytes);
+
+        // keys are compared in full : keys longer than a slot keeps are decoded onto the heap every time
+        size_t fills = 0;
+        for (const std::string& key : {std::string(5000, 'k'), std::string(5000, 'k')}) {
+            auto values = store->acquire<int16_t>(key, size, [&fills](int16_t* out) { ++fills; std::fill(out, out + size, int16_t{5}); });
+            CHECK(values.get()[size - 1] == 5);
+        }
+        CHECK(fills == 2);
+
+        // a map over the shared store answers as a map over its own heap
+        TileMap::Options options;
+        options.capacity = 2;
+        options.storage = Storage::Shared;
+        options.store = store;
+        TileMap map(grid, options);
+        TileMap plain(grid);
+
+        std::mt19937 generator(17);
+        std::uniform_real_distribution<float> uniform(0, 1);
+        differ = 0;
+        for (int i = 0; i < 5000; ++i) {
+            const float latitude = -34 + uniform(generator) * 2, longitude = 18 + uniform(generator) * 2;
+            differ += map.interpolated_altitude(latitude, longitude) != plain.interpolated_altitude(latitude, longitude);
+        }
+        CHECK(differ == 0);
+        CHECK(map.get_dem().storage() == Storage::Shared);
+    }
+
+    // removal unlinks the store & every segment of it
+    SharedStore::remove(name);
+    size_t left = 0;
+    if (std::filesystem::exists("/dev/shm")) {
+        for (const auto& entry : std::filesystem::directory_iterator("/dev/shm")) {
+            left += entry.path().filename().string().starts_with(name);
+        }
+    }
+    CHECK(left == 0);
+
+    return finish();
+}
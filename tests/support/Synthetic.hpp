@@ -0,0 +1,143 @@
+/*
+MIT License
+
+Copyright (c) 2023 Pritam Halder
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated
+documentation files (the "Software"), to deal in the Software without restriction, including without
+limitation the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the
+Software, and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED
+TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF
+CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+DEALINGS IN THE SOFTWARE.
+
+Author : Pritam Halder
+Email : pritamhalder.portfolio@gmail.com
+*/
+
+
+#pragma once
+
+#include <bit>
+#include <cmath>
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include "DEM/DEM.hpp"
+
+
+
+// deterministic synthetic terrain : fractal value noise over the global grid of DEM cells,
+// so that neighbouring tiles join without seams. every tile of `size` x `size` values covers 1 degree.
+class Synthetic {
+public:
+    Synthetic(size_t size, uint64_t seed = 1)
+        : size(size),
+        seed(seed)
+    {};
+
+
+    // DEM values of the tile with its south west corner at (`latitude`, `longitude`), row-major from the north
+    template <dem_datatype T>
+    std::vector<T> values(int latitude, int longitude) const {
+        std::vector<T> values(this->size * this->size);
+
+        const int64_t row_0 = static_cast<int64_t>(89 - latitude) * static_cast<int64_t>(this->size);
+        const int64_t column_0 = static_cast<int64_t>(longitude + 180) * static_cast<int64_t>(this->size);
+
+        for (size_t r = 0; r < this->size; ++r) {
+            for (size_t c = 0; c < this->size; ++c) {
+                const double height = this->height(static_cast<double>(row_0 + static_cast<int64_t>(r)), static_cast<double>(column_0 + static_cast<int64_t>(c)));
+                values[r * this->size + c] = static_cast<T>(height);
+            }
+        }
+
+        return values;
+    };
+
+
+    template <dem_datatype T, std::endian endianness>
+    typename DEM<T, endianness>::Type type(int latitude, int longitude) const {
+        return {this->size, this->size, static_cast<float>(latitude), static_cast<float>(longitude), 1.0f / static_cast<float>(this->size), static_cast<T>(-32768)};
+    };
+
+
+    // writes `<latitude>_<longitude>.bin` (values in `endianness` byte order) to `directory`
+    template <dem_datatype T, std::endian endianness>
+    std::filesystem::path write_bin(const std::filesystem::path& directory, int latitude, int longitude) const {
+        std::vector<T> data = this->values<T>(latitude, longitude);
+        serialize<T, endianness>(data.data(), data.size());
+
+        std::filesystem::path path = directory / (std::to_string(latitude) + "_" + std::to_string(longitude) + ".bin");
+        std::ofstream ofp(path, std::ios::binary | std::ios::trunc);
+        ofp.write(reinterpret_cast<const char*>(data.data()), static_cast<std::streamsize>(data.size() * sizeof(T)));
+        return path;
+    };
+
+
+    // writes `<latitude>_<longitude>.asc` (ESRI ASCII grid) to `directory`
+    template <dem_datatype T>
+    std::filesystem::path write_asc(const std::filesystem::path& directory, int latitude, int longitude) const {
+        std::vector<T> data = this->values<T>(latitude, longitude);
+
+        std::filesystem::path path = directory / (std::to_string(latitude) + "_" + std::to_string(longitude) + ".asc");
+        std::ofstream ofp(path, std::ios::trunc);
+        ofp << "ncols " << this->size << "\nnrows " << this->size << "\nxllcorner " << longitude << "\nyllcorner " << latitude
+            << "\ncellsize " << 1.0 / static_cast<double>(this->size) << "\nNODATA_value -32768\n";
+
+        for (size_t r = 0; r < this->size; ++r) {
+            for (size_t c = 0; c < this->size; ++c) {
+                ofp << data[r * this->size + c] << (c + 1 < this->size ? ' ' : '\n');
+            }
+        }
+        return path;
+    };
+
+
+private:
+    size_t size;
+    uint64_t seed;
+
+
+    // uniform value in [0, 1) of an integer lattice point
+    double lattice(int64_t row, int64_t column) const {
+        uint64_t h = this->seed ^ (static_cast<uint64_t>(row) * 0x9E3779B97F4A7C15ull) ^ (static_cast<uint64_t>(column) * 0xC2B2AE3D27D4EB4Full);
+        h ^= h >> 33;
+        h *= 0xFF51AFD7ED558CCDull;
+        h ^= h >> 33;
+        h *= 0xC4CEB9FE1A85EC53ull;
+        h ^= h >> 33;
+        return static_cast<double>(h >> 11) / static_cast<double>(1ull << 53);
+    };
+
+
+    double noise(double row, double column) const {
+        const double r = std::floor(row), c = std::floor(column);
+        const double u = row - r, v = column - c;
+        const double su = u * u * (3 - 2 * u), sv = v * v * (3 - 2 * v);
+        const int64_t ir = static_cast<int64_t>(r), ic = static_cast<int64_t>(c);
+
+        return (1 - su) * ((1 - sv) * this->lattice(ir, ic) + sv * this->lattice(ir, ic + 1))
+            + su * ((1 - sv) * this->lattice(ir + 1, ic) + sv * this->lattice(ir + 1, ic + 1));
+    };
+
+
+    // height (0 .. ~4000) of a global DEM cell, 6 octaves with features from ~1/8 degree down to a few cells
+    double height(double row, double column) const {
+        double period = static_cast<double>(this->size) / 8, amplitude = 2000, height = 0;
+        for (int octave = 0; octave < 6 && period >= 1; ++octave) {
+            height += amplitude * this->noise(row / period, column / period);
+            period /= 2;
+            amplitude /= 2;
+        }
+        return height;
+    };
+};
@@ -0,0 +1,134 @@
+/*
+MIT License
+
+Copyright (c) 2023 Pritam Halder
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated
+documentation files (the "Software"), to deal in the Software without restriction, including without
+limitation the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the
+Software, and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED
+TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF
+CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+DEALINGS IN THE SOFTWARE.
+
+Author : Pritam Halder
+Email : pritamhalder.portfolio@gmail.com
+*/
+
+
+
+
+// `Terrain` : slope, aspect, hillshade & curvature of planes & bowls, nodata neighbourhoods, threads & storages
+
+#include <cmath>
+#include <fstream>
+#include <vector>
+
+#include "DEM/Terrain.hpp"
+#include "Test.hpp"
+
+
+
+int main() {
+    Scratch scratch("terrain");
+
+    // wider than a column block of the kernels, near the equator (1/1200 degree cells)
+    const size_t nrows = 48, ncols = 2500;
+    const float cellsize = 1.0f / 1200;
+    const Tile::Type type(nrows, ncols, 0, 10, cellsize, nodata);
+
+    const float degrees = 57.29577951308232f;
+    const float dy = cellsize * 111320.0f;
+    auto dx = [&](size_t r) { return dy * std::cos((static_cast<float>(nrows - r) - 0.5f) * cellsize / degrees); };
+
+    // a plane rising 2 m per cell towards the east & one rising 3 m per cell towards the north
+    std::vector<int16_t> east(nrows * ncols), north(nrows * ncols);
+    for (size_t r = 0; r < nrows; ++r) {
+        for (size_t c = 0; c < ncols; ++c) {
+            east[r * ncols + c] = static_cast<int16_t>(2 * c);
+            north[r * ncols + c] = static_cast<int16_t>(3 * (nrows - 1 - r));
+        }
+    }
+    const Tile eastward(type, east), northward(type, north), flat(type, std::vector<int16_t>(nrows * ncols, 100));
+
+    // interior cells (the edges repeat their outermost values) answer as the plane
+    size_t off = 0;
+    const DEM<float> slope = Terrain::slope(eastward), aspect = Terrain::aspect(eastward);
+    const DEM<float> lit = Terrain::hillshade(eastward, 270), unlit = Terrain::hillshade(eastward, 90);
+    const DEM<float> south_slope = Terrain::slope(northward), south_aspect = Terrain::aspect(northward);
+    for (size_t r = 1; r + 1 < nrows; ++r) {
+        const float p = 2 / dx(r);
+        const float zenith = 45 / degrees;
+        const float shade = 255 * (std::cos(zenith) + std::sin(zenith) * p) / std::sqrt(1 + p * p);
+
+        for (size_t c = 1; c + 1 < ncols; ++c) {
+            off += std::abs(slope.at(r, c) - std::atan(p) * degrees) > 1e-3f;
+            off += std::abs(aspect.at(r, c) - 270) > 1e-3f;
+            off += std::abs(lit.at(r, c) - shade) > 1e-2f;
+            off += !(unlit.at(r, c) < lit.at(r, c));
+            off += std::abs(south_slope.at(r, c) - std::atan(3 / dy) * degrees) > 1e-3f;
+            off += std::abs(south_aspect.at(r, c) - 180) > 1e-3f;
+        }
+    }
+    CHECK(off == 0);
+
+    // flat terrain : no slope, no aspect, no curvature & the shade of the sun's altitude
+    off = 0;
+    const DEM<float> level = Terrain::slope(flat), heading = Terrain::aspect(flat), shaded = Terrain::hillshade(flat), bent = Terrain::curvature(flat);
+    for (size_t r = 0; r < nrows; ++r) {
+        for (size_t c = 0; c < ncols; ++c) {
+            off += level.at(r, c) != 0 || heading.at(r, c) != -1 || bent.at(r, c) != 0;
+            off += std::abs(shaded.at(r, c) - 255 * std::cos(45 / degrees)) > 1e-2f;
+        }
+    }
+    CHECK(off == 0);
+    CHECK(level.type.nrows == nrows && level.type.ncols == ncols && level.bounds.SW == flat.bounds.SW);
+
+    // a bowl curves upwards (negative), a dome downwards (positive)
+    std::vector<int16_t> bowl(nrows * ncols), dome(nrows * ncols);
+    for (size_t r = 0; r < nrows; ++r) {
+        for (size_t c = 0; c < ncols; ++c) {
+            const int y = static_cast<int>(r) - 24, x = static_cast<int>(c % 48) - 24;
+            bowl[r * ncols + c] = static_cast<int16_t>(x * x + y * y);
+            dome[r * ncols + c] = static_cast<int16_t>(2000 - x * x - y * y);
+        }
+    }
+    const DEM<float> concave = Terrain::curvature(Tile(type, bowl)), convex = Terrain::curvature(Tile(type, dome));
+    CHECK(concave.at(24, 24) < 0 && convex.at(24, 24) > 0);
+    CHECK(std::abs(concave.at(24, 24) + convex.at(24, 24)) < 1e-3f);
+
+    // a nodata value turns its 3x3 neighbourhood into nodata, nothing beyond it
+    std::vector<int16_t> holed = east;
+    holed[20 * ncols + 2047] = nodata;
+    const DEM<float> holed_slope = Terrain::slope(Tile(type, holed));
+    off = 0;
+    for (size_t r = 17; r <= 23; ++r) {
+        for (size_t c = 2044; c <= 2050; ++c) {
+            const bool near = r >= 19 && r <= 21 && c >= 2046 && c <= 2048;
+            off += near != (holed_slope.at(r, c) == static_cast<float>(nodata));
+        }
+    }
+    CHECK(off == 0);
+    CHECK(holed_slope.type.nodata == static_cast<float>(nodata));
+
+    // several threads & DEM values mapped from a file answer as one thread over the heap
+    std::vector<int16_t> stored = bowl;
+    serialize<int16_t, std::endian::big>(stored.data(), stored.size());
+    std::ofstream(scratch.path / "0_10.bin", std::ios::binary).write(reinterpret_cast<const char*>(stored.data()), static_cast<std::streamsize>(stored.size() * sizeof(int16_t)));
+    const Tile heap(type, bowl), mapped = Tile::open(type, scratch.path / "0_10.bin", Storage::Mapped);
+    CHECK(mapped.storage() == Storage::Mapped);
+
+    for (size_t threads : {1, 5}) {
+        CHECK(Terrain::slope(mapped, threads).data() == Terrain::slope(heap).data());
+        CHECK(Terrain::aspect(mapped, threads).data() == Terrain::aspect(heap).data());
+        CHECK(Terrain::hillshade(heap, 315, 45, 2, threads).data() == Terrain::hillshade(mapped, 315, 45, 2).data());
+        CHECK(Terrain::curvature(heap, threads).data() == concave.data());
+    }
+
+    return finish();
+}
@@ -0,0 +1,161 @@
+/*
+MIT License
+
+Copyright (c) 2023 Pritam Halder
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated
+documentation files (the "Software"), to deal in the Software without restriction, including without
+limitation the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the
+Software, and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED
+TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF
+CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+DEALINGS IN THE SOFTWARE.
+
+Author : Pritam Halder
+Email : pritamhalder.portfolio@gmail.com
+*/
+
+
+
+// `.tile` codecs & storages : every `.tile` of a `.bin` file decodes back to the values of the `.bin` file
+
+#include <cstdint>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "DEM/DEM.hpp"
+#include "DEM/Utility.hpp"
+#include "Test.hpp"
+
+
+
+template <typename D>
+static bool same(const Tile& expected, const D& dem) {
+    if (dem.type.nrows != expected.type.nrows || dem.type.ncols != expected.type.ncols) return false;
+    if (dem.type.cellsize != expected.type.cellsize || dem.type.nodata != expected.type.nodata) return false;
+
+    for (size_t r = 0; r < expected.type.nrows; ++r) {
+        for (size_t c = 0; c < expected.type.ncols; ++c) {
+            if (dem.at(r, c) != expected.at(r, c)) return false;
+        }
+    }
+    return true;
+}
+
+
+int main() {
+    Scratch scratch("tile_format");
+    const size_t size = 150;
+    const Synthetic synthetic(size);
+
+    const std::filesystem::path bin = synthetic.write_bin<int16_t, std::endian::big>(scratch.path, 27, 86);
+    const Tile::Type type = synthetic.type<int16_t, std::endian::big>(27, 86);
+    const Tile heap(type, bin);
+
+    // every storage of the `.bin` file reads the same values
+    CHECK(same(heap, Tile(type, bin, Storage::Mapped)));
+    CHECK(same(heap, Tile::open(type, bin, Storage::Mapped)));
+    CHECK(heap.data() == synthetic.values<int16_t>(27, 86));
+
+    // headerless files have no blocks, `open()` maps them instead
+    bool refused = false;
+    try {
+        Tile blocks(type, bin, Storage::Blocks);
+    } catch (const std::runtime_error&) {
+        refused = true;
+    }
+    CHECK(refused);
+    CHECK(Tile::open(type, bin, Storage::Blocks).storage() == Storage::Mapped);
+
+    // copies & moves read their own values, whatever the original becomes
+    {
+        Tile original(type, bin);
+        const Tile copy = original;
+        Tile assigned;
+        assigned = original;
+        original = Tile(type, bin, Storage::Mapped);
+        const Tile moved = std::move(original);
+        CHECK(same(heap, copy) && same(heap, assigned) && same(heap, moved));
+        CHECK(copy.storage() == Storage::Heap && moved.storage() == Storage::Mapped);
+    }
+
+    // raw & delta coded tiles, with block edges dividing the raster or not
+    for (TileFormat::Codec codec : {TileFormat::Codec::Raw, TileFormat::Codec::Delta}) {
+        for (uint32_t block : {16u, 64u, 256u}) {
+            Utility<int16_t, std::endian::big>::create_dem_bin_tile(bin, type, block, codec);
+            const std::filesystem::path tile = scratch.path / "27_86.tile";
+            CHECK(TileFormat::is_tile(tile));
+
+            const Tile decoded(tile);
+            CHECK(same(heap, decoded));
+            CHECK(decoded.bounds.SW == heap.bounds.SW && decoded.bounds.NE == heap.bounds.NE);
+
+            // decoded on access under a budget smaller than the raster
+            const size_t budget = 4 * block * block * sizeof(int16_t);
+            const Tile blocks(tile, Storage::Blocks, budget);
+            CHECK(blocks.resident_bytes() == 0);
+            CHECK(same(heap, blocks));
+            CHECK(blocks.resident_bytes() > 0 && blocks.resident_bytes() <= budget);
+            CHECK(same(heap, Tile(tile, Storage::Blocks)));
+            CHECK(same(heap, Tile::open(type, tile, Storage::Blocks, 1)));
+
+            // decoded blocks are counted as they are decoded
+            auto statistics = std::make_shared<Statistics>();
+            statistics->enable();
+            const Tile counted(tile, Storage::Blocks, 0, statistics);
+            CHECK(statistics->snapshot()[Statistics::Bytes] == 0);
+            counted.at(0, 0);
+            counted.at(size - 1, size - 1);
+            CHECK(statistics->snapshot()[Statistics::Bytes] == (block < size ? 2 : 1) * block * block * sizeof(int16_t));
+
+            // shared by threads walking it in different orders, blocks evicted under one thread stay pinned for it
+            std::vector<size_t> differ(3, 0);
+            std::vector<std::thread> threads;
+            for (size_t t = 0; t < differ.size(); ++t) {
+                threads.emplace_back([&, t]() {
+                    for (size_t i = 0; i < size * size; ++i) {
+                        const size_t r = t == 1 ? i % size : i / size, c = t == 1 ? i / size : i % size;
+                        const size_t row = t == 2 ? size - 1 - r : r;
+                        differ[t] += blocks.at(row, c) != heap.at(row, c);
+                    }
+                });
+            }
+            for (std::thread& thread : threads) thread.join();
+            CHECK(differ == std::vector<size_t>(3, 0));
+            CHECK(blocks.resident_bytes() <= budget);
+        }
+    }
+
+    // floating point values keep their bits
+    std::vector<float> values(40 * 30);
+    for (size_t i = 0; i < values.size(); ++i) values[i] = static_cast<float>(i) * 0.37f - 100.0f;
+    DEM<float>::Type float_type(40, 30, 10, 20, 0.01f, -9999.0f);
+    TileFormat::Header header;
+    header.byte_order = std::endian::native;
+    header.block = 16;
+    header.nrows = float_type.nrows;
+    header.ncols = float_type.ncols;
+    header.yllcorner = float_type.yllcorner;
+    header.xllcorner = float_type.xllcorner;
+    header.cellsize = float_type.cellsize;
+    header.nodata = float_type.nodata;
+    TileFormat::write(scratch.path / "float.tile", header, values.data());
+    CHECK(DEM<float>(scratch.path / "float.tile").data() == values);
+
+    // a `.tile` of another sample type is refused
+    refused = false;
+    try {
+        DEM<int32_t> wrong(scratch.path / "float.tile");
+    } catch (const std::runtime_error&) {
+        refused = true;
+    }
+    CHECK(refused);
+
+    return finish();
+}
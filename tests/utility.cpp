@@ -0,0 +1,160 @@
+/*
+MIT License
+
+Copyright (c) 2023 Pritam Halder
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated
+documentation files (the "Software"), to deal in the Software without restriction, including without
+limitation the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the
+Software, and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED
+TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF
+CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+DEALINGS IN THE SOFTWARE.
+
+Author : Pritam Halder
+Email : pritamhalder.portfolio@gmail.com
+*/
+
+
+
+
+// `Utility` : text to `.bin` conversions stream in bounded chunks & leave no partial `.bin` behind
+
+#include <cstdint>
+#include <fstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "DEM/Utility.hpp"
+#include "Test.hpp"
+
+
+
+using Convert = Utility<int16_t, std::endian::big>;
+
+
+// `.asc` file of `nrows` x `ncols` values (`count` of them written), every value on one line when `single_line`
+static std::vector<int16_t> write_asc(const std::filesystem::path& path, size_t nrows, size_t ncols, size_t count, bool single_line) {
+    std::ofstream ofp(path);
+    ofp << "ncols " << ncols << "\nnrows " << nrows << "\nxllcorner 86\nyllcorner 27\ncellsize 0.001\nNODATA_value -32768\n";
+
+    std::vector<int16_t> values(count);
+    std::string text;
+    for (size_t i = 0; i < count; ++i) {
+        values[i] = static_cast<int16_t>((i * 7919) % 9000);
+        text += std::to_string(values[i]);
+        text += (single_line || (i + 1) % ncols != 0) ? ' ' : '\n';
+    }
+    ofp << text;
+    return values;
+}
+
+
+static std::vector<int16_t> read_bin(const std::filesystem::path& path) {
+    std::vector<int16_t> values(std::filesystem::file_size(path) / sizeof(int16_t));
+    std::ifstream(path, std::ios::binary).read(reinterpret_cast<char*>(values.data()), static_cast<std::streamsize>(values.size() * sizeof(int16_t)));
+    serialize<int16_t, std::endian::big>(values.data(), values.size());
+    return values;
+}
+
+
+int main() {
+    Scratch scratch("utility");
+    const std::filesystem::path asc = scratch.path / "27_86.asc", bin = scratch.path / "27_86.bin";
+
+    // values without any line break, spanning several parse chunks (more than 16 MB of text)
+    const size_t nrows = 1500, ncols = 2800;
+    const std::vector<int16_t> values = write_asc(asc, nrows, ncols, nrows * ncols, true);
+    CHECK(std::filesystem::file_size(asc) > (16u << 20));
+
+    for (size_t threads : {1, 3}) {
+        const auto type = Convert::create_dem_asc_bin(asc, threads);
+        CHECK(type.nrows == nrows && type.ncols == ncols);
+        CHECK(read_bin(bin) == values);
+        CHECK(!std::filesystem::exists(bin.string() + ".tmp"));
+    }
+
+    // a failed conversion leaves the earlier `.bin` as it was & no temporary file
+    write_asc(asc, 40, 30, 40 * 30 - 7, false);
+    bool thrown = false;
+    try { Convert::create_dem_asc_bin(asc); } catch (const std::runtime_error&) { thrown = true; }
+    CHECK(thrown);
+    CHECK(read_bin(bin) == values);
+    CHECK(!std::filesystem::exists(bin.string() + ".tmp"));
+
+    std::ofstream(scratch.path / "bad.asc") << "ncols 2\nnrows 2\nxllcorner 86\nyllcorner 27\ncellsize 0.5\nNODATA_value -32768\n1 2\n3 x\n";
+    thrown = false;
+    try { Convert::create_dem_asc_bin(scratch.path / "bad.asc"); } catch (const std::runtime_error&) { thrown = true; }
+    CHECK(thrown);
+    CHECK(!std::filesystem::exists(scratch.path / "bad.bin") && !std::filesystem::exists(scratch.path / "bad.bin.tmp"));
+
+    // `.csv` rows convert the same
+    const std::vector<int16_t> small = write_asc(asc, 40, 30, 40 * 30, false);
+    CHECK(Convert::create_dem_asc_csv(asc).ncols == 30);
+    Convert::create_dem_csv_bin(scratch.path / "27_86.csv", 2);
+    CHECK(read_bin(bin) == small);
+
+    // a short `.asc` leaves no `.csv` behind either
+    write_asc(scratch.path / "short.asc", 40, 30, 40 * 30 - 1, false);
+    thrown = false;
+    try { Convert::create_dem_asc_csv(scratch.path / "short.asc"); } catch (const std::runtime_error&) { thrown = true; }
+    CHECK(thrown);
+    CHECK(!std::filesystem::exists(scratch.path / "short.csv") && !std::filesystem::exists(scratch.path / "short.csv.tmp"));
+
+    // whole directories : every file converted on its own, a failed file reported without stopping the others
+    const std::filesystem::path directory = scratch.path / "directory";
+    std::filesystem::create_directories(directory);
+    std::vector<std::vector<int16_t>> converted;
+    size_t bytes = 0;
+    for (size_t i = 0; i < 3; ++i) {
+        const std::filesystem::path path = directory / ("2" + std::to_string(i) + "_86.asc");
+        converted.push_back(write_asc(path, 20 + 10 * i, 30, (20 + 10 * i) * 30, false));
+        bytes += std::filesystem::file_size(path);
+    }
+    write_asc(directory / "short.asc", 20, 30, 20 * 30 - 1, false);
+    std::ofstream(directory / "notes.txt") << "not a DEM";
+
+    for (size_t threads : {1, 3}) {
+        size_t progressed = 0;
+        const Convert::Report report = Convert::convert_directory(directory, Convert::Format::Bin, threads, [&progressed](const Convert::Conversion&) { ++progressed; });
+        CHECK(report.files.size() == 4 && progressed == 4);
+        CHECK(report.failed() == 1);
+        CHECK(report.bytes == bytes);
+
+        for (const Convert::Conversion& conversion : report.files) {
+            if (conversion.input.filename() == "short.asc") {
+                CHECK(!conversion.converted && conversion.error.find("short.asc") != std::string::npos);
+                CHECK(!std::filesystem::exists(conversion.output) && !std::filesystem::exists(conversion.output.string() + ".tmp"));
+            } else {
+                const size_t i = static_cast<size_t>(conversion.input.filename().string()[1] - '0');
+                CHECK(conversion.converted && conversion.error.empty());
+                CHECK(conversion.output == directory / ("2" + std::to_string(i) + "_86.bin"));
+                CHECK(read_bin(conversion.output) == converted[i]);
+            }
+        }
+        for (const std::filesystem::path& path : {directory / "short.bin", directory / "notes.bin"}) CHECK(!std::filesystem::exists(path));
+    }
+
+    // `.tile` outputs hold the same values, `.csv` inputs convert to `.bin` only
+    Convert::create_dem_asc_csv(directory / "21_86.asc");
+    const Convert::Report tiles = Convert::convert_directory(directory, Convert::Format::Tile, 2);
+    CHECK(tiles.files.size() == 5 && tiles.failed() == 2);
+    for (const Convert::Conversion& conversion : tiles.files) {
+        if (conversion.input.extension() == ".csv") CHECK(!conversion.converted && !conversion.error.empty());
+        if (conversion.input.filename() == "20_86.asc") CHECK(conversion.converted && Tile(conversion.output).data() == converted[0]);
+    }
+
+    // an exception of the progress callback is rethrown, as is a missing directory
+    size_t failures = 0;
+    try { Convert::convert_directory(directory, Convert::Format::Bin, 2, [](const Convert::Conversion&) { throw std::runtime_error("stop"); }); } catch (const std::runtime_error&) { ++failures; }
+    try { Convert::convert_directory(scratch.path / "missing"); } catch (const std::runtime_error&) { ++failures; }
+    CHECK(failures == 2);
+
+    return finish();
+}
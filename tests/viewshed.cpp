@@ -0,0 +1,89 @@
+/*
+MIT License
+
+Copyright (c) 2023 Pritam Halder
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated
+documentation files (the "Software"), to deal in the Software without restriction, including without
+limitation the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the
+Software, and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED
+TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF
+CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+DEALINGS IN THE SOFTWARE.
+
+Author : Pritam Halder
+Email : pritamhalder.portfolio@gmail.com
+*/
+
+
+
+// `Viewshed` : horizon of a flat earth, shadow of a ridge & the same viewshed through a `Map`
+
+#include <cmath>
+#include <fstream>
+#include <vector>
+
+#include "DEM/Viewshed.hpp"
+#include "Test.hpp"
+
+
+
+int main() {
+    Scratch scratch("viewshed");
+
+    // flat terrain (1/1200 degree cells, ~0.4 degree wide) with an east-west ridge 3 km north of the observer
+    const size_t size = 481;
+    const float cellsize = 1.0f / 1200;
+    const Tile::Type type(size, size, 20, 30, cellsize, nodata);
+    const Coordinate observer(20 + 0.2f + cellsize / 4, 30 + 0.2f + cellsize / 4);
+
+    std::vector<int16_t> values(size * size, 0);
+    const size_t ridge = size / 2 - static_cast<size_t>(std::lround(3000 / (cellsize * 111320)));
+    for (size_t c = 0; c < size; ++c) values[ridge * size + c] = 300;
+    const Tile dem(type, values);
+
+    const float height = 10, radius = 20000;
+    const Viewshed viewshed = Viewshed::compute(dem, observer, height, radius);
+    CHECK(viewshed.visible(observer.latitude, observer.longitude));
+
+    // the horizon of an observer `height` meters above a flat earth
+    const float horizon = std::sqrt(2 * 6371000.0f * height);
+    const float meters = 111320, width = meters * std::cos(observer.latitude * 0.017453292519943295f);
+
+    size_t off = 0;
+    for (float distance = 200; distance < radius * 0.95f; distance += 100) {
+        const bool near = distance < 0.9f * horizon, far = distance > 1.1f * horizon;
+
+        // south, east & west are open
+        for (const auto& [north, east] : {std::pair<float, float>{-1, 0}, {0, 1}, {0, -1}, {-0.7071f, 0.7071f}}) {
+            const bool visible = viewshed.visible(observer.latitude + north * distance / meters, observer.longitude + east * distance / width);
+            off += (near && !visible) || (far && visible);
+        }
+
+        // north of the ridge is hidden
+        if (distance > 3200) off += viewshed.visible(observer.latitude + distance / meters, observer.longitude);
+    }
+    CHECK(off == 0);
+
+    // sectors swept in parallel mark the same cells
+    const Viewshed parallel = Viewshed::compute(dem, observer, height, radius, 0, 4);
+    CHECK(parallel.mask == viewshed.mask);
+    CHECK(parallel.count() == viewshed.count());
+
+    // the same terrain as a DEM tile of a map
+    std::vector<int16_t> stored = values;
+    serialize<int16_t, std::endian::big>(stored.data(), stored.size());
+    std::ofstream(scratch.path / "20_30.bin", std::ios::binary).write(reinterpret_cast<const char*>(stored.data()), static_cast<std::streamsize>(stored.size() * sizeof(int16_t)));
+
+    TileMap map(TileMap::initialize(scratch.path, size, size, cellsize, nodata));
+    const Viewshed mapped = Viewshed::compute(map, observer, height, radius);
+    CHECK(mapped.nrows == viewshed.nrows && mapped.ncols == viewshed.ncols);
+    CHECK(mapped.mask == viewshed.mask);
+
+    return finish();
+}
@@ -0,0 +1,106 @@
+/*
+MIT License
+
+Copyright (c) 2023 Pritam Halder
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated
+documentation files (the "Software"), to deal in the Software without restriction, including without
+limitation the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the
+Software, and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED
+TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF
+CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+DEALINGS IN THE SOFTWARE.
+
+Author : Pritam Halder
+Email : pritamhalder.portfolio@gmail.com
+*/
+
+
+
+// windowed reads : the cells read from a window of a `.bin` or `.tile` file match the whole DEM tile
+
+#include <cmath>
+#include <random>
+
+#include "DEM/DEM.hpp"
+#include "DEM/Utility.hpp"
+#include "Test.hpp"
+
+
+
+// every cell of `part` holds the value of the cell of `whole` at the same position, `part` covers `window`
+static bool inside(const Tile& whole, const Tile& part, const Bounds& window) {
+    const float cellsize = whole.type.cellsize;
+    const long row_0 = std::lround((whole.bounds.NE.latitude - part.bounds.NE.latitude) / cellsize);
+    const long column_0 = std::lround((part.bounds.SW.longitude - whole.bounds.SW.longitude) / cellsize);
+    if (row_0 < 0 || column_0 < 0) return false;
+
+    for (size_t r = 0; r < part.type.nrows; ++r) {
+        for (size_t c = 0; c < part.type.ncols; ++c) {
+            if (part.at(r, c) != whole.at(static_cast<size_t>(row_0) + r, static_cast<size_t>(column_0) + c)) return false;
+        }
+    }
+
+    const float slack = cellsize / 4;
+    return part.bounds.NE.latitude + slack >= window.NE.latitude && part.bounds.SW.latitude - slack <= window.SW.latitude
+        && part.bounds.SW.longitude - slack <= window.SW.longitude && part.bounds.NE.longitude + slack >= window.NE.longitude;
+}
+
+
+int main() {
+    Scratch scratch("window");
+    const size_t size = 200;
+    const Synthetic synthetic(size);
+
+    const std::filesystem::path bin = synthetic.write_bin<int16_t, std::endian::big>(scratch.path, -13, -48);
+    const Tile::Type type = synthetic.type<int16_t, std::endian::big>(-13, -48);
+    Utility<int16_t, std::endian::big>::create_dem_bin_tile(bin, type, 64, TileFormat::Codec::Delta);
+    const std::filesystem::path tile = scratch.path / "-13_-48.tile";
+
+    const Tile whole(type, bin);
+
+    std::mt19937 generator(11);
+    std::uniform_real_distribution<float> uniform(0, 1);
+
+    for (int i = 0; i < 50; ++i) {
+        const float south = -13 + uniform(generator) * 0.9f, west = -48 + uniform(generator) * 0.9f;
+        // full width windows are read with a single read
+        const float width = i % 5 == 0 ? 1.0f : uniform(generator) * 0.1f + 0.02f;
+        const float height = uniform(generator) * 0.1f + 0.02f;
+        const float east = i % 5 == 0 ? -47.0f : std::min(west + width, -47.0f);
+        const float north = std::min(south + height, -12.0f);
+        const Bounds window({north, i % 5 == 0 ? -48.0f : west}, {north, east}, {south, i % 5 == 0 ? -48.0f : west}, {south, east});
+
+        const Tile from_bin(type, bin, window);
+        const Tile from_tile(tile, window);
+
+        CHECK(inside(whole, from_bin, window));
+        CHECK(inside(whole, from_tile, window));
+        CHECK(from_bin.data() == from_tile.data());
+        CHECK(Tile::open(type, tile, window).data() == from_bin.data());
+
+        // points of the window (a cell away from its edges) interpolate as in the whole DEM tile
+        const float margin = type.cellsize;
+        for (int j = 0; j < 20; ++j) {
+            const float latitude = window.SW.latitude + margin + uniform(generator) * (window.NE.latitude - window.SW.latitude - 2 * margin);
+            const float longitude = window.SW.longitude + margin + uniform(generator) * (window.NE.longitude - window.SW.longitude - 2 * margin);
+            CHECK(std::abs(from_bin.interpolated_altitude(latitude, longitude) - whole.interpolated_altitude(latitude, longitude)) < 0.5f);
+        }
+    }
+
+    // windows outside the DEM tile are refused
+    bool refused = false;
+    try {
+        Tile outside(type, bin, Bounds({10, 10}, {10, 11}, {9, 10}, {9, 11}));
+    } catch (const std::runtime_error&) {
+        refused = true;
+    }
+    CHECK(refused);
+
+    return finish();
+}